@@ -0,0 +1,84 @@
+#ifndef ARDUINO_H
+#define ARDUINO_H
+#include "esp_attr.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Host subset of the Arduino-ESP32 core used by the firmware. Digital pins
+// are NodeSim pins, time is the NodeSim clock, LEDC channels only keep their
+// duty, and Serial goes to stdout once NodeSim::echoSerial() turns it on.
+#define HIGH 0x1
+#define LOW 0x0
+
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define PULLUP 0x04
+#define INPUT_PULLUP 0x05
+#define PULLDOWN 0x08
+#define INPUT_PULLDOWN 0x09
+
+#define RISING 0x01
+#define FALLING 0x02
+#define CHANGE 0x03
+
+#define DEC 10
+#define HEX 16
+
+#define ARDUINO_RUNNING_CORE 1
+#define SERIAL_8N1 0x800001c
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+
+uint32_t ledcSetup(uint8_t chan, uint32_t freq, uint8_t bit_num);
+void ledcWrite(uint8_t chan, uint32_t duty);
+uint32_t ledcRead(uint8_t chan);
+void ledcAttachPin(uint8_t pin, uint8_t chan);
+
+class HardwareSerial {
+public:
+  void begin(unsigned long baud, uint32_t config = SERIAL_8N1,
+             int8_t rxPin = -1, int8_t txPin = -1);
+  void end() {}
+  int available() { return 0; }
+  int read() { return -1; }
+  void flush();
+
+  size_t write(uint8_t c);
+  size_t write(const uint8_t* buffer, size_t size);
+  size_t print(const char* s);
+  size_t print(char c);
+  size_t print(int n, int base = DEC);
+  size_t print(unsigned int n, int base = DEC);
+  size_t print(long n, int base = DEC);
+  size_t print(unsigned long n, int base = DEC);
+  size_t print(long long n, int base = DEC);
+  size_t print(unsigned long long n, int base = DEC);
+  size_t print(double n, int digits = 2);
+  template <typename T>
+  size_t println(T value) {
+    size_t n = print(value);
+    return n + println();
+  }
+  size_t println() { return print("\r\n"); }
+};
+
+extern HardwareSerial Serial;
+
+#endif  // ARDUINO_H
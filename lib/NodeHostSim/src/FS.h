@@ -0,0 +1,55 @@
+#ifndef FS_H
+#define FS_H
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// Host file system: files are byte vectors in memory, shared by every open
+// handle and kept until NodeSim::eraseFlash()
+namespace fs {
+
+class File {
+public:
+  File() = default;
+  explicit operator bool() const { return _data != nullptr; }
+
+  size_t write(uint8_t c);
+  size_t write(const uint8_t* buf, size_t size);
+  size_t print(const char* s);
+  size_t printf(const char* format, ...)
+      __attribute__((format(printf, 2, 3)));
+
+  int read();
+  size_t read(uint8_t* buf, size_t size);
+  size_t readBytes(char* buffer, size_t length);
+  int peek();
+  int available();
+
+  bool seek(uint32_t pos);
+  size_t position() const { return _pos; }
+  size_t size() const;
+  void flush() {}
+  void close();
+
+private:
+  friend class FS;
+  std::shared_ptr<std::vector<uint8_t>> _data;
+  size_t _pos = 0;
+  bool _writable = false;
+};
+
+class FS {
+public:
+  File open(const char* path, const char* mode = "r", bool create = false);
+  bool exists(const char* path);
+  bool remove(const char* path);
+  bool rename(const char* pathFrom, const char* pathTo);
+};
+
+}  // namespace fs
+
+using fs::File;
+using fs::FS;
+
+#endif  // FS_H
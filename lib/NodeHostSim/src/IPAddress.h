@@ -0,0 +1,26 @@
+#ifndef IPADDRESS_H
+#define IPADDRESS_H
+#include <stdint.h>
+
+class IPAddress {
+public:
+  IPAddress() : _address{0, 0, 0, 0} {}
+  IPAddress(uint8_t first, uint8_t second, uint8_t third, uint8_t fourth)
+      : _address{first, second, third, fourth} {}
+
+  uint8_t operator[](int index) const { return _address[index]; }
+  uint8_t& operator[](int index) { return _address[index]; }
+  bool operator==(const IPAddress& other) const {
+    for (int i = 0; i < 4; ++i) {
+      if (_address[i] != other._address[i]) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+private:
+  uint8_t _address[4];
+};
+
+#endif  // IPADDRESS_H
@@ -0,0 +1,21 @@
+#ifndef LITTLEFS_H
+#define LITTLEFS_H
+#include "FS.h"
+
+namespace fs {
+
+class LittleFSFS : public FS {
+public:
+  bool begin(bool formatOnFail = false, const char* basePath = "/littlefs",
+             uint8_t maxOpenFiles = 10, const char* partitionLabel = "spiffs");
+  bool format();
+  void end() {}
+  size_t totalBytes();
+  size_t usedBytes();
+};
+
+}  // namespace fs
+
+extern fs::LittleFSFS LittleFS;
+
+#endif  // LITTLEFS_H
@@ -0,0 +1,185 @@
+#ifndef MODBUS_RTU_H
+#define MODBUS_RTU_H
+#include <functional>
+#include <map>
+#include <stdint.h>
+
+// Host stand-in for the modbus-esp8266 RTU slave: the register map and its
+// onSet/onGet callbacks, without the serial line. writeHreg()/readHreg() and
+// friends do what a master request does, so tests drive the same callbacks
+// a Modbus master would.
+#define COIL_VAL(v) ((v) ? 0xFF00 : 0x0000)
+#define COIL_BOOL(v) ((v) == 0xFF00)
+
+namespace Modbus {
+
+enum ResultCode {
+  EX_SUCCESS = 0x00,
+  EX_ILLEGAL_FUNCTION = 0x01,
+  EX_ILLEGAL_ADDRESS = 0x02,
+  EX_ILLEGAL_VALUE = 0x03,
+  EX_SLAVE_FAILURE = 0x04,
+  EX_TIMEOUT = 0xE4,
+};
+
+}  // namespace Modbus
+
+struct TAddress {
+  enum RegType { COIL, ISTS, IREG, HREG, NONE = 0xFF };
+  uint16_t address;
+  RegType type;
+};
+
+struct TRegister {
+  TAddress address;
+  uint16_t value;
+};
+
+typedef std::function<uint16_t(TRegister* reg, uint16_t val)> cbModbus;
+
+class ModbusRTU {
+public:
+  template <typename TStream>
+  bool begin(TStream* port, int16_t txPin = -1, bool direct = true) {
+    return true;
+  }
+  void slave(uint8_t slaveId) { _slaveId = slaveId; }
+  uint8_t slave() const { return _slaveId; }
+  void task() {}
+
+  bool addCoil(uint16_t offset, bool value = false, uint16_t numregs = 1) {
+    return add(TAddress::COIL, offset, COIL_VAL(value), numregs);
+  }
+  bool addHreg(uint16_t offset, uint16_t value = 0, uint16_t numregs = 1) {
+    return add(TAddress::HREG, offset, value, numregs);
+  }
+  bool addIreg(uint16_t offset, uint16_t value = 0, uint16_t numregs = 1) {
+    return add(TAddress::IREG, offset, value, numregs);
+  }
+
+  bool onSetCoil(uint16_t offset, cbModbus cb = nullptr,
+                 uint16_t numregs = 1) {
+    return hook(TAddress::COIL, offset, cb, numregs, true);
+  }
+  bool onGetCoil(uint16_t offset, cbModbus cb = nullptr,
+                 uint16_t numregs = 1) {
+    return hook(TAddress::COIL, offset, cb, numregs, false);
+  }
+  bool onSetHreg(uint16_t offset, cbModbus cb = nullptr,
+                 uint16_t numregs = 1) {
+    return hook(TAddress::HREG, offset, cb, numregs, true);
+  }
+  bool onGetHreg(uint16_t offset, cbModbus cb = nullptr,
+                 uint16_t numregs = 1) {
+    return hook(TAddress::HREG, offset, cb, numregs, false);
+  }
+  bool onGetIreg(uint16_t offset, cbModbus cb = nullptr,
+                 uint16_t numregs = 1) {
+    return hook(TAddress::IREG, offset, cb, numregs, false);
+  }
+
+  // Local access, no callbacks, as in the library
+  bool Hreg(uint16_t offset, uint16_t value) {
+    return set(TAddress::HREG, offset, value);
+  }
+  uint16_t Hreg(uint16_t offset) { return get(TAddress::HREG, offset); }
+  bool Coil(uint16_t offset, bool value) {
+    return set(TAddress::COIL, offset, COIL_VAL(value));
+  }
+  bool Coil(uint16_t offset) {
+    return COIL_BOOL(get(TAddress::COIL, offset));
+  }
+  bool Ireg(uint16_t offset, uint16_t value) {
+    return set(TAddress::IREG, offset, value);
+  }
+  uint16_t Ireg(uint16_t offset) { return get(TAddress::IREG, offset); }
+
+  // Host only: a master write (FC05/FC06) or read (FC01/FC03/FC04) of one
+  // register. Writes store what the onSet callback returns; reads return
+  // what the onGet callback makes of the stored value.
+  bool writeHreg(uint16_t offset, uint16_t value) {
+    return masterWrite(TAddress::HREG, offset, value);
+  }
+  bool writeCoil(uint16_t offset, bool value) {
+    return masterWrite(TAddress::COIL, offset, COIL_VAL(value));
+  }
+  uint16_t readHreg(uint16_t offset) {
+    return masterRead(TAddress::HREG, offset);
+  }
+  bool readCoil(uint16_t offset) {
+    return COIL_BOOL(masterRead(TAddress::COIL, offset));
+  }
+  uint16_t readIreg(uint16_t offset) {
+    return masterRead(TAddress::IREG, offset);
+  }
+
+private:
+  struct Entry {
+    TRegister reg;
+    cbModbus onSet;
+    cbModbus onGet;
+  };
+
+  static uint32_t key(TAddress::RegType type, uint16_t offset) {
+    return (static_cast<uint32_t>(type) << 16) | offset;
+  }
+  Entry* find(TAddress::RegType type, uint16_t offset) {
+    auto it = _regs.find(key(type, offset));
+    return it == _regs.end() ? nullptr : &it->second;
+  }
+
+  bool add(TAddress::RegType type, uint16_t offset, uint16_t value,
+           uint16_t numregs) {
+    for (uint16_t i = 0; i < numregs; ++i) {
+      Entry& entry = _regs[key(type, offset + i)];
+      entry.reg.address.address = offset + i;
+      entry.reg.address.type = type;
+      entry.reg.value = value;
+    }
+    return true;
+  }
+  bool hook(TAddress::RegType type, uint16_t offset, cbModbus cb,
+            uint16_t numregs, bool onSet) {
+    for (uint16_t i = 0; i < numregs; ++i) {
+      Entry* entry = find(type, offset + i);
+      if (entry == nullptr) {
+        return false;
+      }
+      (onSet ? entry->onSet : entry->onGet) = cb;
+    }
+    return true;
+  }
+  bool set(TAddress::RegType type, uint16_t offset, uint16_t value) {
+    Entry* entry = find(type, offset);
+    if (entry == nullptr) {
+      return false;
+    }
+    entry->reg.value = value;
+    return true;
+  }
+  uint16_t get(TAddress::RegType type, uint16_t offset) {
+    Entry* entry = find(type, offset);
+    return entry ? entry->reg.value : 0;
+  }
+  bool masterWrite(TAddress::RegType type, uint16_t offset, uint16_t value) {
+    Entry* entry = find(type, offset);
+    if (entry == nullptr) {
+      return false;
+    }
+    entry->reg.value = entry->onSet ? entry->onSet(&entry->reg, value) : value;
+    return true;
+  }
+  uint16_t masterRead(TAddress::RegType type, uint16_t offset) {
+    Entry* entry = find(type, offset);
+    if (entry == nullptr) {
+      return 0;
+    }
+    return entry->onGet ? entry->onGet(&entry->reg, entry->reg.value)
+                        : entry->reg.value;
+  }
+
+  std::map<uint32_t, Entry> _regs;
+  uint8_t _slaveId = 1;
+};
+
+#endif  // MODBUS_RTU_H
@@ -0,0 +1,192 @@
+#include "NodeSim.h"
+#include "HardwareConfig.h"
+#include "NodeSimKernel.h"
+#include "driver/gpio.h"
+#include <stddef.h>
+
+namespace NodeSim {
+
+namespace {
+
+struct PinChange {
+  int64_t time_us;
+  uint8_t pin;
+  uint8_t level;
+};
+
+struct Interrupt {
+  uint8_t type;  // gpio_int_type_t
+  void (*handler)(void*);
+  void* arg;
+};
+
+constexpr uint8_t PIN_COUNT = 40;
+constexpr size_t MAX_PENDING = 64;
+constexpr int64_t ZERO_CROSS_PULSE_US = 100;
+
+UpsModel model;
+int64_t isrIdle_us = 0;  // When the ISR service is free for the next edge
+uint8_t levels[PIN_COUNT];
+Interrupt interrupts[PIN_COUNT];
+PinChange pending[MAX_PENDING];  // Sorted by time, FIFO for equal times
+size_t pendingCount = 0;
+int64_t nextCrossing_us = Kernel::NEVER;
+uint32_t rng = 1;
+int64_t cut_us = 0;
+int64_t upsReturn_us = 0;
+
+// xorshift32, uniform in [0, range]
+uint32_t random(uint32_t range) {
+  rng ^= rng << 13;
+  rng ^= rng >> 17;
+  rng ^= rng << 5;
+  return range == 0 ? 0 : rng % (range + 1);
+}
+
+void schedule(int64_t time_us, uint8_t pin, uint8_t level) {
+  if (pendingCount == MAX_PENDING) {
+    return;
+  }
+  size_t i = pendingCount++;
+  while (i > 0 && pending[i - 1].time_us > time_us) {
+    pending[i] = pending[i - 1];
+    --i;
+  }
+  pending[i] = {time_us, pin, level};
+}
+
+void startTransfer() {
+  cut_us = Kernel::clock();
+  upsReturn_us = cut_us + model.transfer_us + random(model.jitter_us);
+  schedule(cut_us, SENSE_MAINS_POWER_PIN, 0);
+  schedule(cut_us + model.holdUp_us, SENSE_UPS_POWER_PIN, 0);
+  schedule(upsReturn_us, SENSE_UPS_POWER_PIN, 1);
+  for (uint8_t i = 0; i < model.bounces; ++i) {
+    int64_t low_us = upsReturn_us + (2 * i + 1) * model.bounceGap_us;
+    schedule(low_us, SENSE_UPS_POWER_PIN, 0);
+    schedule(low_us + model.bounceGap_us, SENSE_UPS_POWER_PIN, 1);
+  }
+}
+
+bool interruptFires(const Interrupt& interrupt, uint8_t level) {
+  if (interrupt.handler == nullptr) {
+    return false;
+  }
+  switch (interrupt.type) {
+    case GPIO_INTR_ANYEDGE:
+      return true;
+    case GPIO_INTR_POSEDGE:
+      return level == 1;
+    case GPIO_INTR_NEGEDGE:
+      return level == 0;
+    default:
+      return false;
+  }
+}
+
+void apply(const PinChange& change) {
+  if (levels[change.pin] == change.level) {
+    return;
+  }
+  levels[change.pin] = change.level;
+  const Interrupt& interrupt = interrupts[change.pin];
+  if (!interruptFires(interrupt, change.level)) {
+    return;
+  }
+  int64_t entry_us
+      = change.time_us > isrIdle_us ? change.time_us : isrIdle_us;
+  Kernel::setClock(entry_us + random(model.isrLatency_us));
+  Kernel::enterIsr();
+  interrupt.handler(interrupt.arg);
+  Kernel::exitIsr();
+  isrIdle_us = Kernel::clock();
+}
+
+}  // namespace
+
+uint8_t readPin(uint8_t pin) { return pin < PIN_COUNT ? levels[pin] : 0; }
+
+void writePin(uint8_t pin, uint8_t level) {
+  if (pin >= PIN_COUNT) {
+    return;
+  }
+  level = level ? 1 : 0;
+  bool cut = pin == UPS_POWER_CUT_PIN && level && !levels[pin];
+  bool restore = pin == UPS_POWER_CUT_PIN && !level && levels[pin];
+  levels[pin] = level;
+  if (cut) {
+    startTransfer();
+  } else if (restore) {
+    schedule(Kernel::clock(), SENSE_MAINS_POWER_PIN, 1);
+  }
+  if (cut || restore) {
+    Kernel::poll();
+  }
+}
+
+void reset(const UpsModel& upsModel, uint32_t seed) {
+  model = upsModel;
+  isrIdle_us = 0;
+  pendingCount = 0;
+  rng = seed ? seed : 1;
+  cut_us = 0;
+  upsReturn_us = 0;
+  for (uint8_t pin = 0; pin < PIN_COUNT; ++pin) {
+    levels[pin] = 0;
+  }
+  levels[SENSE_MAINS_POWER_PIN] = 1;
+  levels[SENSE_UPS_POWER_PIN] = 1;
+  nextCrossing_us = model.mainsPeriod_us
+                        ? Kernel::clock() + model.mainsPeriod_us
+                        : Kernel::NEVER;
+}
+
+int64_t lastCut_us() { return cut_us; }
+
+int64_t lastUpsReturn_us() { return upsReturn_us; }
+
+namespace Kernel {
+
+int64_t nextPinChange_us() {
+  int64_t next = pendingCount > 0 ? pending[0].time_us : NEVER;
+  return nextCrossing_us < next ? nextCrossing_us : next;
+}
+
+void firePinChanges(int64_t time_us) {
+  while (nextPinChange_us() <= time_us) {
+    if (pendingCount == 0 || nextCrossing_us < pending[0].time_us) {
+      // The detector only pulses while there is mains to detect
+      int64_t crossing_us = nextCrossing_us;
+      nextCrossing_us += model.mainsPeriod_us;
+      if (levels[SENSE_MAINS_POWER_PIN]) {
+        schedule(crossing_us, ZERO_CROSS_PIN, 1);
+        schedule(crossing_us + ZERO_CROSS_PULSE_US, ZERO_CROSS_PIN, 0);
+      }
+      continue;
+    }
+    PinChange change = pending[0];
+    for (size_t i = 1; i < pendingCount; ++i) {
+      pending[i - 1] = pending[i];
+    }
+    pendingCount--;
+    setClock(change.time_us);
+    apply(change);
+  }
+}
+
+void setInterruptType(uint8_t pin, uint8_t type) {
+  if (pin < PIN_COUNT) {
+    interrupts[pin].type = type;
+  }
+}
+
+void setInterruptHandler(uint8_t pin, void (*handler)(void*), void* arg) {
+  if (pin < PIN_COUNT) {
+    interrupts[pin].handler = handler;
+    interrupts[pin].arg = arg;
+  }
+}
+
+}  // namespace Kernel
+
+}  // namespace NodeSim
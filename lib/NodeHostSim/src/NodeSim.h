@@ -0,0 +1,60 @@
+#ifndef NODE_SIM_H
+#define NODE_SIM_H
+#include <stdint.h>
+
+// Stand-in for the ESP32 peripherals when the firmware is built with
+// NODE_HOST_SIM: a virtual microsecond clock, virtual GPIO with edge
+// interrupts, and a UPS that reacts to UPS_POWER_CUT_PIN. The FreeRTOS,
+// esp_timer, GPIO driver and Arduino shims in this library all run on it.
+// Time only moves when every task is blocked or when a task reads the
+// clock, so runs are deterministic for a given seed and thousands of
+// transfers take milliseconds.
+namespace NodeSim {
+
+// Reading the clock from a task costs CLOCK_READ_US, so busy-waits on it
+// terminate; interrupt handlers read it for free
+constexpr int64_t CLOCK_READ_US = 1;
+
+int64_t now_us();
+void writePin(uint8_t pin, uint8_t level);
+uint8_t readPin(uint8_t pin);
+
+// Driving UPS_POWER_CUT_PIN high drops SENSE_MAINS_POWER_PIN at once; the
+// UPS output sense drops after holdUp_us and comes back after transfer_us
+// plus up to jitter_us, followed by `bounces` short low pulses. Driving it
+// low brings mains back.
+struct UpsModel {
+  uint32_t transfer_us = 4000;
+  uint32_t jitter_us = 0;
+  uint32_t holdUp_us = 500;
+  uint8_t bounces = 0;
+  uint32_t bounceGap_us = 50;
+  // Interrupt entry delay, up to this much per edge; handlers run one at a
+  // time as on the GPIO ISR service
+  uint32_t isrLatency_us = 0;
+  // Zero-crossing pulses on ZERO_CROSS_PIN while mains is present, zero for
+  // none
+  uint32_t mainsPeriod_us = 0;
+};
+
+// Mains and UPS output present, the new model in place, pending pin changes
+// dropped. The clock keeps running and tasks, timers and interrupt handlers
+// stay, like a UPS swapped on a running node.
+void reset(const UpsModel& model, uint32_t seed = 1);
+// Blocks the caller until time_us, like vTaskDelay() to the microsecond:
+// the tasks run meanwhile and pin changes fire their handlers
+void advanceTo(int64_t time_us);
+void advanceBy(int64_t delta_us);
+
+// Where the model put the last transfer, the reference for measurements
+int64_t lastCut_us();
+int64_t lastUpsReturn_us();
+
+// Serial output to stdout, off by default
+void echoSerial(bool enabled);
+// Empties the NVS and LittleFS stand-ins, like a fresh flash
+void eraseFlash();
+
+}  // namespace NodeSim
+
+#endif  // NODE_SIM_H
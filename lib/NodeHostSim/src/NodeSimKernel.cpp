@@ -0,0 +1,629 @@
+#include "NodeSimKernel.h"
+#include "NodeSim.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+using NodeSim::Kernel::NEVER;
+
+// Each task is a host thread that only runs while it holds the simulated
+// CPU; handing the CPU over is the only place threads synchronise
+struct NodeSimTask {
+  std::condition_variable cpu;
+  std::string name;
+  UBaseType_t priority = 0;
+  uint32_t stackDepth = 0;
+  TaskFunction_t code = nullptr;
+  void* parameters = nullptr;
+  bool deleted = false;
+  bool blocked = false;
+  uint64_t readySince = 0;  // FIFO order among equal priorities
+  const void* waitObject = nullptr;
+  int64_t deadline_us = NEVER;
+  bool woken = false;
+  uint32_t notifyCount = 0;
+  // xEventGroupWaitBits() in progress
+  EventBits_t waitBits = 0;
+  bool waitAll = false;
+  bool clearOnExit = false;
+  bool bitsMet = false;
+  EventBits_t bitsOnRelease = 0;
+};
+
+struct NodeSimQueue {
+  size_t length;
+  size_t itemSize;
+  std::deque<std::vector<uint8_t>> items;
+};
+
+struct NodeSimEventGroup {
+  EventBits_t bits = 0;
+};
+
+namespace NodeSim {
+namespace Kernel {
+
+namespace {
+
+constexpr int64_t TICK_US = 1000000 / configTICK_RATE_HZ;
+constexpr UBaseType_t MAIN_PRIORITY = 1;  // Arduino loopTask
+
+// Never destroyed: task threads are still parked in here at exit
+struct State {
+  std::mutex lock;
+  std::vector<NodeSimTask*> tasks;
+  NodeSimTask* current = nullptr;
+  uint64_t sequence = 0;
+  int64_t clock_us = 0;
+  int isrDepth = 0;
+  int criticalDepth = 0;
+};
+
+State& state() {
+  static State* s = new State();
+  return *s;
+}
+
+void makeReady(NodeSimTask* task) {
+  task->blocked = false;
+  task->readySince = ++state().sequence;
+}
+
+// The thread calling into the kernel first, the host main(), becomes a task
+// of its own
+NodeSimTask* running() {
+  State& s = state();
+  if (s.current == nullptr) {
+    NodeSimTask* task = new NodeSimTask();
+    task->name = "main";
+    task->priority = MAIN_PRIORITY;
+    makeReady(task);
+    s.tasks.push_back(task);
+    s.current = task;
+  }
+  return s.current;
+}
+
+NodeSimTask* pickReady() {
+  NodeSimTask* best = nullptr;
+  for (NodeSimTask* task : state().tasks) {
+    if (task->deleted || task->blocked) {
+      continue;
+    }
+    if (best == nullptr || task->priority > best->priority
+        || (task->priority == best->priority
+            && task->readySince < best->readySince)) {
+      best = task;
+    }
+  }
+  return best;
+}
+
+bool higherPriorityReady() {
+  NodeSimTask* best = pickReady();
+  return best != nullptr && best->priority > running()->priority;
+}
+
+void switchTo(NodeSimTask* next) {
+  State& s = state();
+  NodeSimTask* self = s.current;
+  if (next == self) {
+    return;
+  }
+  std::unique_lock<std::mutex> guard(s.lock);
+  s.current = next;
+  next->cpu.notify_one();
+  self->cpu.wait(guard, [&] { return s.current == self; });
+}
+
+int64_t nextDeadline() {
+  int64_t next = NEVER;
+  for (NodeSimTask* task : state().tasks) {
+    if (task->blocked && !task->deleted && task->deadline_us < next) {
+      next = task->deadline_us;
+    }
+  }
+  return next;
+}
+
+void expireDeadlines() {
+  for (NodeSimTask* task : state().tasks) {
+    if (task->blocked && !task->deleted
+        && task->deadline_us <= state().clock_us) {
+      task->woken = false;
+      makeReady(task);
+    }
+  }
+}
+
+// Timeouts and pin changes in time order up to time_us
+void advance(int64_t time_us) {
+  State& s = state();
+  while (true) {
+    int64_t next = nextPinChange_us();
+    int64_t deadline = nextDeadline();
+    if (deadline < next) {
+      next = deadline;
+    }
+    if (next > time_us) {
+      break;
+    }
+    setClock(next);
+    expireDeadlines();
+    firePinChanges(s.clock_us);
+  }
+  setClock(time_us);
+}
+
+[[noreturn]] void deadlock() {
+  fprintf(stderr, "NodeSim: every task is blocked with nothing to wake it\n");
+  for (NodeSimTask* task : state().tasks) {
+    if (!task->deleted) {
+      fprintf(stderr, "  %-20s priority %u\n", task->name.c_str(),
+              task->priority);
+    }
+  }
+  abort();
+}
+
+// Runs the best ready task; with none ready the clock jumps to the next
+// event, on the thread of the task giving up the CPU
+void reschedule() {
+  while (true) {
+    NodeSimTask* next = pickReady();
+    if (next != nullptr) {
+      switchTo(next);
+      return;
+    }
+    int64_t event = nextPinChange_us();
+    int64_t deadline = nextDeadline();
+    if (deadline < event) {
+      event = deadline;
+    }
+    if (event == NEVER) {
+      deadlock();
+    }
+    advance(event > state().clock_us ? event : state().clock_us);
+  }
+}
+
+void taskEntry(NodeSimTask* task) {
+  {
+    std::unique_lock<std::mutex> guard(state().lock);
+    task->cpu.wait(guard, [&] { return state().current == task; });
+  }
+  task->code(task->parameters);
+  // A FreeRTOS task must not return; treat it as deleting itself
+  vTaskDelete(NULL);
+}
+
+int64_t tickDeadline(TickType_t ticks) {
+  if (ticks == portMAX_DELAY) {
+    return NEVER;
+  }
+  return (state().clock_us / TICK_US + ticks) * TICK_US;
+}
+
+// Blocks on object until ready() holds or the ticks run out
+template <typename Ready>
+bool waitUntil(const void* object, TickType_t ticks, Ready ready) {
+  const int64_t deadline = tickDeadline(ticks);
+  while (!ready()) {
+    if (state().clock_us >= deadline) {
+      return false;
+    }
+    waitOn(object, deadline);
+  }
+  return true;
+}
+
+bool queuePut(NodeSimQueue* queue, const void* item) {
+  if (queue->items.size() >= queue->length) {
+    return false;
+  }
+  const uint8_t* bytes = static_cast<const uint8_t*>(item);
+  queue->items.emplace_back(bytes, bytes + (item ? queue->itemSize : 0));
+  wake(queue);
+  return true;
+}
+
+bool queueGet(NodeSimQueue* queue, void* buffer) {
+  if (queue->items.empty()) {
+    return false;
+  }
+  if (buffer != nullptr && queue->itemSize > 0) {
+    memcpy(buffer, queue->items.front().data(), queue->itemSize);
+  }
+  queue->items.pop_front();
+  wake(&queue->items);
+  return true;
+}
+
+bool bitsMet(EventBits_t bits, EventBits_t waitBits, bool waitAll) {
+  return waitAll ? (bits & waitBits) == waitBits : (bits & waitBits) != 0;
+}
+
+EventBits_t setBits(NodeSimEventGroup* group, EventBits_t bits) {
+  group->bits |= bits;
+  EventBits_t clear = 0;
+  for (NodeSimTask* task : state().tasks) {
+    if (!task->blocked || task->deleted || task->waitObject != group
+        || !bitsMet(group->bits, task->waitBits, task->waitAll)) {
+      continue;
+    }
+    task->bitsMet = true;
+    task->bitsOnRelease = group->bits;
+    if (task->clearOnExit) {
+      clear |= task->waitBits;
+    }
+    task->woken = true;
+    makeReady(task);
+  }
+  group->bits &= ~clear;
+  return group->bits;
+}
+
+}  // namespace
+
+int64_t clock() { return state().clock_us; }
+
+void setClock(int64_t time_us) {
+  if (time_us > state().clock_us) {
+    state().clock_us = time_us;
+  }
+}
+
+bool inIsr() { return state().isrDepth > 0; }
+
+bool inCritical() { return state().criticalDepth > 0; }
+
+void enterIsr() { state().isrDepth++; }
+
+void exitIsr() { state().isrDepth--; }
+
+bool waitOn(const void* object, int64_t deadline_us) {
+  if (inIsr() || inCritical()) {
+    fprintf(stderr, "NodeSim: blocking call from an ISR or critical section\n");
+    abort();
+  }
+  NodeSimTask* self = running();
+  self->blocked = true;
+  self->waitObject = object;
+  self->deadline_us = deadline_us;
+  self->woken = false;
+  reschedule();
+  self->waitObject = nullptr;
+  self->deadline_us = NEVER;
+  return self->woken;
+}
+
+void wake(const void* object) {
+  for (NodeSimTask* task : state().tasks) {
+    if (task->blocked && !task->deleted && task->waitObject == object) {
+      task->woken = true;
+      makeReady(task);
+    }
+  }
+}
+
+void preempt() {
+  if (inIsr() || inCritical()) {
+    return;
+  }
+  if (higherPriorityReady()) {
+    makeReady(running());
+    reschedule();
+  }
+}
+
+void poll() {
+  if (inIsr() || inCritical()) {
+    return;
+  }
+  running();
+  advance(state().clock_us);
+  preempt();
+}
+
+}  // namespace Kernel
+
+int64_t now_us() {
+  Kernel::State& s = Kernel::state();
+  if (s.isrDepth > 0) {
+    return s.clock_us;
+  }
+  Kernel::running();
+  if (s.criticalDepth > 0) {
+    s.clock_us += CLOCK_READ_US;
+    return s.clock_us;
+  }
+  Kernel::advance(s.clock_us + CLOCK_READ_US);
+  const int64_t now = s.clock_us;
+  Kernel::preempt();
+  return now;
+}
+
+void advanceTo(int64_t time_us) {
+  Kernel::running();
+  while (Kernel::clock() < time_us) {
+    Kernel::waitOn(nullptr, time_us);
+  }
+}
+
+void advanceBy(int64_t delta_us) { advanceTo(Kernel::clock() + delta_us); }
+
+}  // namespace NodeSim
+
+using namespace NodeSim::Kernel;
+
+void vPortEnterCritical(portMUX_TYPE* mux) {
+  mux->count++;
+  state().criticalDepth++;
+}
+
+void vPortExitCritical(portMUX_TYPE* mux) {
+  mux->count--;
+  if (--state().criticalDepth == 0) {
+    poll();
+  }
+}
+
+void vPortYield() {
+  if (inIsr() || inCritical()) {
+    return;
+  }
+  makeReady(running());
+  reschedule();
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t pvTaskCode,
+                                   const char* pcName,
+                                   uint32_t usStackDepth, void* pvParameters,
+                                   UBaseType_t uxPriority,
+                                   TaskHandle_t* pvCreatedTask,
+                                   BaseType_t xCoreID) {
+  running();
+  NodeSimTask* task = new NodeSimTask();
+  task->name = pcName ? pcName : "";
+  task->priority = uxPriority;
+  task->stackDepth = usStackDepth;
+  task->code = pvTaskCode;
+  task->parameters = pvParameters;
+  makeReady(task);
+  state().tasks.push_back(task);
+  if (pvCreatedTask != NULL) {
+    *pvCreatedTask = task;
+  }
+  std::thread(taskEntry, task).detach();
+  preempt();
+  return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t xTaskToDelete) {
+  NodeSimTask* self = running();
+  NodeSimTask* task = xTaskToDelete ? xTaskToDelete : self;
+  task->deleted = true;
+  if (task == self) {
+    reschedule();  // Never comes back, the thread stays parked
+  }
+}
+
+void vTaskDelay(TickType_t xTicksToDelay) {
+  if (xTicksToDelay == 0) {
+    vPortYield();
+    return;
+  }
+  running();
+  const int64_t deadline = tickDeadline(xTicksToDelay);
+  while (NodeSim::Kernel::clock() < deadline) {
+    waitOn(nullptr, deadline);
+  }
+}
+
+TickType_t xTaskGetTickCount() {
+  return static_cast<TickType_t>(NodeSim::Kernel::clock() / TICK_US);
+}
+
+TickType_t xTaskGetTickCountFromISR() { return xTaskGetTickCount(); }
+
+TaskHandle_t xTaskGetCurrentTaskHandle() { return running(); }
+
+const char* pcTaskGetName(TaskHandle_t xTaskToQuery) {
+  return (xTaskToQuery ? xTaskToQuery : running())->name.c_str();
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t xTask) {
+  return (xTask ? xTask : running())->stackDepth;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t xClearCountOnExit,
+                          TickType_t xTicksToWait) {
+  NodeSimTask* self = running();
+  waitUntil(&self->notifyCount, xTicksToWait,
+            [&] { return self->notifyCount != 0; });
+  const uint32_t count = self->notifyCount;
+  if (count != 0) {
+    self->notifyCount = xClearCountOnExit ? 0 : count - 1;
+  }
+  return count;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t xTaskToNotify) {
+  xTaskToNotify->notifyCount++;
+  wake(&xTaskToNotify->notifyCount);
+  preempt();
+  return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t xTaskToNotify,
+                            BaseType_t* pxHigherPriorityTaskWoken) {
+  xTaskToNotify->notifyCount++;
+  wake(&xTaskToNotify->notifyCount);
+  if (pxHigherPriorityTaskWoken != NULL && higherPriorityReady()) {
+    *pxHigherPriorityTaskWoken = pdTRUE;
+  }
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t uxQueueLength, UBaseType_t uxItemSize) {
+  NodeSimQueue* queue = new NodeSimQueue();
+  queue->length = uxQueueLength;
+  queue->itemSize = uxItemSize;
+  return queue;
+}
+
+QueueHandle_t xQueueCreateStatic(UBaseType_t uxQueueLength,
+                                 UBaseType_t uxItemSize,
+                                 uint8_t* pucQueueStorageBuffer,
+                                 StaticQueue_t* pxQueueBuffer) {
+  return xQueueCreate(uxQueueLength, uxItemSize);
+}
+
+void vQueueDelete(QueueHandle_t xQueue) { delete xQueue; }
+
+BaseType_t xQueueSend(QueueHandle_t xQueue, const void* pvItemToQueue,
+                      TickType_t xTicksToWait) {
+  running();
+  bool space = waitUntil(&xQueue->items, xTicksToWait, [&] {
+    return xQueue->items.size() < xQueue->length;
+  });
+  if (!space) {
+    return errQUEUE_FULL;
+  }
+  queuePut(xQueue, pvItemToQueue);
+  preempt();
+  return pdPASS;
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t xQueue, const void* pvItemToQueue,
+                             BaseType_t* pxHigherPriorityTaskWoken) {
+  if (!queuePut(xQueue, pvItemToQueue)) {
+    return errQUEUE_FULL;
+  }
+  if (pxHigherPriorityTaskWoken != NULL && higherPriorityReady()) {
+    *pxHigherPriorityTaskWoken = pdTRUE;
+  }
+  return pdPASS;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t xQueue, void* pvBuffer,
+                         TickType_t xTicksToWait) {
+  running();
+  if (!waitUntil(xQueue, xTicksToWait,
+                 [&] { return !xQueue->items.empty(); })) {
+    return pdFALSE;
+  }
+  queueGet(xQueue, pvBuffer);
+  preempt();
+  return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t xQueue) {
+  return static_cast<UBaseType_t>(xQueue->items.size());
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary() { return xQueueCreate(1, 0); }
+
+SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t* pxBuffer) {
+  return xSemaphoreCreateBinary();
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex() {
+  SemaphoreHandle_t mutex = xQueueCreate(1, 0);
+  mutex->items.emplace_back();
+  return mutex;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t* pxBuffer) {
+  return xSemaphoreCreateMutex();
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t xSemaphore,
+                          TickType_t xBlockTime) {
+  return xQueueReceive(xSemaphore, NULL, xBlockTime);
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t xSemaphore) {
+  return xQueueSend(xSemaphore, NULL, 0);
+}
+
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t xSemaphore,
+                                 BaseType_t* pxHigherPriorityTaskWoken) {
+  return xQueueSendFromISR(xSemaphore, NULL, pxHigherPriorityTaskWoken);
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t xSemaphore) {
+  vQueueDelete(xSemaphore);
+}
+
+EventGroupHandle_t xEventGroupCreate() { return new NodeSimEventGroup(); }
+
+EventGroupHandle_t xEventGroupCreateStatic(
+    StaticEventGroup_t* pxEventGroupBuffer) {
+  return xEventGroupCreate();
+}
+
+void vEventGroupDelete(EventGroupHandle_t xEventGroup) { delete xEventGroup; }
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t xEventGroup,
+                                EventBits_t uxBitsToWaitFor,
+                                BaseType_t xClearOnExit,
+                                BaseType_t xWaitForAllBits,
+                                TickType_t xTicksToWait) {
+  NodeSimTask* self = running();
+  const EventBits_t bits = xEventGroup->bits;
+  if (bitsMet(bits, uxBitsToWaitFor, xWaitForAllBits)) {
+    if (xClearOnExit) {
+      xEventGroup->bits &= ~uxBitsToWaitFor;
+    }
+    return bits;
+  }
+  self->waitBits = uxBitsToWaitFor;
+  self->waitAll = xWaitForAllBits;
+  self->clearOnExit = xClearOnExit;
+  self->bitsMet = false;
+  const int64_t deadline = tickDeadline(xTicksToWait);
+  while (!self->bitsMet && NodeSim::Kernel::clock() < deadline) {
+    waitOn(xEventGroup, deadline);
+  }
+  return self->bitsMet ? self->bitsOnRelease : xEventGroup->bits;
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t xEventGroup,
+                               EventBits_t uxBitsToSet) {
+  running();
+  EventBits_t bits = setBits(xEventGroup, uxBitsToSet);
+  preempt();
+  return bits;
+}
+
+BaseType_t xEventGroupSetBitsFromISR(EventGroupHandle_t xEventGroup,
+                                     EventBits_t uxBitsToSet,
+                                     BaseType_t* pxHigherPriorityTaskWoken) {
+  setBits(xEventGroup, uxBitsToSet);
+  if (pxHigherPriorityTaskWoken != NULL && higherPriorityReady()) {
+    *pxHigherPriorityTaskWoken = pdTRUE;
+  }
+  return pdPASS;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t xEventGroup,
+                                 EventBits_t uxBitsToClear) {
+  const EventBits_t bits = xEventGroup->bits;
+  xEventGroup->bits &= ~uxBitsToClear;
+  return bits;
+}
+
+EventBits_t xEventGroupGetBits(EventGroupHandle_t xEventGroup) {
+  return xEventGroup->bits;
+}
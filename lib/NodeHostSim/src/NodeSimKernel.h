@@ -0,0 +1,42 @@
+#ifndef NODE_SIM_KERNEL_H
+#define NODE_SIM_KERNEL_H
+#include <stdint.h>
+
+// Between the scheduler and the peripheral models of the host simulation.
+// Only the task holding the CPU calls in here, so none of it needs locking.
+namespace NodeSim {
+namespace Kernel {
+
+constexpr int64_t NEVER = INT64_MAX;
+
+int64_t clock();
+// Moves the clock forward to time_us, never back
+void setClock(int64_t time_us);
+bool inIsr();
+bool inCritical();
+void enterIsr();
+void exitIsr();
+
+// Blocks the running task until wake(object) or the clock reaches
+// deadline_us; true when woken
+bool waitOn(const void* object, int64_t deadline_us);
+// Readies every task blocked in waitOn(object)
+void wake(const void* object);
+// Hands the CPU to a higher-priority ready task, outside ISRs and critical
+// sections
+void preempt();
+// Takes the pin changes due by now, then preempt(). For peripheral writes,
+// so the interrupts they cause fire straight away.
+void poll();
+
+// Peripheral side, implemented in NodeSim.cpp: the next pin change, firing
+// the ones due by time_us, and the interrupt set up by the GPIO driver
+int64_t nextPinChange_us();
+void firePinChanges(int64_t time_us);
+void setInterruptType(uint8_t pin, uint8_t type);
+void setInterruptHandler(uint8_t pin, void (*handler)(void*), void* arg);
+
+}  // namespace Kernel
+}  // namespace NodeSim
+
+#endif  // NODE_SIM_KERNEL_H
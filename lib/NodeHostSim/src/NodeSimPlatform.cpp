@@ -0,0 +1,517 @@
+#include "Arduino.h"
+#include "LittleFS.h"
+#include "NodeSim.h"
+#include "NodeSimKernel.h"
+#include "driver/gpio.h"
+#include "esp_rom_crc.h"
+#include "esp_timer.h"
+#include "nvs.h"
+#include <map>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+using NodeSim::Kernel::NEVER;
+
+// esp_timer
+
+struct esp_timer {
+  esp_timer_cb_t callback;
+  void* arg;
+  int64_t expiry_us = NEVER;
+  uint64_t period_us = 0;
+};
+
+namespace {
+
+// Above every firmware task, like the esp_timer task on the node
+constexpr UBaseType_t ESP_TIMER_TASK_PRIORITY = 22;
+
+std::vector<esp_timer*>& timers() {
+  static std::vector<esp_timer*>* list = new std::vector<esp_timer*>();
+  return *list;
+}
+
+esp_timer* nextTimer() {
+  esp_timer* next = nullptr;
+  for (esp_timer* timer : timers()) {
+    if (next == nullptr || timer->expiry_us < next->expiry_us) {
+      next = timer;
+    }
+  }
+  return next;
+}
+
+void timerTask(void* parameters) {
+  while (true) {
+    esp_timer* timer = nextTimer();
+    int64_t expiry = timer ? timer->expiry_us : NEVER;
+    if (expiry > NodeSim::Kernel::clock()) {
+      NodeSim::Kernel::waitOn(&timers(), expiry);
+      continue;
+    }
+    timer->expiry_us
+        = timer->period_us ? expiry + timer->period_us : NEVER;
+    timer->callback(timer->arg);
+  }
+}
+
+esp_err_t arm(esp_timer_handle_t timer, uint64_t timeout_us,
+              uint64_t period_us) {
+  if (timer->expiry_us != NEVER) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  static TaskHandle_t task = nullptr;
+  if (task == nullptr) {
+    xTaskCreatePinnedToCore(timerTask, "esp_timer", 4096, NULL,
+                            ESP_TIMER_TASK_PRIORITY, &task, 0);
+  }
+  timer->expiry_us = NodeSim::Kernel::clock() + timeout_us;
+  timer->period_us = period_us;
+  NodeSim::Kernel::wake(&timers());
+  NodeSim::Kernel::preempt();
+  return ESP_OK;
+}
+
+}  // namespace
+
+int64_t esp_timer_get_time() { return NodeSim::now_us(); }
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t* args,
+                           esp_timer_handle_t* out_handle) {
+  if (args == NULL || args->callback == NULL || out_handle == NULL) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  esp_timer* timer = new esp_timer();
+  timer->callback = args->callback;
+  timer->arg = args->arg;
+  timers().push_back(timer);
+  *out_handle = timer;
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us) {
+  return arm(timer, timeout_us, 0);
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer,
+                                   uint64_t period_us) {
+  return arm(timer, period_us, period_us);
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+  if (timer->expiry_us == NEVER) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  timer->expiry_us = NEVER;
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer) {
+  if (timer->expiry_us != NEVER) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  std::vector<esp_timer*>& list = timers();
+  for (size_t i = 0; i < list.size(); ++i) {
+    if (list[i] == timer) {
+      list.erase(list.begin() + i);
+      break;
+    }
+  }
+  delete timer;
+  return ESP_OK;
+}
+
+// GPIO driver
+
+esp_err_t gpio_set_direction(gpio_num_t gpio_num, gpio_mode_t mode) {
+  return ESP_OK;
+}
+
+esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level) {
+  NodeSim::writePin(gpio_num, level);
+  return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t gpio_num) { return NodeSim::readPin(gpio_num); }
+
+esp_err_t gpio_set_intr_type(gpio_num_t gpio_num, gpio_int_type_t intr_type) {
+  NodeSim::Kernel::setInterruptType(gpio_num, intr_type);
+  return ESP_OK;
+}
+
+esp_err_t gpio_install_isr_service(int intr_alloc_flags) { return ESP_OK; }
+
+esp_err_t gpio_isr_handler_add(gpio_num_t gpio_num, gpio_isr_t isr_handler,
+                               void* args) {
+  NodeSim::Kernel::setInterruptHandler(gpio_num, isr_handler, args);
+  return ESP_OK;
+}
+
+esp_err_t gpio_isr_handler_remove(gpio_num_t gpio_num) {
+  NodeSim::Kernel::setInterruptHandler(gpio_num, nullptr, nullptr);
+  return ESP_OK;
+}
+
+// NVS
+
+namespace {
+
+std::vector<std::string>& nvsNamespaces() {
+  static std::vector<std::string>* names = new std::vector<std::string>();
+  return *names;
+}
+
+std::map<std::string, std::vector<uint8_t>>& nvsBlobs() {
+  static auto* blobs = new std::map<std::string, std::vector<uint8_t>>();
+  return *blobs;
+}
+
+bool nvsKey(nvs_handle_t handle, const char* key, std::string* out) {
+  if (handle == 0 || handle > nvsNamespaces().size() || key == NULL) {
+    return false;
+  }
+  *out = nvsNamespaces()[handle - 1] + '/' + key;
+  return true;
+}
+
+}  // namespace
+
+esp_err_t nvs_open(const char* name, nvs_open_mode_t open_mode,
+                   nvs_handle_t* out_handle) {
+  std::vector<std::string>& names = nvsNamespaces();
+  for (size_t i = 0; i < names.size(); ++i) {
+    if (names[i] == name) {
+      *out_handle = i + 1;
+      return ESP_OK;
+    }
+  }
+  names.push_back(name);
+  *out_handle = names.size();
+  return ESP_OK;
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char* key, void* out_value,
+                       size_t* length) {
+  std::string path;
+  if (!nvsKey(handle, key, &path)) {
+    return ESP_ERR_NVS_INVALID_HANDLE;
+  }
+  auto blob = nvsBlobs().find(path);
+  if (blob == nvsBlobs().end()) {
+    return ESP_ERR_NVS_NOT_FOUND;
+  }
+  if (out_value == NULL) {
+    *length = blob->second.size();
+    return ESP_OK;
+  }
+  if (*length < blob->second.size()) {
+    return ESP_ERR_NVS_INVALID_LENGTH;
+  }
+  memcpy(out_value, blob->second.data(), blob->second.size());
+  *length = blob->second.size();
+  return ESP_OK;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char* key, const void* value,
+                       size_t length) {
+  std::string path;
+  if (!nvsKey(handle, key, &path)) {
+    return ESP_ERR_NVS_INVALID_HANDLE;
+  }
+  const uint8_t* bytes = static_cast<const uint8_t*>(value);
+  nvsBlobs()[path].assign(bytes, bytes + length);
+  return ESP_OK;
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char* key) {
+  std::string path;
+  if (!nvsKey(handle, key, &path)) {
+    return ESP_ERR_NVS_INVALID_HANDLE;
+  }
+  return nvsBlobs().erase(path) ? ESP_OK : ESP_ERR_NVS_NOT_FOUND;
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle) { return ESP_OK; }
+
+void nvs_close(nvs_handle_t handle) {}
+
+uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t* buf, uint32_t len) {
+  crc = ~crc;
+  for (uint32_t i = 0; i < len; ++i) {
+    crc ^= buf[i];
+    for (int bit = 0; bit < 8; ++bit) {
+      crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+    }
+  }
+  return ~crc;
+}
+
+// Arduino core
+
+namespace {
+
+constexpr uint8_t LEDC_CHANNELS = 16;
+uint32_t ledcDuty[LEDC_CHANNELS];
+bool serialEcho = false;
+
+}  // namespace
+
+HardwareSerial Serial;
+
+void pinMode(uint8_t pin, uint8_t mode) {}
+
+void digitalWrite(uint8_t pin, uint8_t val) { NodeSim::writePin(pin, val); }
+
+int digitalRead(uint8_t pin) { return NodeSim::readPin(pin); }
+
+unsigned long millis() { return NodeSim::now_us() / 1000; }
+
+unsigned long micros() { return NodeSim::now_us(); }
+
+void delay(uint32_t ms) { vTaskDelay(pdMS_TO_TICKS(ms)); }
+
+void delayMicroseconds(uint32_t us) {
+  NodeSim::advanceTo(NodeSim::now_us() + us);
+}
+
+uint32_t ledcSetup(uint8_t chan, uint32_t freq, uint8_t bit_num) {
+  return freq;
+}
+
+void ledcWrite(uint8_t chan, uint32_t duty) {
+  if (chan < LEDC_CHANNELS) {
+    ledcDuty[chan] = duty;
+  }
+}
+
+uint32_t ledcRead(uint8_t chan) {
+  return chan < LEDC_CHANNELS ? ledcDuty[chan] : 0;
+}
+
+void ledcAttachPin(uint8_t pin, uint8_t chan) {}
+
+void HardwareSerial::begin(unsigned long baud, uint32_t config, int8_t rxPin,
+                           int8_t txPin) {}
+
+void HardwareSerial::flush() {
+  if (serialEcho) {
+    fflush(stdout);
+  }
+}
+
+size_t HardwareSerial::write(uint8_t c) { return write(&c, 1); }
+
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size) {
+  if (serialEcho) {
+    fwrite(buffer, 1, size, stdout);
+  }
+  return size;
+}
+
+size_t HardwareSerial::print(const char* s) {
+  return write(reinterpret_cast<const uint8_t*>(s), strlen(s));
+}
+
+size_t HardwareSerial::print(char c) { return write(c); }
+
+size_t HardwareSerial::print(int n, int base) {
+  return print((long long)n, base);
+}
+
+size_t HardwareSerial::print(unsigned int n, int base) {
+  return print((unsigned long long)n, base);
+}
+
+size_t HardwareSerial::print(long n, int base) {
+  return print((long long)n, base);
+}
+
+size_t HardwareSerial::print(unsigned long n, int base) {
+  return print((unsigned long long)n, base);
+}
+
+size_t HardwareSerial::print(long long n, int base) {
+  if (n < 0 && base == DEC) {
+    return print('-') + print((unsigned long long)-n, base);
+  }
+  return print((unsigned long long)n, base);
+}
+
+size_t HardwareSerial::print(unsigned long long n, int base) {
+  char buffer[24];
+  snprintf(buffer, sizeof(buffer), base == HEX ? "%llX" : "%llu", n);
+  return print(buffer);
+}
+
+size_t HardwareSerial::print(double n, int digits) {
+  char buffer[48];
+  snprintf(buffer, sizeof(buffer), "%.*f", digits, n);
+  return print(buffer);
+}
+
+// LittleFS
+
+namespace {
+
+constexpr size_t FS_TOTAL_BYTES = 1024 * 1024;
+
+std::map<std::string, std::shared_ptr<std::vector<uint8_t>>>& files() {
+  static auto* map
+      = new std::map<std::string, std::shared_ptr<std::vector<uint8_t>>>();
+  return *map;
+}
+
+}  // namespace
+
+fs::LittleFSFS LittleFS;
+
+namespace fs {
+
+size_t File::write(uint8_t c) { return write(&c, 1); }
+
+size_t File::write(const uint8_t* buf, size_t size) {
+  if (!_data || !_writable) {
+    return 0;
+  }
+  if (_data->size() < _pos + size) {
+    _data->resize(_pos + size);
+  }
+  memcpy(_data->data() + _pos, buf, size);
+  _pos += size;
+  return size;
+}
+
+size_t File::print(const char* s) {
+  return write(reinterpret_cast<const uint8_t*>(s), strlen(s));
+}
+
+size_t File::printf(const char* format, ...) {
+  va_list args;
+  va_start(args, format);
+  int length = vsnprintf(nullptr, 0, format, args);
+  va_end(args);
+  if (length <= 0) {
+    return 0;
+  }
+  std::vector<char> buffer(length + 1);
+  va_start(args, format);
+  vsnprintf(buffer.data(), buffer.size(), format, args);
+  va_end(args);
+  return write(reinterpret_cast<const uint8_t*>(buffer.data()), length);
+}
+
+int File::read() {
+  uint8_t c;
+  return read(&c, 1) == 1 ? c : -1;
+}
+
+size_t File::read(uint8_t* buf, size_t size) {
+  if (!_data || _pos >= _data->size()) {
+    return 0;
+  }
+  size_t count = _data->size() - _pos;
+  if (count > size) {
+    count = size;
+  }
+  memcpy(buf, _data->data() + _pos, count);
+  _pos += count;
+  return count;
+}
+
+size_t File::readBytes(char* buffer, size_t length) {
+  return read(reinterpret_cast<uint8_t*>(buffer), length);
+}
+
+int File::peek() {
+  if (!_data || _pos >= _data->size()) {
+    return -1;
+  }
+  return (*_data)[_pos];
+}
+
+int File::available() {
+  return _data && _pos < _data->size() ? _data->size() - _pos : 0;
+}
+
+bool File::seek(uint32_t pos) {
+  if (!_data || pos > _data->size()) {
+    return false;
+  }
+  _pos = pos;
+  return true;
+}
+
+size_t File::size() const { return _data ? _data->size() : 0; }
+
+void File::close() {
+  _data.reset();
+  _pos = 0;
+  _writable = false;
+}
+
+File FS::open(const char* path, const char* mode, bool create) {
+  File file;
+  auto entry = files().find(path);
+  if (mode[0] == 'r') {
+    if (entry != files().end()) {
+      file._data = entry->second;
+    }
+    return file;
+  }
+  if (entry == files().end() || mode[0] == 'w') {
+    files()[path] = std::make_shared<std::vector<uint8_t>>();
+  }
+  file._data = files()[path];
+  file._writable = true;
+  file._pos = mode[0] == 'a' ? file._data->size() : 0;
+  return file;
+}
+
+bool FS::exists(const char* path) { return files().count(path) != 0; }
+
+bool FS::remove(const char* path) { return files().erase(path) != 0; }
+
+bool FS::rename(const char* pathFrom, const char* pathTo) {
+  auto entry = files().find(pathFrom);
+  if (entry == files().end()) {
+    return false;
+  }
+  files()[pathTo] = entry->second;
+  files().erase(pathFrom);
+  return true;
+}
+
+bool LittleFSFS::begin(bool formatOnFail, const char* basePath,
+                       uint8_t maxOpenFiles, const char* partitionLabel) {
+  return true;
+}
+
+bool LittleFSFS::format() {
+  files().clear();
+  return true;
+}
+
+size_t LittleFSFS::totalBytes() { return FS_TOTAL_BYTES; }
+
+size_t LittleFSFS::usedBytes() {
+  size_t used = 0;
+  for (const auto& file : files()) {
+    used += file.second->size();
+  }
+  return used;
+}
+
+}  // namespace fs
+
+namespace NodeSim {
+
+void echoSerial(bool enabled) { serialEcho = enabled; }
+
+void eraseFlash() {
+  nvsBlobs().clear();
+  files().clear();
+}
+
+}  // namespace NodeSim
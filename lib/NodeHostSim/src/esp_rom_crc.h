@@ -0,0 +1,9 @@
+#ifndef ESP_ROM_CRC_H
+#define ESP_ROM_CRC_H
+#include <stdint.h>
+
+// Same polynomial and conditioning as the ROM routine, so images written on
+// the host check out on the node and the other way round
+uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t* buf, uint32_t len);
+
+#endif  // ESP_ROM_CRC_H
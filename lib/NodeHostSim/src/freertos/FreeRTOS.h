@@ -0,0 +1,86 @@
+#ifndef FREERTOS_H
+#define FREERTOS_H
+#include "esp_attr.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Host stand-in for the FreeRTOS kernel as the firmware uses it, backed by
+// the scheduler in NodeSimKernel.cpp. Tasks are host threads, but only one
+// runs at a time: the highest-priority ready one, preempting on wake-up as
+// on a single core. Time only moves when every task is blocked (the clock
+// jumps to the next timeout or pin change) or when a task reads the clock,
+// so runs are deterministic and a simulated second takes microseconds.
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+typedef uint32_t StackType_t;
+typedef uint32_t EventBits_t;
+
+typedef struct NodeSimTask* TaskHandle_t;
+typedef struct NodeSimQueue* QueueHandle_t;
+typedef QueueHandle_t SemaphoreHandle_t;
+typedef struct NodeSimEventGroup* EventGroupHandle_t;
+
+// Storage for the static creation calls; the host allocates anyway
+typedef struct {
+  void* reserved[8];
+} StaticQueue_t;
+typedef StaticQueue_t StaticSemaphore_t;
+typedef struct {
+  void* reserved[4];
+} StaticEventGroup_t;
+typedef struct {
+  void* reserved[16];
+} StaticTask_t;
+
+#define pdFALSE ((BaseType_t)0)
+#define pdTRUE ((BaseType_t)1)
+#define pdFAIL pdFALSE
+#define pdPASS pdTRUE
+#define errQUEUE_EMPTY ((BaseType_t)0)
+#define errQUEUE_FULL ((BaseType_t)0)
+
+#define configTICK_RATE_HZ 1000
+#define portTICK_PERIOD_MS ((TickType_t)1000 / configTICK_RATE_HZ)
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+#define pdMS_TO_TICKS(xTimeInMs) \
+  ((TickType_t)(((uint64_t)(xTimeInMs) * configTICK_RATE_HZ) / 1000U))
+#define tskNO_AFFINITY ((BaseType_t)0x7FFFFFFF)
+
+// esp_bit_defs.h, which FreeRTOS.h pulls in on the node
+#define BIT7 0x00000080
+#define BIT6 0x00000040
+#define BIT5 0x00000020
+#define BIT4 0x00000010
+#define BIT3 0x00000008
+#define BIT2 0x00000004
+#define BIT1 0x00000002
+#define BIT0 0x00000001
+
+// Critical sections hold off interrupts and task switches; pin changes due
+// meanwhile are taken when the outermost section is left
+typedef struct {
+  uint32_t owner;
+  uint32_t count;
+} portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED {0, 0}
+
+void vPortEnterCritical(portMUX_TYPE* mux);
+void vPortExitCritical(portMUX_TYPE* mux);
+void vPortYield();
+
+#define portENTER_CRITICAL(mux) vPortEnterCritical(mux)
+#define portEXIT_CRITICAL(mux) vPortExitCritical(mux)
+#define portENTER_CRITICAL_ISR(mux) vPortEnterCritical(mux)
+#define portEXIT_CRITICAL_ISR(mux) vPortExitCritical(mux)
+// The scheduler looks for a better task after every interrupt anyway
+#define portYIELD_FROM_ISR(...) ((void)0)
+#define portYIELD() vPortYield()
+
+// configENABLE_BACKWARD_COMPATIBILITY names
+#define xSemaphoreHandle SemaphoreHandle_t
+#define xQueueHandle QueueHandle_t
+#define xTaskHandle TaskHandle_t
+#define portTickType TickType_t
+
+#endif  // FREERTOS_H
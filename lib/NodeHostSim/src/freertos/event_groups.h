@@ -0,0 +1,27 @@
+#ifndef FREERTOS_EVENT_GROUPS_H
+#define FREERTOS_EVENT_GROUPS_H
+#include "freertos/FreeRTOS.h"
+
+// Waiters are released by the xEventGroupSetBits() call that satisfies them
+// and get the bits as they were then, even if the bits are cleared again
+// before the waiter runs
+EventGroupHandle_t xEventGroupCreate();
+EventGroupHandle_t xEventGroupCreateStatic(
+    StaticEventGroup_t* pxEventGroupBuffer);
+void vEventGroupDelete(EventGroupHandle_t xEventGroup);
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t xEventGroup,
+                                EventBits_t uxBitsToWaitFor,
+                                BaseType_t xClearOnExit,
+                                BaseType_t xWaitForAllBits,
+                                TickType_t xTicksToWait);
+EventBits_t xEventGroupSetBits(EventGroupHandle_t xEventGroup,
+                               EventBits_t uxBitsToSet);
+BaseType_t xEventGroupSetBitsFromISR(EventGroupHandle_t xEventGroup,
+                                     EventBits_t uxBitsToSet,
+                                     BaseType_t* pxHigherPriorityTaskWoken);
+EventBits_t xEventGroupClearBits(EventGroupHandle_t xEventGroup,
+                                 EventBits_t uxBitsToClear);
+EventBits_t xEventGroupGetBits(EventGroupHandle_t xEventGroup);
+
+#endif  // FREERTOS_EVENT_GROUPS_H
@@ -0,0 +1,39 @@
+#ifndef FREERTOS_TASK_H
+#define FREERTOS_TASK_H
+#include "freertos/FreeRTOS.h"
+
+typedef void (*TaskFunction_t)(void* pvParameters);
+
+// Cores are not modelled: every task shares the one simulated CPU
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t pvTaskCode,
+                                   const char* pcName,
+                                   uint32_t usStackDepth, void* pvParameters,
+                                   UBaseType_t uxPriority,
+                                   TaskHandle_t* pvCreatedTask,
+                                   BaseType_t xCoreID);
+inline BaseType_t xTaskCreate(TaskFunction_t pvTaskCode, const char* pcName,
+                              uint32_t usStackDepth, void* pvParameters,
+                              UBaseType_t uxPriority,
+                              TaskHandle_t* pvCreatedTask) {
+  return xTaskCreatePinnedToCore(pvTaskCode, pcName, usStackDepth,
+                                 pvParameters, uxPriority, pvCreatedTask,
+                                 tskNO_AFFINITY);
+}
+void vTaskDelete(TaskHandle_t xTaskToDelete);
+void vTaskDelay(TickType_t xTicksToDelay);
+TickType_t xTaskGetTickCount();
+TickType_t xTaskGetTickCountFromISR();
+TaskHandle_t xTaskGetCurrentTaskHandle();
+const char* pcTaskGetName(TaskHandle_t xTaskToQuery);
+// The requested depth: host threads do not report stack use
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t xTask);
+
+uint32_t ulTaskNotifyTake(BaseType_t xClearCountOnExit,
+                          TickType_t xTicksToWait);
+BaseType_t xTaskNotifyGive(TaskHandle_t xTaskToNotify);
+void vTaskNotifyGiveFromISR(TaskHandle_t xTaskToNotify,
+                            BaseType_t* pxHigherPriorityTaskWoken);
+
+#define taskYIELD() vPortYield()
+
+#endif  // FREERTOS_TASK_H
@@ -0,0 +1,7 @@
+#ifndef FREERTOS_TIMERS_H
+#define FREERTOS_TIMERS_H
+#include "freertos/FreeRTOS.h"
+
+// Software timers are not used by the firmware; esp_timer stands in
+
+#endif  // FREERTOS_TIMERS_H
@@ -1,3 +1,24 @@
 Import("env")
+import os
+import subprocess
+
 platform = env.PioPlatform()
 env.Replace( MKSPIFFSTOOL=platform.get_package_dir("tool-mklittlefs") + '/mklittlefs' )  # PlatformIO now believes it has actually created a SPIFFS
+
+
+# StateMachine::deserializeTransitions() reads /states/transitions.bin, so
+# compile data/states/transitions.json into it before the image is packed
+def compile_transitions(source, target, env):
+    project = env.subst("$PROJECT_DIR")
+    table = os.path.join(project, "data", "states", "transitions.json")
+    if not os.path.isfile(table):
+        return
+    subprocess.check_call([
+        env.subst("$PYTHONEXE"),
+        os.path.join(project, "tools", "transition_compiler.py"),
+        table,
+        "-o", os.path.join(project, "data", "states", "transitions.bin"),
+    ])
+
+
+env.AddPreAction("$BUILD_DIR/${ESP32_FS_IMAGE_NAME}.bin", compile_transitions)
@@ -0,0 +1,277 @@
+#include "Checkpoint.h"
+#include "NodeLog.h"
+#include "esp_attr.h"
+#include "esp_rom_crc.h"
+#include "nvs.h"
+#include <stddef.h>
+#include <string.h>
+
+namespace Node_Core {
+
+RTC_NOINIT_ATTR CheckpointRecord Checkpoint::_record;
+portMUX_TYPE Checkpoint::_lock = portMUX_INITIALIZER_UNLOCKED;
+TaskHandle_t Checkpoint::_task = NULL;
+bool Checkpoint::_dirty = false;
+uint32_t Checkpoint::_committedCrc = 0;
+uint32_t Checkpoint::_commits = 0;
+uint32_t Checkpoint::_skipped = 0;
+
+void Checkpoint::reset(CheckpointRecord& record) {
+  memset(&record, 0, sizeof(record));
+  record.magic = CheckpointRecord::MAGIC;
+  record.version = CheckpointRecord::VERSION;
+  record.size = sizeof(record);
+  record.state = static_cast<uint8_t>(State::DEVICE_SHUTDOWN);
+  record.crc = crcOf(record);
+}
+
+uint32_t Checkpoint::crcOf(const CheckpointRecord& record) {
+  return esp_rom_crc32_le(0, reinterpret_cast<const uint8_t*>(&record),
+                          offsetof(CheckpointRecord, crc));
+}
+
+bool Checkpoint::valid(const CheckpointRecord& record) {
+  return record.magic == CheckpointRecord::MAGIC
+         && record.version == CheckpointRecord::VERSION
+         && record.size == sizeof(record) && record.crc == crcOf(record);
+}
+
+bool Checkpoint::restore() {
+  if (valid(_record)) {
+    _dirty = true;  // NVS may be behind the RTC copy
+    return true;
+  }
+  nvs_handle_t handle;
+  if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &handle) == ESP_OK) {
+    size_t length = sizeof(_record);
+    esp_err_t err = nvs_get_blob(handle, NVS_KEY, &_record, &length);
+    nvs_close(handle);
+    if (err == ESP_OK && length == sizeof(_record) && valid(_record)) {
+      _committedCrc = _record.crc;
+      return true;
+    }
+  }
+  reset(_record);
+  return false;
+}
+
+bool Checkpoint::begin(UBaseType_t priority, BaseType_t core) {
+  if (_task != NULL) {
+    return true;
+  }
+  return xTaskCreatePinnedToCore(commitTask, "CheckpointTask", 3072, NULL,
+                                 priority, &_task, core)
+         == pdPASS;
+}
+
+State Checkpoint::safeState(State state) {
+  switch (state) {
+    case State::SWITCHING_TEST_START:
+    case State::SWITCHING_TEST_25P_START:
+    case State::SWITCHING_TEST_50P_START:
+    case State::SWITCHING_TEST_75P_START:
+    case State::SWITCHING_TEST_FULLLOAD_START:
+    case State::SWITCHING_TEST_OK:
+    case State::READY_NEXT_TEST:
+    case State::EFFICIENCY_TEST_OK:
+    case State::BACKUP_TIME_TEST_OK:
+    case State::SAVE_TEST_DATA:
+      return state;
+    // A level whose load is on but whose capture did not finish is redone
+    case State::SWITCHING_TEST_25P_DONE:
+      return State::SWITCHING_TEST_25P_START;
+    case State::SWITCHING_TEST_50P_DONE:
+      return State::SWITCHING_TEST_50P_START;
+    case State::SWITCHING_TEST_75P_DONE:
+      return State::SWITCHING_TEST_75P_START;
+    case State::SWITCHING_TEST_FULLLOAD_DONE:
+      return State::SWITCHING_TEST_FULLLOAD_START;
+    case State::SWITCHING_TEST_CHECK:
+      return State::SWITCHING_TEST_START;
+    case State::EFFICIENCY_TEST_START:
+    case State::EFFICIENCY_TEST_DONE:
+    case State::EFFICIENCY_TEST_CHECK:
+    case State::BACKUP_TIME_TEST_START:
+    case State::BACKUP_TIME_TEST_DONE:
+    case State::BACKUP_TIME_TEST_CHECK:
+      return State::READY_NEXT_TEST;
+    default:
+      return State::DEVICE_SHUTDOWN;
+  }
+}
+
+State Checkpoint::resumeState() { return static_cast<State>(_record.state); }
+
+uint8_t Checkpoint::retryCount() { return _record.retryCount; }
+
+uint32_t Checkpoint::sequence() { return _record.sequence; }
+
+void Checkpoint::restoreSwitchResults(SwitchResult (&results)[5]) {
+  portENTER_CRITICAL(&_lock);
+  memcpy(results, _record.switchTest, sizeof(results));
+  portEXIT_CRITICAL(&_lock);
+}
+
+void Checkpoint::restoreBackupResults(BackupResult (&results)[5]) {
+  portENTER_CRITICAL(&_lock);
+  memcpy(results, _record.backupTest, sizeof(results));
+  portEXIT_CRITICAL(&_lock);
+}
+
+bool Checkpoint::endsSequence(State state) {
+  switch (state) {
+    case State::SWITCHING_TEST_FAILED:
+    case State::EFFICIENCY_TEST_FAILED:
+    case State::BACKUP_TIME_TEST_FAILED:
+    case State::ALL_TEST_DONE:
+    case State::ADDENDUM_TEST_DATA:
+    case State::REPORT_AVAILABLE:
+    case State::PRINT_TEST_DATA:
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool Checkpoint::interruptedBackup(uint8_t& testNo, uint32_t& elapsed_ms) {
+  testNo = _record.backupTestNo;
+  elapsed_ms = _record.backupElapsed_ms;
+  return testNo != 0;
+}
+
+void Checkpoint::saveState(State state, uint8_t retryCount) {
+  if (endsSequence(state)) {
+    if (resumeState() != State::DEVICE_SHUTDOWN) {
+      clear();
+    }
+    return;
+  }
+  State safe = safeState(state);
+  if (safe == State::DEVICE_SHUTDOWN) {
+    return;
+  }
+  const uint8_t stateValue = static_cast<uint8_t>(safe);
+  portENTER_CRITICAL(&_lock);
+  const bool moved = _record.state != stateValue;
+  const bool changed = moved || _record.retryCount != retryCount;
+  if (changed) {
+    _record.state = stateValue;
+    _record.retryCount = retryCount;
+    sealLocked();
+  }
+  portEXIT_CRITICAL(&_lock);
+  if (moved) {
+    commitSoon();
+  }
+}
+
+void Checkpoint::saveSwitchResult(uint8_t slot, const SwitchResult& test) {
+  if (slot >= 5) {
+    return;
+  }
+  portENTER_CRITICAL(&_lock);
+  _record.switchTest[slot] = test;
+  sealLocked();
+  portEXIT_CRITICAL(&_lock);
+}
+
+void Checkpoint::saveBackupResult(uint8_t slot, const BackupResult& test) {
+  if (slot >= 5) {
+    return;
+  }
+  portENTER_CRITICAL(&_lock);
+  _record.backupTest[slot] = test;
+  sealLocked();
+  portEXIT_CRITICAL(&_lock);
+}
+
+void Checkpoint::saveBackupProgress(uint8_t testNo, uint32_t elapsed_ms,
+                                    uint32_t samples) {
+  portENTER_CRITICAL(&_lock);
+  const bool startOrEnd = (testNo == 0) != (_record.backupTestNo == 0);
+  _record.backupTestNo = testNo;
+  _record.backupElapsed_ms = elapsed_ms;
+  _record.backupSamples = samples;
+  sealLocked();
+  portEXIT_CRITICAL(&_lock);
+  if (startOrEnd) {
+    commitSoon();
+  }
+}
+
+void Checkpoint::clear() {
+  portENTER_CRITICAL(&_lock);
+  const uint32_t sequence = _record.sequence;
+  reset(_record);
+  _record.sequence = sequence;
+  sealLocked();
+  portEXIT_CRITICAL(&_lock);
+  commitSoon();
+}
+
+void Checkpoint::sealLocked() {
+  _record.sequence++;
+  _record.crc = crcOf(_record);
+  _dirty = true;
+}
+
+void Checkpoint::commitSoon() {
+  if (_task != NULL) {
+    xTaskNotifyGive(_task);
+  }
+}
+
+void Checkpoint::commit() {
+  CheckpointRecord copy;
+  portENTER_CRITICAL(&_lock);
+  copy = _record;
+  _dirty = false;
+  portEXIT_CRITICAL(&_lock);
+  if (copy.crc == _committedCrc) {
+    _skipped++;
+    return;
+  }
+  nvs_handle_t handle;
+  esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
+  if (err == ESP_OK) {
+    err = nvs_set_blob(handle, NVS_KEY, &copy, sizeof(copy));
+    if (err == ESP_OK) {
+      err = nvs_commit(handle);
+    }
+    nvs_close(handle);
+  }
+  if (err != ESP_OK) {
+    NODE_LOGW(CHECKPOINT_COMMIT_FAILED, err);
+    portENTER_CRITICAL(&_lock);
+    _dirty = true;  // Retried at the next interval
+    portEXIT_CRITICAL(&_lock);
+    return;
+  }
+  _committedCrc = copy.crc;
+  _commits++;
+}
+
+// Waits out MIN_COMMIT_GAP_MS after a wake, so a burst of transitions lands
+// in one flash write
+void Checkpoint::commitTask(void* pvParameters) {
+  const TickType_t gap = pdMS_TO_TICKS(MIN_COMMIT_GAP_MS);
+  TickType_t lastCommit = xTaskGetTickCount() - gap;
+  while (true) {
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(COMMIT_INTERVAL_MS));
+    portENTER_CRITICAL(&_lock);
+    bool dirty = _dirty;
+    portEXIT_CRITICAL(&_lock);
+    if (!dirty) {
+      continue;
+    }
+    TickType_t since = xTaskGetTickCount() - lastCommit;
+    if (since < gap) {
+      vTaskDelay(gap - since);
+    }
+    commit();
+    lastCommit = xTaskGetTickCount();
+  }
+  vTaskDelete(NULL);
+}
+
+}  // namespace Node_Core
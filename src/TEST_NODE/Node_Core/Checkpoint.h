@@ -0,0 +1,102 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+#include "StateDefines.h"
+#include "TestResults.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <stdint.h>
+
+namespace Node_Core {
+
+// Everything needed to pick a test sequence up after a reset. Little endian,
+// sealed with a CRC-32 over all fields before it.
+struct CheckpointRecord {
+  static constexpr uint32_t MAGIC = 0x54504B43;  // "CKPT"
+  static constexpr uint16_t VERSION = 1;
+  uint32_t magic;
+  uint16_t version;
+  uint16_t size;
+  uint32_t sequence;  // Bumped on every change
+  uint8_t state;      // Last safe state, see Checkpoint::safeState()
+  uint8_t retryCount;
+  uint8_t backupTestNo;  // Backup run in progress, 0 when none
+  uint8_t reserved;
+  uint32_t backupElapsed_ms;
+  uint32_t backupSamples;
+  SwitchResult switchTest[5];
+  BackupResult backupTest[5];
+  uint32_t crc;
+};
+
+// The live record sits in RTC memory and is resealed on every change, so
+// any reset that keeps the chip powered (software, watchdog, most
+// brown-outs) resumes from it without touching flash. NVS holds a copy for
+// a full power loss. NVS commits are coalesced on a low priority task: a
+// new safe state is committed at once, anything else within
+// COMMIT_INTERVAL_MS, never two within MIN_COMMIT_GAP_MS and never a record
+// identical to the last one committed.
+class Checkpoint {
+public:
+  static constexpr const char* NVS_NAMESPACE = "checkpoint";
+  static constexpr const char* NVS_KEY = "record";
+  static constexpr uint32_t COMMIT_INTERVAL_MS = 60000;
+  static constexpr uint32_t MIN_COMMIT_GAP_MS = 2000;
+
+  // Takes the RTC copy when it is valid, the NVS copy otherwise; false when
+  // neither holds a record of this version. Call before anything can move
+  // the state machine.
+  static bool restore();
+  // Starts the commit task
+  static bool begin(UBaseType_t priority, BaseType_t core);
+
+  // Where a state resumes after a reset: in-flight states fall back to the
+  // state the step started from; DEVICE_SHUTDOWN when not resumable (idle,
+  // device bring-up and the states that end a sequence)
+  static State safeState(State state);
+  // Completed or failed sequence: nothing is left to resume
+  static bool endsSequence(State state);
+  static State resumeState();
+  static uint8_t retryCount();
+  static uint32_t sequence();
+  static void restoreSwitchResults(SwitchResult (&results)[5]);
+  static void restoreBackupResults(BackupResult (&results)[5]);
+  // Backup run cut short by the reset, false when none was running
+  static bool interruptedBackup(uint8_t& testNo, uint32_t& elapsed_ms);
+
+  // States that are not resumable leave the checkpoint alone; the end of a
+  // sequence clears it, so the next boot starts from DEVICE_SHUTDOWN
+  static void saveState(State state, uint8_t retryCount);
+  static void saveSwitchResult(uint8_t slot, const SwitchResult& test);
+  static void saveBackupResult(uint8_t slot, const BackupResult& test);
+  // testNo 0 marks the end of the run
+  static void saveBackupProgress(uint8_t testNo, uint32_t elapsed_ms,
+                                 uint32_t samples);
+  // Drops both copies, the next boot starts from DEVICE_SHUTDOWN
+  static void clear();
+
+  static uint32_t commits() { return _commits; }
+  static uint32_t skippedCommits() { return _skipped; }
+
+private:
+  static void reset(CheckpointRecord& record);
+  static uint32_t crcOf(const CheckpointRecord& record);
+  static bool valid(const CheckpointRecord& record);
+  // Called with _lock held after _record changed
+  static void sealLocked();
+  // Commits now instead of at the next interval; called without _lock
+  static void commitSoon();
+  static void commit();
+  static void commitTask(void* pvParameters);
+
+  static CheckpointRecord _record;
+  static portMUX_TYPE _lock;
+  static TaskHandle_t _task;
+  static bool _dirty;
+  static uint32_t _committedCrc;
+  static uint32_t _commits;
+  static uint32_t _skipped;
+};
+
+}  // namespace Node_Core
+
+#endif  // CHECKPOINT_H
@@ -0,0 +1,170 @@
+#ifndef LOAD_BANKS_H
+#define LOAD_BANKS_H
+#include "HardwareConfig.h"
+#include "HardwareSetup.h"
+#include "Settings.h"
+#include "driver/gpio.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <stdint.h>
+
+static_assert(LOAD25P_ON_PIN < 32 && LOAD50P_ON_PIN < 32
+                  && LOAD75P_ON_PIN < 32 && LOAD_FULL_ON_PIN < 32,
+              "load bank pins must share the GPIO_OUT_W1TS/W1TC registers");
+
+// Load bank relay outputs driven as one GPIO mask, so banks switching
+// together engage on the same register write instead of four digitalWrite
+// calls apart. Optional per-bank delays give a staggered soft start.
+class LoadBanks {
+public:
+  static constexpr uint8_t COUNT = 4;
+
+  struct Skew {
+    uint32_t masked_ns;      // Worst spread, one masked write
+    uint32_t sequential_ns;  // Worst spread, one writePin per bank
+  };
+
+  static uint8_t pin(uint8_t bank) {
+    const uint8_t pins[COUNT]
+        = {LOAD25P_ON_PIN, LOAD50P_ON_PIN, LOAD75P_ON_PIN, LOAD_FULL_ON_PIN};
+    return pins[bank];
+  }
+  static constexpr uint32_t ALL_MASK
+      = (1UL << LOAD25P_ON_PIN) | (1UL << LOAD50P_ON_PIN)
+        | (1UL << LOAD75P_ON_PIN) | (1UL << LOAD_FULL_ON_PIN);
+
+  // Mask of the lowest `banks` banks
+  static uint32_t maskFor(uint8_t banks) {
+    uint32_t mask = 0;
+    for (uint8_t bank = 0; bank < banks && bank < COUNT; ++bank) {
+      mask |= 1UL << pin(bank);
+    }
+    return mask;
+  }
+
+  static void apply(uint8_t banks) {
+    uint32_t mask = maskFor(banks);
+    NodeTask::IO_SETUP::writeMask(mask, ALL_MASK & ~mask);
+  }
+
+  // Releases dropped banks at once, then engages new ones at their delay
+  // after the call; banks sharing a delay go out in one write. All zero
+  // delays is the same as apply().
+  static void apply(uint8_t banks, const Node_Core::SetupHardware& hardware) {
+    using NodeTask::IO_SETUP;
+    const uint16_t delays[COUNT]
+        = {hardware.bankDelay_25P_us, hardware.bankDelay_50P_us,
+           hardware.bankDelay_75P_us, hardware.bankDelay_100P_us};
+    const uint32_t target = maskFor(banks);
+    const int64_t start_us = IO_SETUP::now_us();
+    IO_SETUP::writeMask(0, ALL_MASK & ~target);
+
+    uint32_t pending = target;
+    while (pending) {
+      uint16_t next = UINT16_MAX;
+      for (uint8_t bank = 0; bank < COUNT; ++bank) {
+        if ((pending & (1UL << pin(bank))) && delays[bank] < next) {
+          next = delays[bank];
+        }
+      }
+      uint32_t group = 0;
+      for (uint8_t bank = 0; bank < COUNT; ++bank) {
+        if ((pending & (1UL << pin(bank))) && delays[bank] == next) {
+          group |= 1UL << pin(bank);
+        }
+      }
+      waitUntil(start_us + next);
+      IO_SETUP::writeMask(group, 0);
+      pending &= ~group;
+    }
+  }
+
+  // Pin-level self-test: engages all banks through the masked write and
+  // through sequential writePin calls, reading the pads back through the
+  // input buffer. Relay contact timing is outside what this can see. Leaves
+  // all banks off.
+  static Skew measureSkew(uint8_t trials = 8) {
+    using NodeTask::IO_SETUP;
+    for (uint8_t bank = 0; bank < COUNT; ++bank) {
+      gpio_set_direction(static_cast<gpio_num_t>(pin(bank)),
+                         GPIO_MODE_INPUT_OUTPUT);
+    }
+    Skew skew = {0, 0};
+    for (uint8_t trial = 0; trial < trials; ++trial) {
+      IO_SETUP::writeMask(0, ALL_MASK);
+      uint32_t spread = spreadAfter(true);
+      skew.masked_ns = spread > skew.masked_ns ? spread : skew.masked_ns;
+
+      IO_SETUP::writeMask(0, ALL_MASK);
+      spread = spreadAfter(false);
+      skew.sequential_ns
+          = spread > skew.sequential_ns ? spread : skew.sequential_ns;
+    }
+    IO_SETUP::writeMask(0, ALL_MASK);
+    for (uint8_t bank = 0; bank < COUNT; ++bank) {
+      gpio_set_direction(static_cast<gpio_num_t>(pin(bank)),
+                         GPIO_MODE_OUTPUT);
+    }
+    return skew;
+  }
+
+private:
+  static void waitUntil(int64_t time_us) {
+    using NodeTask::IO_SETUP;
+    int64_t remaining = time_us - IO_SETUP::now_us();
+    if (remaining > 2000) {
+      vTaskDelay(pdMS_TO_TICKS((remaining - 1000) / 1000));
+    }
+    while (IO_SETUP::now_us() < time_us) {
+    }
+  }
+
+  // Time between the first and the last bank reading high. The sequential
+  // path polls after each write, so the gaps between calls are included.
+  static uint32_t spreadAfter(bool masked) {
+    using NodeTask::IO_SETUP;
+    uint32_t seen[COUNT] = {};
+    uint32_t found = 0;
+    const uint32_t start = IO_SETUP::cycleCount();
+    if (masked) {
+      IO_SETUP::writeMask(ALL_MASK, 0);
+      found = pollHigh(ALL_MASK, start, seen);
+    } else {
+      for (uint8_t bank = 0; bank < COUNT; ++bank) {
+        IO_SETUP::writePin(pin(bank), HIGH);
+        found |= pollHigh(1UL << pin(bank), start, seen);
+      }
+    }
+    if (found != ALL_MASK) {
+      return UINT32_MAX;  // A pad never read back high
+    }
+    uint32_t first = UINT32_MAX;
+    uint32_t last = 0;
+    for (uint8_t bank = 0; bank < COUNT; ++bank) {
+      first = seen[bank] < first ? seen[bank] : first;
+      last = seen[bank] > last ? seen[bank] : last;
+    }
+    return (last - first) * 1000 / IO_SETUP::cyclesPerUs();
+  }
+
+  // Stamps each bank in mask with the cycle count it first read high
+  static uint32_t pollHigh(uint32_t mask, uint32_t start,
+                           uint32_t seen[COUNT]) {
+    using NodeTask::IO_SETUP;
+    uint32_t found = 0;
+    for (uint16_t poll = 0; poll < 1000 && found != mask; ++poll) {
+      uint32_t levels = IO_SETUP::readInputs();
+      uint32_t now = IO_SETUP::cycleCount();
+      for (uint8_t bank = 0; bank < COUNT; ++bank) {
+        uint32_t bit = 1UL << pin(bank);
+        if ((mask & bit) && (levels & bit) && !(found & bit)) {
+          found |= bit;
+          seen[bank] = now - start;
+        }
+      }
+    }
+    return found;
+  }
+};
+
+#endif  // LOAD_BANKS_H
@@ -0,0 +1,95 @@
+#include "LoadCalibration.h"
+#include <LittleFS.h>
+
+LoadCalTable LoadCalibration::_table = {};
+bool LoadCalibration::_loaded = false;
+bool LoadCalibration::_valid = false;
+uint16_t LoadCalibration::_generation = 0;
+
+uint16_t LoadCalibration::checksum(const LoadCalTable& table) {
+  const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&table);
+  uint16_t sum = 0;
+  for (size_t i = 0; i < offsetof(LoadCalTable, checksum); ++i) {
+    sum = static_cast<uint16_t>((sum << 1) | (sum >> 15)) + bytes[i];
+  }
+  return sum;
+}
+
+bool LoadCalibration::load() {
+  _loaded = true;
+  _valid = false;
+  _generation++;
+  if (!LittleFS.begin(true)) {
+    return false;
+  }
+  File file = LittleFS.open(PATH, "r");
+  if (!file) {
+    return false;
+  }
+  size_t n = file.read(reinterpret_cast<uint8_t*>(&_table), sizeof(_table));
+  file.close();
+  _valid = n == sizeof(_table) && _table.magic == LoadCalTable::MAGIC
+           && _table.version == LoadCalTable::VERSION && _table.maxDuty > 0
+           && _table.checksum == checksum(_table);
+  return _valid;
+}
+
+bool LoadCalibration::save(LoadCalTable& table) {
+  table.magic = LoadCalTable::MAGIC;
+  table.version = LoadCalTable::VERSION;
+  table.checksum = checksum(table);
+  if (!LittleFS.begin(true)) {
+    return false;
+  }
+  File file = LittleFS.open(PATH, "w");
+  if (!file) {
+    return false;
+  }
+  size_t n = file.write(reinterpret_cast<const uint8_t*>(&table),
+                        sizeof(table));
+  file.close();
+  if (n != sizeof(table)) {
+    return false;
+  }
+  _table = table;
+  _loaded = true;
+  _valid = true;
+  _generation++;
+  return true;
+}
+
+bool LoadCalibration::valid() {
+  if (!_loaded) {
+    load();
+  }
+  return _valid;
+}
+
+bool LoadCalibration::lookup(uint16_t VA, uint16_t maxDuty, uint8_t& banks,
+                             uint16_t& duty) {
+  if (!valid()) {
+    return false;
+  }
+  const uint8_t last = LoadCalTable::POINTS - 1;
+  for (uint8_t bank = 0; bank < LoadCalTable::BANKS; ++bank) {
+    const uint16_t* row = _table.va[bank];
+    if (VA > row[last]) {
+      continue;
+    }
+    uint8_t i = 0;
+    while (i < last - 1 && VA > row[i + 1]) {
+      i++;
+    }
+    uint32_t lowDuty = LoadCalTable::dutyAt(i, _table.maxDuty);
+    uint32_t highDuty = LoadCalTable::dutyAt(i + 1, _table.maxDuty);
+    uint32_t tableDuty = lowDuty;
+    if (VA > row[i] && row[i + 1] > row[i]) {
+      tableDuty += (highDuty - lowDuty) * (VA - row[i]) / (row[i + 1] - row[i]);
+    }
+    banks = bank + 1;
+    duty = static_cast<uint16_t>((tableDuty * maxDuty + _table.maxDuty / 2)
+                                 / _table.maxDuty);
+    return true;
+  }
+  return false;
+}
@@ -0,0 +1,50 @@
+#ifndef LOAD_CALIBRATION_H
+#define LOAD_CALIBRATION_H
+#include <stddef.h>
+#include <stdint.h>
+
+// Measured load VA against PWM duty for 1..4 active banks, written by
+// TunePWMTest. Duty points are evenly spaced from 0 to maxDuty.
+struct LoadCalTable {
+  static constexpr uint32_t MAGIC = 0x4C41434C;  // "LCAL"
+  static constexpr uint16_t VERSION = 1;
+  static constexpr uint8_t BANKS = 4;
+  static constexpr uint8_t POINTS = 17;
+
+  uint32_t magic;
+  uint16_t version;
+  uint16_t maxDuty;            // PWM full scale the table was measured at
+  uint16_t va[BANKS][POINTS];  // Non-decreasing along each row
+  uint16_t checksum;
+  uint16_t reserved;
+
+  static uint16_t dutyAt(uint8_t point, uint16_t maxDuty) {
+    return static_cast<uint32_t>(maxDuty) * point / (POINTS - 1);
+  }
+};
+
+// Loads the table from LittleFS on first use and turns a VA request into
+// the fewest banks that reach it plus an interpolated duty.
+class LoadCalibration {
+public:
+  static constexpr const char* PATH = "/loadcal.bin";
+
+  static bool load();
+  static bool save(LoadCalTable& table);
+  static bool valid();
+  // Bumped by every load() and save(), so cached copies can tell
+  static uint16_t generation() { return _generation; }
+  // duty is scaled to maxDuty; false when uncalibrated or VA is out of range
+  static bool lookup(uint16_t VA, uint16_t maxDuty, uint8_t& banks,
+                     uint16_t& duty);
+
+private:
+  static uint16_t checksum(const LoadCalTable& table);
+
+  static LoadCalTable _table;
+  static bool _loaded;
+  static bool _valid;
+  static uint16_t _generation;
+};
+
+#endif  // LOAD_CALIBRATION_H
@@ -0,0 +1,223 @@
+#include "LoadProfile.h"
+#include "Arduino.h"
+#include "LoadBanks.h"
+#include "LoadTable.h"
+#include <ArduinoJson.h>
+#include <LittleFS.h>
+#include <string.h>
+
+LoadProfileHeader LoadProfile::_header = {};
+LoadProfilePoint LoadProfile::_points[LoadProfile::MAX_POINTS] = {};
+Node_Core::SetupHardware LoadProfile::_hardware;
+esp_timer_handle_t LoadProfile::_timer = NULL;
+TaskHandle_t LoadProfile::_done = NULL;
+int64_t LoadProfile::_start_us = 0;
+uint32_t LoadProfile::_pass = 0;
+uint16_t LoadProfile::_next = 0;
+uint16_t LoadProfile::_lastVA = 0;
+volatile bool LoadProfile::_running = false;
+SemaphoreHandle_t LoadProfile::_lock = NULL;
+
+bool LoadProfile::load(const char* path) {
+  if (_running || !LittleFS.begin(true)) {
+    return false;
+  }
+  size_t length = strlen(path);
+  bool ok = length > 5 && strcmp(path + length - 5, ".json") == 0
+                ? loadJson(path)
+                : loadBinary(path);
+  if (!ok || !validate()) {
+    _header.count = 0;
+    return false;
+  }
+  return true;
+}
+
+bool LoadProfile::loadBinary(const char* path) {
+  File file = LittleFS.open(path, "r");
+  if (!file) {
+    return false;
+  }
+  bool ok = file.read(reinterpret_cast<uint8_t*>(&_header), sizeof(_header))
+                == sizeof(_header)
+            && _header.magic == LoadProfileHeader::MAGIC
+            && _header.version == LoadProfileHeader::VERSION
+            && _header.count <= MAX_POINTS;
+  if (ok) {
+    size_t bytes = _header.count * sizeof(LoadProfilePoint);
+    ok = file.read(reinterpret_cast<uint8_t*>(_points), bytes) == bytes;
+  }
+  file.close();
+  return ok;
+}
+
+// {"repeat": 10, "period_us": 200000,
+//  "points": [{"t_us": 0, "va": 4000}, {"t_us": 50000, "va": 0},
+//             {"t_us": 150000, "va": 2000, "ramp": true}]}
+bool LoadProfile::loadJson(const char* path) {
+  File file = LittleFS.open(path, "r");
+  if (!file) {
+    return false;
+  }
+  DynamicJsonDocument doc(8192);
+  DeserializationError error = deserializeJson(doc, file);
+  file.close();
+  if (error) {
+    return false;
+  }
+  JsonArray points = doc["points"].as<JsonArray>();
+  if (points.isNull() || points.size() > MAX_POINTS) {
+    return false;
+  }
+  _header.magic = LoadProfileHeader::MAGIC;
+  _header.version = LoadProfileHeader::VERSION;
+  _header.repeat = doc["repeat"] | 1;
+  _header.period_us = doc["period_us"] | 0;
+  _header.count = 0;
+  for (JsonObject point : points) {
+    LoadProfilePoint& p = _points[_header.count++];
+    p.time_us = point["t_us"] | 0;
+    p.VA = point["va"] | 0;
+    p.flags = (point["ramp"] | false) ? LoadProfilePoint::RAMP : 0;
+    p.reserved = 0;
+  }
+  return true;
+}
+
+// Times must not go backwards and a repeating pass must fit its period
+bool LoadProfile::validate() {
+  if (_header.count == 0 || _header.repeat == 0) {
+    return false;
+  }
+  for (uint16_t i = 1; i < _header.count; ++i) {
+    if (_points[i].time_us < _points[i - 1].time_us) {
+      return false;
+    }
+  }
+  uint32_t last = _points[_header.count - 1].time_us;
+  return _header.repeat == 1 || _header.period_us > last;
+}
+
+bool LoadProfile::start(const Node_Core::SetupHardware& hardware,
+                        TaskHandle_t done) {
+  if (_running || _header.count == 0) {
+    return false;
+  }
+  if (_lock == NULL) {
+    _lock = xSemaphoreCreateMutex();
+    if (_lock == NULL) {
+      return false;
+    }
+  }
+  if (_timer == NULL) {
+    esp_timer_create_args_t args = {};
+    args.callback = &LoadProfile::onTimer;
+    args.name = "loadProfile";
+    if (esp_timer_create(&args, &_timer) != ESP_OK) {
+      return false;
+    }
+  }
+  _hardware = hardware;
+  LoadTable::ensure(_hardware);
+  xSemaphoreTake(_lock, portMAX_DELAY);
+  _done = done;
+  _pass = 0;
+  _next = 0;
+  _lastVA = 0;
+  _running = true;
+  _start_us = esp_timer_get_time();
+  uint32_t first = _points[0].flags & LoadProfilePoint::RAMP
+                       ? 0
+                       : _points[0].time_us;
+  esp_timer_start_once(_timer, first);
+  xSemaphoreGive(_lock);
+  return true;
+}
+
+// A callback already waiting on _lock finds _running false and neither
+// applies a set point nor rearms the timer
+void LoadProfile::stop() {
+  if (_lock == NULL) {
+    return;
+  }
+  xSemaphoreTake(_lock, portMAX_DELAY);
+  if (_timer != NULL) {
+    esp_timer_stop(_timer);
+  }
+  if (_running) {
+    finish();
+  }
+  xSemaphoreGive(_lock);
+}
+
+void LoadProfile::applyVA(uint16_t VA) {
+  uint8_t banks = 0;
+  uint16_t duty = 0;
+  LoadTable::lookup(VA, banks, duty);
+  ledcWrite(_hardware.pwmchannelNo, duty);
+  LoadBanks::apply(banks);
+  _lastVA = VA;
+}
+
+void LoadProfile::finish() {
+  applyVA(0);
+  _running = false;
+  if (_done != NULL) {
+    xTaskNotifyGive(_done);
+  }
+}
+
+// Runs in the esp_timer task
+void LoadProfile::onTimer(void* arg) {
+  xSemaphoreTake(_lock, portMAX_DELAY);
+  if (_running) {
+    step();
+  }
+  xSemaphoreGive(_lock);
+}
+
+// Applies the set point that is due and arms the timer for the next one
+// against the pass start, so lateness never adds up
+void LoadProfile::step() {
+  const int64_t passStart_us
+      = _start_us + static_cast<int64_t>(_pass) * _header.period_us;
+  const int64_t now_us = esp_timer_get_time();
+  const LoadProfilePoint& point = _points[_next];
+  const int64_t due_us = passStart_us + point.time_us;
+
+  if ((point.flags & LoadProfilePoint::RAMP) && now_us < due_us) {
+    // Mid ramp: interpolate from the previous set point
+    const int64_t from_us
+        = _next > 0 ? passStart_us + _points[_next - 1].time_us
+                    : passStart_us;
+    const int32_t fromVA = _next > 0 ? _points[_next - 1].VA : _lastVA;
+    if (now_us < from_us) {
+      // Gap before the next pass, hold until the ramp begins
+      esp_timer_start_once(_timer, from_us - now_us);
+      return;
+    }
+    int64_t span = due_us - from_us;
+    int64_t VA = fromVA + (point.VA - fromVA) * (now_us - from_us) / span;
+    applyVA(static_cast<uint16_t>(VA));
+    int64_t wait = due_us - now_us;
+    const int64_t tick = RAMP_TICK_US;
+    esp_timer_start_once(_timer, wait < tick ? wait : tick);
+    return;
+  }
+
+  applyVA(point.VA);
+  if (++_next == _header.count) {
+    _next = 0;
+    if (++_pass >= _header.repeat) {
+      finish();
+      return;
+    }
+  }
+  const int64_t nextStart_us
+      = _start_us + static_cast<int64_t>(_pass) * _header.period_us;
+  const LoadProfilePoint& upcoming = _points[_next];
+  int64_t wait = upcoming.flags & LoadProfilePoint::RAMP
+                     ? static_cast<int64_t>(RAMP_TICK_US)
+                     : nextStart_us + upcoming.time_us - now_us;
+  esp_timer_start_once(_timer, wait > 0 ? wait : 0);
+}
@@ -0,0 +1,77 @@
+#ifndef LOAD_PROFILE_H
+#define LOAD_PROFILE_H
+#include "Settings.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include <stdint.h>
+
+// Load set points played back against a one-shot esp_timer. A RAMP point
+// ramps linearly from the previous set point and reaches VA at time_us;
+// any other point is a step at time_us. The profile repeats `repeat` times,
+// one pass every period_us, which covers pulse trains.
+struct LoadProfilePoint {
+  static constexpr uint8_t RAMP = 0x01;
+  uint32_t time_us;  // From the start of the pass
+  uint16_t VA;
+  uint8_t flags;
+  uint8_t reserved;
+};
+
+// Binary profile file: this header, then `count` LoadProfilePoint records,
+// little endian. JSON profiles carry the same fields, see LoadProfile::load.
+struct LoadProfileHeader {
+  static constexpr uint32_t MAGIC = 0x46525050;  // "PPRF"
+  static constexpr uint16_t VERSION = 1;
+  uint32_t magic;
+  uint16_t version;
+  uint16_t count;
+  uint32_t repeat;
+  uint32_t period_us;
+};
+
+class LoadProfile {
+public:
+  static constexpr uint16_t MAX_POINTS = 128;
+  static constexpr uint32_t RAMP_TICK_US = 1000;
+  static constexpr const char* PATH = "/profile.bin";
+
+  // .json paths are parsed as JSON, anything else as the binary layout
+  static bool load(const char* path = PATH);
+  // Plays the loaded profile on the load outputs; done is notified with
+  // xTaskNotifyGive when the last pass finishes or stop() is called
+  static bool start(const Node_Core::SetupHardware& hardware,
+                    TaskHandle_t done = NULL);
+  static void stop();
+  static bool running() { return _running; }
+  static int64_t startTime_us() { return _start_us; }
+  static uint16_t count() { return _header.count; }
+
+private:
+  static bool loadBinary(const char* path);
+  static bool loadJson(const char* path);
+  static bool validate();
+  static void onTimer(void* arg);
+  // Called with _lock held while _running
+  static void step();
+  static void applyVA(uint16_t VA);
+  static void finish();
+
+  static LoadProfileHeader _header;
+  static LoadProfilePoint _points[MAX_POINTS];
+  static Node_Core::SetupHardware _hardware;
+  static esp_timer_handle_t _timer;
+  static TaskHandle_t _done;
+  static int64_t _start_us;
+  static uint32_t _pass;
+  static uint16_t _next;
+  static uint16_t _lastVA;
+  static volatile bool _running;
+  // start()/stop() run in the Modbus task and onTimer() in the esp_timer
+  // task; every change of _running, the outputs and the timer is made
+  // holding _lock
+  static SemaphoreHandle_t _lock;
+};
+
+#endif  // LOAD_PROFILE_H
@@ -0,0 +1,80 @@
+#include "LoadTable.h"
+#include "LoadCalibration.h"
+
+uint16_t LoadTable::_entries[maxVARating + 1] = {};
+uint8_t LoadTable::_bits = 8;
+bool LoadTable::_built = false;
+uint16_t LoadTable::_calibration = 0;
+uint16_t LoadTable::_adjust[4] = {};
+
+namespace {
+
+// LEDC divides an 80 MHz clock, so the resolution shrinks as the PWM
+// frequency rises (14 bits up to about 4.8 kHz)
+constexpr uint32_t LEDC_CLOCK_HZ = 80000000UL;
+
+}  // namespace
+
+uint8_t LoadTable::resolutionBits(const Node_Core::SetupHardware& hardware) {
+  uint8_t bits = hardware.pwmResolusion_bits;
+  if (bits > MAX_RESOLUTION_BITS) {
+    bits = MAX_RESOLUTION_BITS;
+  }
+  while (bits > 1 && hardware.pwm_frequency > 0
+         && (LEDC_CLOCK_HZ >> bits) < hardware.pwm_frequency) {
+    bits--;
+  }
+  return bits;
+}
+
+void LoadTable::ensure(const Node_Core::SetupHardware& hardware) {
+  LoadCalibration::valid();  // First call loads it and bumps the generation
+  const uint16_t adjust[4]
+      = {hardware.adjust_pwm_25P, hardware.adjust_pwm_50P,
+         hardware.adjust_pwm_75P, hardware.adjust_pwm_100P};
+  bool changed = !_built || resolutionBits(hardware) != _bits
+                 || LoadCalibration::generation() != _calibration;
+  for (uint8_t i = 0; i < 4 && !changed; ++i) {
+    changed = adjust[i] != _adjust[i];
+  }
+  if (changed) {
+    build(hardware);
+  }
+}
+
+// Uses the TunePWMTest calibration when one is stored. Otherwise maps each
+// VA linearly onto the fewest banks that cover it; the adjust_pwm offsets
+// are 8-bit values and are scaled to the LEDC resolution.
+void LoadTable::build(const Node_Core::SetupHardware& hardware) {
+  _bits = resolutionBits(hardware);
+  _adjust[0] = hardware.adjust_pwm_25P;
+  _adjust[1] = hardware.adjust_pwm_50P;
+  _adjust[2] = hardware.adjust_pwm_75P;
+  _adjust[3] = hardware.adjust_pwm_100P;
+  const bool calibrated = LoadCalibration::valid();
+  _calibration = LoadCalibration::generation();
+
+  const uint32_t full = maxDuty();
+  const uint32_t singlebankVA = maxVARating / 4;
+  _entries[0] = 0;
+  for (uint32_t VA = 1; VA <= maxVARating; ++VA) {
+    uint8_t banks = 0;
+    uint16_t calDuty = 0;
+    uint32_t duty = 0;
+    if (calibrated && LoadCalibration::lookup(VA, full, banks, calDuty)) {
+      duty = calDuty;
+    } else {
+      banks = (VA + singlebankVA - 1) / singlebankVA;
+      if (banks > 4) {
+        banks = 4;
+      }
+      duty = VA * full / (singlebankVA * banks)
+             + (static_cast<uint32_t>(_adjust[banks - 1]) * full) / 255;
+    }
+    if (duty > full) {
+      duty = full;
+    }
+    _entries[VA] = static_cast<uint16_t>(((banks - 1) << DUTY_BITS) | duty);
+  }
+  _built = true;
+}
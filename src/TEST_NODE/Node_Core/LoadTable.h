@@ -0,0 +1,45 @@
+#ifndef LOAD_TABLE_H
+#define LOAD_TABLE_H
+#include "HardwareConfig.h"
+#include "Settings.h"
+#include <stdint.h>
+
+// VA -> (banks, duty) for every whole VA up to maxVARating, so setLoad() is
+// one array read. Each entry packs banks - 1 in the top two bits and the
+// duty, at up to 14-bit LEDC resolution, in the low 14. Rebuilt only when
+// the PWM resolution, the adjust offsets or the stored calibration change.
+class LoadTable {
+public:
+  static constexpr uint8_t MAX_RESOLUTION_BITS = 14;
+
+  // Clamped to what the table packs and LEDC can run at pwm_frequency
+  static uint8_t resolutionBits(const Node_Core::SetupHardware& hardware);
+  static void ensure(const Node_Core::SetupHardware& hardware);
+  static uint16_t maxDuty() { return (1U << _bits) - 1; }
+
+  // banks is 0 for 0 VA or above maxVARating
+  static void lookup(uint16_t VA, uint8_t& banks, uint16_t& duty) {
+    if (VA == 0 || VA > maxVARating) {
+      banks = 0;
+      duty = 0;
+      return;
+    }
+    uint16_t entry = _entries[VA];
+    banks = (entry >> DUTY_BITS) + 1;
+    duty = entry & DUTY_MASK;
+  }
+
+private:
+  static constexpr uint8_t DUTY_BITS = 14;
+  static constexpr uint16_t DUTY_MASK = (1U << DUTY_BITS) - 1;
+
+  static void build(const Node_Core::SetupHardware& hardware);
+
+  static uint16_t _entries[maxVARating + 1];
+  static uint8_t _bits;
+  static bool _built;
+  static uint16_t _calibration;  // LoadCalibration::generation() built for
+  static uint16_t _adjust[4];
+};
+
+#endif  // LOAD_TABLE_H
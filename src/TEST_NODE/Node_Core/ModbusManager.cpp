@@ -1,19 +1,105 @@
 #include "ModbusManager.h"
+#include "Checkpoint.h"
+#include "LoadProfile.h"
+#include "NodeLog.h"
+#include "StateProfiler.h"
 
 extern xSemaphoreHandle xSemaphore;
 extern Modbus::ResultCode err;
+extern StateMachine* stateMachine;
 
 const uint16_t NUM_COILS = 6;
 const uint16_t NUM_HOLDREGS_SETTING = 20;
 const uint16_t NUM_HOLDREGS_DATA = 11 * 5;
-const uint16_t NUM_HOLDREGS = NUM_HOLDREGS_SETTING + NUM_HOLDREGS_DATA;
+// Edge trace window: count, page select, then 8 events of 4 registers
+const uint16_t TRACE_EVENTS_PER_PAGE = 8;
+const uint16_t NUM_HOLDREGS_TRACE = 2 + TRACE_EVENTS_PER_PAGE * 4;
+// Switch-time statistics: count plus mean, stddev, min, max, p50, p95, p99
+// as 32-bit microsecond pairs, per load level
+const uint16_t STATS_REGS_PER_LEVEL = 15;
+const uint16_t NUM_HOLDREGS_STATS = STATS_REGS_PER_LEVEL * 5;
+// Efficiency: 0.01 %, input/output W, input/output mWh as hi/lo pairs,
+// aligned pairs and valid flag, per load level
+const uint16_t EFFICIENCY_REGS_PER_LEVEL = 9;
+const uint16_t NUM_HOLDREGS_EFFICIENCY = EFFICIENCY_REGS_PER_LEVEL * 5;
+// Waveform: rms/peak dV, crest, THD, frequency, sample rate, whole cycles,
+// overruns and valid flag of the last capture, then the decimated trace
+const uint16_t WAVEFORM_SUMMARY_REGS = 9;
+const uint16_t NUM_HOLDREGS_WAVEFORM
+    = WAVEFORM_SUMMARY_REGS + 1 + WaveformTestData::TRACE_LENGTH;
+// Load-step transient: step VA, baseline/minimum dV, dip and overshoot in
+// 0.01 %, recovery us as a hi/lo pair, sample rate, overruns, recovered and
+// valid flags of the last step
+const uint16_t NUM_HOLDREGS_TRANSIENT = 11;
+// Phase sweep: step count and worst step, then requested phase, landed
+// phase (0.1 deg) and switch time us as a hi/lo pair per step
+const uint16_t PHASE_REGS_PER_STEP = 4;
+const uint16_t NUM_HOLDREGS_PHASE
+    = 2 + PHASE_REGS_PER_STEP * SwithTestData::MAX_PHASE_STEPS;
+const uint16_t NUM_HOLDREGS = NUM_HOLDREGS_SETTING + NUM_HOLDREGS_DATA
+                              + NUM_HOLDREGS_TRACE + NUM_HOLDREGS_STATS
+                              + NUM_HOLDREGS_EFFICIENCY
+                              + NUM_HOLDREGS_WAVEFORM
+                              + NUM_HOLDREGS_TRANSIENT + NUM_HOLDREGS_PHASE;
 const uint16_t NUM_IREGS = 4;
+// State profiler, see StateProfiler::inputRegister()
+#if STATE_PROFILER_ENABLED
+const uint16_t NUM_IREGS_PROFILE = StateProfiler::NUM_REGISTERS;
+#else
+const uint16_t NUM_IREGS_PROFILE = 0;
+#endif
 
 uint16_t COIL_START_ADDRESS = 100;
 uint16_t IREG_START_ADDRESS = 200;
+uint16_t IREG_START_ADDRESS_PROFILE = IREG_START_ADDRESS + NUM_IREGS;
 uint16_t HREG_START_ADDRESS_SETTING = 1000;
 uint16_t HREG_START_ADDRESS_DATA
     = HREG_START_ADDRESS_SETTING + NUM_HOLDREGS_SETTING;
+uint16_t HREG_START_ADDRESS_TRACE
+    = HREG_START_ADDRESS_DATA + NUM_HOLDREGS_DATA;
+uint16_t HREG_START_ADDRESS_STATS
+    = HREG_START_ADDRESS_TRACE + NUM_HOLDREGS_TRACE;
+uint16_t HREG_START_ADDRESS_EFFICIENCY
+    = HREG_START_ADDRESS_STATS + NUM_HOLDREGS_STATS;
+uint16_t HREG_START_ADDRESS_WAVEFORM
+    = HREG_START_ADDRESS_EFFICIENCY + NUM_HOLDREGS_EFFICIENCY;
+uint16_t HREG_START_ADDRESS_TRANSIENT
+    = HREG_START_ADDRESS_WAVEFORM + NUM_HOLDREGS_WAVEFORM;
+uint16_t HREG_START_ADDRESS_PHASE
+    = HREG_START_ADDRESS_TRANSIENT + NUM_HOLDREGS_TRANSIENT;
+
+static uint16_t tracePage = 0;
+
+// First settings register is a command register
+enum ModbusCommand : uint16_t {
+  CMD_NONE = 0,
+  CMD_START_SWITCH_SWEEP = 1,
+  CMD_ABORT_TEST = 2,
+  CMD_START_EFFICIENCY = 3,
+  CMD_START_INPUT_SWEEP = 4,
+  CMD_START_WAVEFORM = 5,
+  CMD_START_TUNE_PWM = 6,
+  CMD_PLAY_LOAD_PROFILE = 7,
+  CMD_STOP_LOAD_PROFILE = 8,
+  CMD_START_TRANSIENT = 9,
+  CMD_START_PHASE_SWEEP = 10,
+  CMD_DUMP_STATE_TRACE = 11,
+  CMD_RESET_STATE_PROFILE = 12,
+  CMD_CLEAR_CHECKPOINT = 13,
+  CMD_EXPORT_TRANSITIONS = 14,
+  CMD_START_BACKUP = 15
+};
+
+// Settings registers after the command register. Switch test settings apply
+// from the next started sweep; the value read back is the one in effect.
+enum SettingRegister : uint16_t {
+  SET_COMMAND = 0,
+  SET_RECORD_EDGE_TRACE = 1,    // 1: switch time from the raw edge trace
+  SET_STAT_SHOTS = 2,           // Above 1: shots at one level into STATS
+  SET_PHASE_SYNC = 3,           // 1: cut at SET_CUT_PHASE, needs zero crossings
+  SET_CUT_PHASE = 4,            // Degrees into the mains cycle, 0 to 359
+  SET_EDGE_DRIVES_CAPTURE = 5,  // 1: UPS edge ISR moves the sweep on
+};
 
 uint16_t coilAddresses[NUM_COILS] = {};
 uint16_t hregAddresses[NUM_HOLDREGS] = {};
@@ -49,19 +135,320 @@ uint16_t cbCoilWrite(TRegister* reg, uint16_t val) {
   return val;
 }
 
-uint16_t cbHregSet(TRegister* reg, uint16_t val) { return val; }
+uint16_t cbHregSet(TRegister* reg, uint16_t val) {
+  uint16_t address = reg->address.address;
+  if (address == HREG_START_ADDRESS_TRACE + 1) {
+    tracePage = val;
+  } else if (address == HREG_START_ADDRESS_SETTING + SET_RECORD_EDGE_TRACE) {
+    val = val ? 1 : 0;
+    if (switchTest) {
+      switchTest->setRecordEdgeTrace(val);
+    }
+  } else if (address == HREG_START_ADDRESS_SETTING + SET_STAT_SHOTS) {
+    if (switchTest) {
+      switchTest->setStatShots(val);
+    }
+  } else if (address == HREG_START_ADDRESS_SETTING + SET_PHASE_SYNC) {
+    val = val ? 1 : 0;
+    if (switchTest) {
+      switchTest->setPhaseSync(val);
+    }
+  } else if (address == HREG_START_ADDRESS_SETTING + SET_CUT_PHASE) {
+    val %= 360;
+    if (switchTest) {
+      switchTest->setCutPhase(val);
+    }
+  } else if (address == HREG_START_ADDRESS_SETTING + SET_EDGE_DRIVES_CAPTURE) {
+    val = val ? 1 : 0;
+    if (switchTest) {
+      switchTest->setEdgeDrivesCapture(val);
+    }
+  } else if (address == HREG_START_ADDRESS_SETTING + SET_COMMAND) {
+    if (val == CMD_START_SWITCH_SWEEP) {
+      TestRegistry::start(TestType::SwitchTest);
+    } else if (val == CMD_START_BACKUP) {
+      TestRegistry::start(TestType::BackupTimeTest);
+    } else if (val == CMD_START_EFFICIENCY) {
+      TestRegistry::start(TestType::EfficiencyTest);
+    } else if (val == CMD_START_INPUT_SWEEP) {
+      TestRegistry::start(TestType::InputVoltageTest);
+    } else if (val == CMD_START_WAVEFORM) {
+      TestRegistry::start(TestType::WaveformTest);
+    } else if (val == CMD_START_TUNE_PWM) {
+      TestRegistry::start(TestType::TunePWMTest);
+    } else if (val == CMD_PLAY_LOAD_PROFILE) {
+      if (!TesterSetup || !LoadProfile::load()
+          || !LoadProfile::start(TesterSetup->hardwareSetup())) {
+        NODE_LOGW(LOAD_PROFILE_INVALID);
+      }
+    } else if (val == CMD_STOP_LOAD_PROFILE) {
+      LoadProfile::stop();
+    } else if (val == CMD_START_TRANSIENT) {
+      TestRegistry::start(TestType::TransientTest);
+    } else if (val == CMD_START_PHASE_SWEEP) {
+      if (switchTest) {
+        switchTest->requestPhaseSweep();
+      }
+      TestRegistry::start(TestType::SwitchTest);
+#if STATE_PROFILER_ENABLED
+    } else if (val == CMD_DUMP_STATE_TRACE) {
+      if (!StateProfiler::dumpChromeTrace()) {
+        NODE_LOGW(SM_TRACE_DUMP_FAILED);
+      }
+    } else if (val == CMD_RESET_STATE_PROFILE) {
+      StateProfiler::reset(NodeTask::IO_SETUP::now_us());
+#endif
+    } else if (val == CMD_CLEAR_CHECKPOINT) {
+      Checkpoint::clear();
+    } else if (val == CMD_EXPORT_TRANSITIONS) {
+      if (!stateMachine || !stateMachine->serializeTransitions()) {
+        NODE_LOGW(SM_TABLE_EXPORT_FAILED);
+      }
+    } else if (val == CMD_ABORT_TEST) {
+      for (size_t i = 0; i < TestRegistry::COUNT; ++i) {
+        TestRegistry::stop(static_cast<TestType>(i));
+      }
+    }
+    val = CMD_NONE;
+  }
+  return val;
+}
+
+static uint16_t traceRegister(int index) {
+  if (!switchTest) {
+    return 0;
+  }
+  const EdgeTrace& trace = switchTest->edgeTrace();
+  const uint16_t count = trace.size();
+  if (index == 0) {
+    return count;
+  }
+  if (index == 1) {
+    return tracePage;
+  }
+  int eventIndex = tracePage * TRACE_EVENTS_PER_PAGE + (index - 2) / 4;
+  if (eventIndex >= count) {
+    return 0;
+  }
+  const EdgeEvent& event = trace.events[eventIndex];
+  uint32_t time_us = static_cast<uint32_t>(event.timestamp_us);
+  switch ((index - 2) % 4) {
+    case 0:
+      return (time_us >> 16) & 0xFFFF;
+    case 1:
+      return time_us & 0xFFFF;
+    case 2:
+      return event.pin;
+    default:
+      return static_cast<uint16_t>(event.edge);
+  }
+}
+
+static uint16_t statsRegister(int index) {
+  if (!switchTest) {
+    return 0;
+  }
+  const SwitchTimeStats& stats
+      = switchTest->data().switchStats[index / STATS_REGS_PER_LEVEL];
+  int subIndex = index % STATS_REGS_PER_LEVEL;
+  if (subIndex == 0) {
+    return stats.count > UINT16_MAX ? UINT16_MAX : stats.count;
+  }
+
+  uint32_t value = 0;
+  switch ((subIndex - 1) / 2) {
+    case 0:
+      value = static_cast<uint32_t>(stats.mean_us);
+      break;
+    case 1:
+      value = static_cast<uint32_t>(stats.stddev());
+      break;
+    case 2:
+      value = stats.count ? stats.min_us : 0;
+      break;
+    case 3:
+      value = stats.max_us;
+      break;
+    case 4:
+      value = stats.percentile(50);
+      break;
+    case 5:
+      value = stats.percentile(95);
+      break;
+    default:
+      value = stats.percentile(99);
+      break;
+  }
+  return (subIndex % 2) ? (value >> 16) & 0xFFFF : value & 0xFFFF;
+}
+
+static uint16_t efficiencyRegister(int index) {
+  if (!efficiencyTest) {
+    return 0;
+  }
+  const EfficiencyTestData::TestData& test
+      = efficiencyTest->data()
+            .efficiencyTest[index / EFFICIENCY_REGS_PER_LEVEL];
+  switch (index % EFFICIENCY_REGS_PER_LEVEL) {
+    case 0:
+      return test.efficiency_x100;
+    case 1:
+      return test.inputPower_W;
+    case 2:
+      return test.outputPower_W;
+    case 3:
+      return (test.inputEnergy_mWh >> 16) & 0xFFFF;
+    case 4:
+      return test.inputEnergy_mWh & 0xFFFF;
+    case 5:
+      return (test.outputEnergy_mWh >> 16) & 0xFFFF;
+    case 6:
+      return test.outputEnergy_mWh & 0xFFFF;
+    case 7:
+      return test.pairs;
+    default:
+      return test.valid_data ? 1 : 0;
+  }
+}
+
+static uint16_t waveformRegister(int index) {
+  if (!waveformTest) {
+    return 0;
+  }
+  const WaveformTestData& data = waveformTest->data();
+  if (index > WAVEFORM_SUMMARY_REGS) {
+    int traceIndex = index - WAVEFORM_SUMMARY_REGS - 1;
+    return traceIndex < data.traceLength
+               ? static_cast<uint16_t>(data.trace[traceIndex])
+               : 0;
+  }
+  const WaveformTestData::TestData& test = data.waveformTest[0];
+  switch (index) {
+    case 0:
+      return test.rms_dV;
+    case 1:
+      return test.peak_dV;
+    case 2:
+      return test.crestFactor_x100;
+    case 3:
+      return test.thd_x100;
+    case 4:
+      return test.frequency_cHz;
+    case 5:
+      return test.sampleRate_Hz;
+    case 6:
+      return test.cycles;
+    case 7:
+      return test.overruns;
+    case 8:
+      return test.valid_data ? 1 : 0;
+    default:
+      return data.traceLength;
+  }
+}
+
+static uint16_t transientRegister(int index) {
+  if (!transientTest) {
+    return 0;
+  }
+  const TransientTestData::TestData& test
+      = transientTest->data().transientTest[0];
+  switch (index) {
+    case 0:
+      return test.stepVA;
+    case 1:
+      return test.baseline_dV;
+    case 2:
+      return test.minimum_dV;
+    case 3:
+      return test.dip_x100;
+    case 4:
+      return test.overshoot_x100;
+    case 5:
+      return (test.recovery_us >> 16) & 0xFFFF;
+    case 6:
+      return test.recovery_us & 0xFFFF;
+    case 7:
+      return test.sampleRate_Hz;
+    case 8:
+      return test.overruns;
+    case 9:
+      return test.recovered ? 1 : 0;
+    default:
+      return test.valid_data ? 1 : 0;
+  }
+}
+
+static uint16_t phaseRegister(int index) {
+  if (!switchTest) {
+    return 0;
+  }
+  const SwithTestData& data = switchTest->data();
+  if (index == 0) {
+    return data.phaseSteps;
+  }
+  if (index == 1) {
+    return data.worstPhaseStep;
+  }
+  int step = (index - 2) / PHASE_REGS_PER_STEP;
+  if (step >= data.phaseSteps) {
+    return 0;
+  }
+  const SwithTestData::PhaseResult& result = data.phaseSweep[step];
+  switch ((index - 2) % PHASE_REGS_PER_STEP) {
+    case 0:
+      return result.phase_deg;
+    case 1:
+      return result.firedPhase_x10;
+    case 2:
+      return (result.switchtime_us >> 16) & 0xFFFF;
+    default:
+      return result.switchtime_us & 0xFFFF;
+  }
+}
 
 // Callback function for holding register get
 uint16_t cbHregGet(TRegister* reg, uint16_t val) {
   uint16_t address = reg->address.address;
 
-  if (address >= HREG_START_ADDRESS_DATA) {
+  if (address >= HREG_START_ADDRESS_PHASE) {
+    int index = address - HREG_START_ADDRESS_PHASE;
+    if (index >= 0 && index < NUM_HOLDREGS_PHASE) {
+      val = phaseRegister(index);
+    }
+  } else if (address >= HREG_START_ADDRESS_TRANSIENT) {
+    int index = address - HREG_START_ADDRESS_TRANSIENT;
+    if (index >= 0 && index < NUM_HOLDREGS_TRANSIENT) {
+      val = transientRegister(index);
+    }
+  } else if (address >= HREG_START_ADDRESS_WAVEFORM) {
+    int index = address - HREG_START_ADDRESS_WAVEFORM;
+    if (index >= 0 && index < NUM_HOLDREGS_WAVEFORM) {
+      val = waveformRegister(index);
+    }
+  } else if (address >= HREG_START_ADDRESS_EFFICIENCY) {
+    int index = address - HREG_START_ADDRESS_EFFICIENCY;
+    if (index >= 0 && index < NUM_HOLDREGS_EFFICIENCY) {
+      val = efficiencyRegister(index);
+    }
+  } else if (address >= HREG_START_ADDRESS_STATS) {
+    int index = address - HREG_START_ADDRESS_STATS;
+    if (index >= 0 && index < NUM_HOLDREGS_STATS) {
+      val = statsRegister(index);
+    }
+  } else if (address >= HREG_START_ADDRESS_TRACE) {
+    int index = address - HREG_START_ADDRESS_TRACE;
+    if (index >= 0 && index < NUM_HOLDREGS_TRACE) {
+      val = traceRegister(index);
+    }
+  } else if (address >= HREG_START_ADDRESS_DATA) {
     // Handling data registers
     int index = address - HREG_START_ADDRESS_DATA;
     if (index >= 0 && index < NUM_HOLDREGS_DATA) {
       if (switchTest) {
         SwithTestData& testData = switchTest->data();
-        int switchTestIndex = index / 11;  // 11 registers per test
+        // 11 registers per test, switch/start/end times are in microseconds
+        int switchTestIndex = index / 11;
         int subIndex = index % 11;
         if (switchTestIndex < 5) {  // Ensure index is within bounds
           SwithTestData::TestData& test = testData.switchTest[switchTestIndex];
@@ -76,22 +463,22 @@ uint16_t cbHregGet(TRegister* reg, uint16_t val) {
               val = test.testTimestamp & 0xFFFF;
               break;
             case 3:
-              val = (test.switchtime >> 16) & 0xFFFF;
+              val = (test.switchtime_us >> 16) & 0xFFFF;
               break;
             case 4:
-              val = test.switchtime & 0xFFFF;
+              val = test.switchtime_us & 0xFFFF;
               break;
             case 5:
-              val = (test.starttime >> 16) & 0xFFFF;
+              val = (test.starttime_us >> 16) & 0xFFFF;
               break;
             case 6:
-              val = test.starttime & 0xFFFF;
+              val = test.starttime_us & 0xFFFF;
               break;
             case 7:
-              val = (test.endtime >> 16) & 0xFFFF;
+              val = (test.endtime_us >> 16) & 0xFFFF;
               break;
             case 8:
-              val = test.endtime & 0xFFFF;
+              val = test.endtime_us & 0xFFFF;
               break;
             case 9:
               val = test.load_percentage;
@@ -117,6 +504,17 @@ uint16_t cbHregGet(TRegister* reg, uint16_t val) {
   return val;
 }
 
+uint16_t cbIregGet(TRegister* reg, uint16_t val) {
+#if STATE_PROFILER_ENABLED
+  uint16_t address = reg->address.address;
+  if (address >= IREG_START_ADDRESS_PROFILE
+      && address < IREG_START_ADDRESS_PROFILE + NUM_IREGS_PROFILE) {
+    val = StateProfiler::inputRegister(address - IREG_START_ADDRESS_PROFILE);
+  }
+#endif
+  return val;
+}
+
 void modbusRTU_Init() {
 
   for (uint16_t i = 0; i < NUM_COILS; ++i) {
@@ -139,6 +537,10 @@ void modbusRTU_Init() {
     iregAddresses[i] = IREG_START_ADDRESS + i;
     mb.addIreg(iregAddresses[i]);
   }
+  if (NUM_IREGS_PROFILE > 0) {
+    mb.addIreg(IREG_START_ADDRESS_PROFILE, 0, NUM_IREGS_PROFILE);
+    mb.onGetIreg(IREG_START_ADDRESS_PROFILE, cbIregGet, NUM_IREGS_PROFILE);
+  }
 }
 
 void updateModbusRTU() {
@@ -147,6 +549,5 @@ void updateModbusRTU() {
   for (int i = 0; i < NUM_COILS; i++) {
     digitalWrite(coilPins[i], coilValues[i] == 0XFF00 ? HIGH : LOW);
   }
-  Serial.println("Printing mains power level...");
-  Serial.println(digitalRead(SENSE_MAINS_POWER_PIN));
+  NODE_LOGD(MODBUS_MAINS_LEVEL, digitalRead(SENSE_MAINS_POWER_PIN));
 }
\ No newline at end of file
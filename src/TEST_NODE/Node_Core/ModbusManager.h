@@ -1,22 +1,42 @@
 #ifndef MODBUS_MANAGER_H
 #define MODBUS_MANAGER_H
 #include "HardwareConfig.h"
+#include "EfficiencyTest.h"
 #include "ModbusRTU.h"
 #include "SwitchTest.h"
+#include "TransientTest.h"
+#include "WaveformTest.h"
 
 extern ModbusRTU mb;
 extern SwitchTest* switchTest;
+extern EfficiencyTest* efficiencyTest;
+extern WaveformTest* waveformTest;
+extern TransientTest* transientTest;
 
 extern const uint16_t NUM_COILS;
 extern const uint16_t NUM_HOLDREGS_SETTING;
 extern const uint16_t NUM_HOLDREGS_DATA;
+extern const uint16_t NUM_HOLDREGS_TRACE;
+extern const uint16_t NUM_HOLDREGS_STATS;
+extern const uint16_t NUM_HOLDREGS_EFFICIENCY;
+extern const uint16_t NUM_HOLDREGS_WAVEFORM;
+extern const uint16_t NUM_HOLDREGS_TRANSIENT;
+extern const uint16_t NUM_HOLDREGS_PHASE;
 extern const uint16_t NUM_HOLDREGS;
 extern const uint16_t NUM_IREGS;
+extern const uint16_t NUM_IREGS_PROFILE;
 
 extern uint16_t COIL_START_ADDRESS;
 extern uint16_t IREG_START_ADDRESS;
+extern uint16_t IREG_START_ADDRESS_PROFILE;
 extern uint16_t HREG_START_ADDRESS_SETTING;
 extern uint16_t HREG_START_ADDRESS_DATA;
+extern uint16_t HREG_START_ADDRESS_TRACE;
+extern uint16_t HREG_START_ADDRESS_STATS;
+extern uint16_t HREG_START_ADDRESS_EFFICIENCY;
+extern uint16_t HREG_START_ADDRESS_WAVEFORM;
+extern uint16_t HREG_START_ADDRESS_TRANSIENT;
+extern uint16_t HREG_START_ADDRESS_PHASE;
 
 extern uint16_t coilAddresses[];
 extern uint16_t hregAddresses[];
@@ -31,6 +51,8 @@ uint16_t cbCoilRead(TRegister* reg, uint16_t val);
 uint16_t cbHregSet(TRegister* reg, uint16_t val);
 // Callback function for holding register get
 uint16_t cbHregGet(TRegister* reg, uint16_t val);
+// State profiler input registers
+uint16_t cbIregGet(TRegister* reg, uint16_t val);
 void modbusRTU_Init();
 
 void updateModbusRTU();
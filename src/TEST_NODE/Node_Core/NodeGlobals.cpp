@@ -0,0 +1,56 @@
+#include "EdgeEventQueue.h"
+#include "HardwareSetup.h"
+#include "ModbusManager.h"
+#include "StateMachine.h"
+#include "UPSTest.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+// State shared by the test modules, kept out of main.cpp so host builds can
+// link the modules without the Arduino entry points
+
+// Edge timestamps are taken inside the ISR with the 64-bit esp_timer so the
+// measured switch time excludes task wake-up latency. Every edge is queued;
+// debouncing happens in the consumer task.
+EdgeEventQueue edgeEventQueue;
+TaskHandle_t edgeEventTaskHandle = NULL;
+
+SwitchTest* switchTest = nullptr;
+EfficiencyTest* efficiencyTest = nullptr;
+WaveformTest* waveformTest = nullptr;
+TransientTest* transientTest = nullptr;
+UPSTesterSetup* TesterSetup = nullptr;
+StateMachine* stateMachine = nullptr;
+
+SemaphoreHandle_t xSemaphore;
+
+Modbus::ResultCode err;
+
+ModbusRTU mb;
+
+static inline void IRAM_ATTR pushEdgeFromISR(uint8_t pin) {
+  EdgeEvent event;
+  event.timestamp_us = NodeTask::IO_SETUP::now_us();
+  event.pin = pin;
+  event.edge = NodeTask::IO_SETUP::readPinFromISR(pin)
+                   ? EdgeType::RISING_EDGE
+                   : EdgeType::FALLING_EDGE;
+  edgeEventQueue.push(event);
+
+  BaseType_t higherPriorityTaskWoken = pdFALSE;
+  if (stateMachine != nullptr) {
+    stateMachine->onEdgeFromISR(event, &higherPriorityTaskWoken);
+  }
+  if (edgeEventTaskHandle != NULL) {
+    vTaskNotifyGiveFromISR(edgeEventTaskHandle, &higherPriorityTaskWoken);
+  }
+  portYIELD_FROM_ISR(higherPriorityTaskWoken);
+}
+
+void IRAM_ATTR keyISR1(void* pvParameters) {
+  pushEdgeFromISR(SENSE_MAINS_POWER_PIN);
+}
+void IRAM_ATTR keyISR2(void* pvParameters) {
+  pushEdgeFromISR(SENSE_UPS_POWER_PIN);
+}
@@ -0,0 +1,174 @@
+#include "NodeLog.h"
+#include "HardwareSetup.h"
+#include "StateDefines.h"
+#include <Arduino.h>
+#include <stdio.h>
+
+namespace Node_Core {
+
+namespace {
+
+const char* const logFormats[] = {
+#define LOG_FORMAT(id, text) text,
+#include "LogFormats.def"
+#undef LOG_FORMAT
+};
+
+// Frame marker for NODE_LOG_BINARY output, followed by the raw LogRecord
+const uint8_t LOG_FRAME_MARKER[2] = {0xA5, 0x5A};
+
+}  // namespace
+
+NodeLog::Slot NodeLog::_slots[NodeLog::RING_SIZE];
+std::atomic<uint32_t> NodeLog::_head{0};
+std::atomic<uint32_t> NodeLog::_tail{0};
+std::atomic<uint32_t> NodeLog::_dropped{0};
+TaskHandle_t NodeLog::_taskHandle = NULL;
+
+void NodeLog::init(UBaseType_t priority, BaseType_t core) {
+  if (_taskHandle != NULL) {
+    return;
+  }
+  xTaskCreatePinnedToCore(logTask, "LogTask", 4096, NULL, priority,
+                          &_taskHandle, core);
+}
+
+// Bounded multi-producer ring: a producer claims a slot by advancing _head
+// with a CAS, the per-slot sequence tells the consumer when it is filled.
+// Sequences are stored relative to the slot index so the zero-initialised
+// ring is valid before init() and records logged during setup are kept.
+void NodeLog::push(uint8_t level, LogFmt fmt, const uint32_t* args,
+                   uint8_t nargs) {
+  uint32_t pos = _head.load(std::memory_order_relaxed);
+  Slot* slot;
+  while (true) {
+    slot = &_slots[pos & (RING_SIZE - 1)];
+    uint32_t seq = slot->sequence.load(std::memory_order_acquire)
+                   + (pos & (RING_SIZE - 1));
+    int32_t diff = static_cast<int32_t>(seq - pos);
+    if (diff == 0) {
+      if (_head.compare_exchange_weak(pos, pos + 1,
+                                      std::memory_order_relaxed)) {
+        break;
+      }
+    } else if (diff < 0) {
+      _dropped.fetch_add(1, std::memory_order_relaxed);
+      return;  // Ring full, never block the caller
+    } else {
+      pos = _head.load(std::memory_order_relaxed);
+    }
+  }
+
+  LogRecord& record = slot->record;
+  record.timestamp_us = static_cast<uint32_t>(NodeTask::IO_SETUP::now_us());
+  record.fmt = static_cast<uint16_t>(fmt);
+  record.level = level;
+  record.nargs = nargs;
+  for (uint8_t i = 0; i < 4; ++i) {
+    record.args[i] = args[i];
+  }
+  slot->sequence.store(pos + 1 - (pos & (RING_SIZE - 1)),
+                       std::memory_order_release);
+}
+
+bool NodeLog::pop(LogRecord& record) {
+  uint32_t pos = _tail.load(std::memory_order_relaxed);
+  uint32_t index = pos & (RING_SIZE - 1);
+  Slot& slot = _slots[index];
+  uint32_t seq = slot.sequence.load(std::memory_order_acquire) + index;
+  if (static_cast<int32_t>(seq - (pos + 1)) < 0) {
+    return false;
+  }
+  record = slot.record;
+  slot.sequence.store(pos + RING_SIZE - index, std::memory_order_release);
+  _tail.store(pos + 1, std::memory_order_relaxed);
+  return true;
+}
+
+const char* NodeLog::formatText(uint16_t fmt) {
+  return fmt < static_cast<uint16_t>(LogFmt::COUNT) ? logFormats[fmt]
+                                                    : "<unknown log format>";
+}
+
+size_t NodeLog::format(const LogRecord& record, char* buf, size_t len) {
+  const char* text = formatText(record.fmt);
+  size_t out = 0;
+  uint8_t arg = 0;
+
+  auto append = [&](const char* s) {
+    while (*s && out + 1 < len) {
+      buf[out++] = *s++;
+    }
+  };
+
+  while (*text && out + 1 < len) {
+    if (*text != '%' || text[1] == '\0') {
+      buf[out++] = *text++;
+      continue;
+    }
+    char spec = text[1];
+    text += 2;
+    uint32_t value = arg < record.nargs ? record.args[arg] : 0;
+    arg++;
+    char number[12];
+    switch (spec) {
+      case 'u':
+        snprintf(number, sizeof(number), "%lu", (unsigned long)value);
+        append(number);
+        break;
+      case 'd':
+        snprintf(number, sizeof(number), "%ld", (long)(int32_t)value);
+        append(number);
+        break;
+      case 'x':
+        snprintf(number, sizeof(number), "%lx", (unsigned long)value);
+        append(number);
+        break;
+      case 'S':
+        append(stateToString(static_cast<State>(value)));
+        break;
+      case 'E':
+        append(eventToString(static_cast<Event>(static_cast<int32_t>(value))));
+        break;
+      default:
+        arg--;  // Not a conversion, keep the argument
+        buf[out++] = spec;
+        break;
+    }
+  }
+  buf[out] = '\0';
+  return out;
+}
+
+void NodeLog::emit(const LogRecord& record) {
+#ifdef NODE_LOG_BINARY
+  Serial.write(LOG_FRAME_MARKER, sizeof(LOG_FRAME_MARKER));
+  Serial.write(reinterpret_cast<const uint8_t*>(&record), sizeof(record));
+#else
+  char line[128];
+  format(record, line, sizeof(line));
+  Serial.print("[");
+  Serial.print(record.timestamp_us);
+  Serial.print("] ");
+  Serial.println(line);
+#endif
+}
+
+void NodeLog::logTask(void* pvParameters) {
+  LogRecord record;
+  uint32_t reportedDrops = 0;
+  while (true) {
+    while (pop(record)) {
+      emit(record);
+    }
+    uint32_t drops = _dropped.load(std::memory_order_relaxed);
+    if (drops != reportedDrops) {
+      reportedDrops = drops;
+      NODE_LOGW(LOG_DROPPED, drops);
+    }
+    vTaskDelay(pdMS_TO_TICKS(20));
+  }
+  vTaskDelete(NULL);
+}
+
+}  // namespace Node_Core
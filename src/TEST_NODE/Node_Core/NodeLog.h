@@ -0,0 +1,129 @@
+#ifndef NODE_LOG_H
+#define NODE_LOG_H
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <type_traits>
+
+// Deferred logging: call sites store a compact record (format id + up to
+// four 32-bit args) in a lock-free ring and return. logTask formats and
+// prints the records at low priority, so measurement windows never block on
+// the UART.
+
+#define NODE_LOG_LEVEL_NONE 0
+#define NODE_LOG_LEVEL_ERROR 1
+#define NODE_LOG_LEVEL_WARN 2
+#define NODE_LOG_LEVEL_INFO 3
+#define NODE_LOG_LEVEL_DEBUG 4
+
+#ifndef NODE_LOG_LEVEL
+#define NODE_LOG_LEVEL NODE_LOG_LEVEL_INFO
+#endif
+
+namespace Node_Core {
+
+enum class LogFmt : uint16_t {
+#define LOG_FORMAT(id, text) id,
+#include "LogFormats.def"
+#undef LOG_FORMAT
+  COUNT
+};
+
+struct LogRecord {
+  uint32_t timestamp_us;
+  uint16_t fmt;
+  uint8_t level;
+  uint8_t nargs;
+  uint32_t args[4];
+};
+
+class NodeLog {
+public:
+  static constexpr size_t RING_SIZE = 128;  // Power of two
+
+  static void init(UBaseType_t priority = 1, BaseType_t core = 0);
+
+  template <typename... Args>
+  static void write(uint8_t level, LogFmt fmt, Args... args) {
+    static_assert(sizeof...(Args) <= 4, "at most four log arguments");
+    uint32_t values[4] = {toArg(args)...};
+    push(level, fmt, values, sizeof...(Args));
+  }
+
+  static uint32_t dropped() { return _dropped.load(); }
+  static const char* formatText(uint16_t fmt);
+  // Renders a record into buf, returns the number of characters written
+  static size_t format(const LogRecord& record, char* buf, size_t len);
+
+private:
+  struct Slot {
+    std::atomic<uint32_t> sequence;
+    LogRecord record;
+  };
+
+  static void push(uint8_t level, LogFmt fmt, const uint32_t* args,
+                   uint8_t nargs);
+  static bool pop(LogRecord& record);
+  static void logTask(void* pvParameters);
+  static void emit(const LogRecord& record);
+
+  template <typename T>
+  static uint32_t toArg(T value) {
+    static_assert(std::is_integral<T>::value || std::is_enum<T>::value,
+                  "log arguments must be integers or enums");
+    return static_cast<uint32_t>(value);
+  }
+
+  static Slot _slots[RING_SIZE];
+  static std::atomic<uint32_t> _head;
+  static std::atomic<uint32_t> _tail;
+  static std::atomic<uint32_t> _dropped;
+  static TaskHandle_t _taskHandle;
+};
+
+}  // namespace Node_Core
+
+// Levels above NODE_LOG_LEVEL expand to nothing, arguments included
+#if NODE_LOG_LEVEL >= NODE_LOG_LEVEL_ERROR
+#define NODE_LOGE(id, ...)                                                     \
+  Node_Core::NodeLog::write(NODE_LOG_LEVEL_ERROR, Node_Core::LogFmt::id,       \
+                            ##__VA_ARGS__)
+#else
+#define NODE_LOGE(id, ...) \
+  do {                     \
+  } while (0)
+#endif
+
+#if NODE_LOG_LEVEL >= NODE_LOG_LEVEL_WARN
+#define NODE_LOGW(id, ...)                                                     \
+  Node_Core::NodeLog::write(NODE_LOG_LEVEL_WARN, Node_Core::LogFmt::id,        \
+                            ##__VA_ARGS__)
+#else
+#define NODE_LOGW(id, ...) \
+  do {                     \
+  } while (0)
+#endif
+
+#if NODE_LOG_LEVEL >= NODE_LOG_LEVEL_INFO
+#define NODE_LOGI(id, ...)                                                     \
+  Node_Core::NodeLog::write(NODE_LOG_LEVEL_INFO, Node_Core::LogFmt::id,        \
+                            ##__VA_ARGS__)
+#else
+#define NODE_LOGI(id, ...) \
+  do {                     \
+  } while (0)
+#endif
+
+#if NODE_LOG_LEVEL >= NODE_LOG_LEVEL_DEBUG
+#define NODE_LOGD(id, ...)                                                     \
+  Node_Core::NodeLog::write(NODE_LOG_LEVEL_DEBUG, Node_Core::LogFmt::id,       \
+                            ##__VA_ARGS__)
+#else
+#define NODE_LOGD(id, ...) \
+  do {                     \
+  } while (0)
+#endif
+
+#endif  // NODE_LOG_H
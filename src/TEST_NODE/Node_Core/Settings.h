@@ -82,12 +82,17 @@ struct SetupTaskParams {
 
 struct SetupHardware {
   uint8_t pwmchannelNo = 0;
-  uint8_t pwmResolusion_bits = 8;
+  uint8_t pwmResolusion_bits = 14;  // LEDC, clamped to 14
   uint16_t pwmduty_set = 0;
   uint16_t adjust_pwm_25P = 0;
   uint16_t adjust_pwm_50P = 0;
   uint16_t adjust_pwm_75P = 0;
   uint16_t adjust_pwm_100P = 0;
+  // Soft start, each bank engages this long after the load change
+  uint16_t bankDelay_25P_us = 0;
+  uint16_t bankDelay_50P_us = 0;
+  uint16_t bankDelay_75P_us = 0;
+  uint16_t bankDelay_100P_us = 0;
   uint32_t pwm_frequency = 3000UL;
   unsigned long lastsetting_updated = 0UL;
 };
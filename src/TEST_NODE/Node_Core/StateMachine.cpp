@@ -1,87 +1,612 @@
 #include "StateMachine.h"
+#include "Checkpoint.h"
+#include "HardwareSetup.h"
+#include "NodeLog.h"
 #include "StateDefines.h"
+#include "StateProfiler.h"
+#include "esp_rom_crc.h"
+#include <LittleFS.h>
 #include <cstring>
-#include <iostream>
+
+using NodeTask::IO_SETUP;
+
 namespace Node_Core {
 
-StateMachine::StateMachine()
-    : current_state(State::DEVICE_SHUTDOWN), retry_count(0), max_retest(0) {}
+// Guards and actions referenced from the transition table
+struct StateTable {
+  static bool notConnected(const StateMachine& sm) {
+    return sm.current_state != State::DEVICE_CONNECTED;
+  }
+  static bool canRetryConnect(const StateMachine& sm) {
+    return notConnected(sm) && sm.retry_count < sm.max_retries;
+  }
+  static bool canRetest(const StateMachine& sm) {
+    return sm.retry_count < sm.max_retest;
+  }
+  static void countRetry(StateMachine& sm) { sm.retry_count++; }
+  // A retried sequence has passed its check
+  static void resetRetries(StateMachine& sm) { sm.retry_count = 0; }
+};
 
-StateMachine::~StateMachine() {}
+namespace {
 
-void StateMachine::handleEvent(Event event) {
+using Transition = StateMachine::Transition;
+template <State Start, Event EventTrigger, State Next,
+          StateMachine::ActionFunction Action = nullptr,
+          StateMachine::GuardFunction Guard = nullptr>
+using Row = StateMachine::Row<Start, EventTrigger, Next, Action, Guard>;
 
-  std::cout << "Handling event: " << eventToString(event)
-            << " from state: " << stateToString(current_state) << std::endl;
-
-  // Handle special case for WIFI_DISCONNECTED
-  if (event == Event::RETRY_CONNECT) {
-    if (current_state != State::DEVICE_CONNECTED) {
-      if (retry_count < max_retries) {
-        retry_count++;
-        setState(State::RECONNECT_NETWORK);
-      } else {
-        setState(State::NETWORK_TIMEOUT);
-      }
-      return;  // Exit early to prevent further processing
+constexpr Transition transition_table[] = {
+    // A connect retry from anywhere but DEVICE_CONNECTED, until max_retries
+    Row<StateMachine::ANY_STATE, Event::RETRY_CONNECT,
+        State::RECONNECT_NETWORK, &StateTable::countRetry,
+        &StateTable::canRetryConnect>::get_transition(),
+    Row<StateMachine::ANY_STATE, Event::RETRY_CONNECT, State::NETWORK_TIMEOUT,
+        nullptr, &StateTable::notConnected>::get_transition(),
+
+    // Device Initialization and Setup
+    Row<State::DEVICE_SHUTDOWN, Event::POWER_ON,
+        State::DEVICE_ON>::get_transition(),
+    Row<State::DEVICE_ON, Event::SELF_CHECK_OK,
+        State::DEVICE_OK>::get_transition(),
+    Row<State::DEVICE_OK, Event::WIFI_CONNECTED, State::DEVICE_CONNECTED,
+        &StateTable::resetRetries>::get_transition(),
+    Row<State::DEVICE_OK, Event::WIFI_DISCONNECTED,
+        State::DEVICE_DISCONNECTED>::get_transition(),
+    Row<State::RECONNECT_NETWORK, Event::WIFI_CONNECTED,
+        State::DEVICE_CONNECTED, &StateTable::resetRetries>::get_transition(),
+    Row<State::DEVICE_CONNECTED, Event::SETTING_LOADED,
+        State::DEVICE_READY>::get_transition(),
+
+    // Mode Selection
+    Row<State::DEVICE_READY, Event::MANUAL_OVERRRIDE,
+        State::MANUAL_MODE>::get_transition(),
+    Row<State::DEVICE_READY, Event::AUTO_TEST_CMD,
+        State::AUTO_MODE>::get_transition(),
+
+    // Switching Test Sequence
+    Row<State::AUTO_MODE, Event::LOAD_BANK_ONLINE,
+        State::SWITCHING_TEST_START>::get_transition(),
+    Row<State::SWITCHING_TEST_START, Event::TIMER_READY,
+        State::SWITCHING_TEST_25P_START>::get_transition(),
+    Row<State::SWITCHING_TEST_25P_START, Event::LOAD_ON_OFF_25P,
+        State::SWITCHING_TEST_25P_DONE>::get_transition(),
+    Row<State::SWITCHING_TEST_25P_DONE, Event::TIME_CAPTURE_OK,
+        State::SWITCHING_TEST_50P_START>::get_transition(),
+    Row<State::SWITCHING_TEST_50P_START, Event::LOAD_ON_OFF_50P,
+        State::SWITCHING_TEST_50P_DONE>::get_transition(),
+    Row<State::SWITCHING_TEST_50P_DONE, Event::TIME_CAPTURE_OK,
+        State::SWITCHING_TEST_75P_START>::get_transition(),
+    Row<State::SWITCHING_TEST_75P_START, Event::LOAD_ON_OFF_75P,
+        State::SWITCHING_TEST_75P_DONE>::get_transition(),
+    Row<State::SWITCHING_TEST_75P_DONE, Event::TIME_CAPTURE_OK,
+        State::SWITCHING_TEST_FULLLOAD_START>::get_transition(),
+    Row<State::SWITCHING_TEST_FULLLOAD_START, Event::FULL_LOAD_ON_OFF,
+        State::SWITCHING_TEST_FULLLOAD_DONE>::get_transition(),
+    Row<State::SWITCHING_TEST_FULLLOAD_DONE, Event::TIME_CAPTURE_OK,
+        State::SWITCHING_TEST_CHECK>::get_transition(),
+    Row<State::SWITCHING_TEST_CHECK, Event::TEST_SUCCESS,
+        State::SWITCHING_TEST_OK, &StateTable::resetRetries>::get_transition(),
+    Row<State::SWITCHING_TEST_OK, Event::SAVE,
+        State::SAVE_TEST_DATA>::get_transition(),
+
+    // CHECK restarts the sequence until max_retest, then gives up
+    Row<State::SWITCHING_TEST_CHECK, Event::TEST_FAILED,
+        State::SWITCHING_TEST_START, &StateTable::countRetry,
+        &StateTable::canRetest>::get_transition(),
+    Row<State::SWITCHING_TEST_CHECK, Event::TEST_FAILED,
+        State::SWITCHING_TEST_FAILED>::get_transition(),
+
+    // A failed load level goes to the check state for retry handling
+    Row<State::SWITCHING_TEST_25P_DONE, Event::TEST_FAILED,
+        State::SWITCHING_TEST_CHECK>::get_transition(),
+    Row<State::SWITCHING_TEST_50P_DONE, Event::TEST_FAILED,
+        State::SWITCHING_TEST_CHECK>::get_transition(),
+    Row<State::SWITCHING_TEST_75P_DONE, Event::TEST_FAILED,
+        State::SWITCHING_TEST_CHECK>::get_transition(),
+    Row<State::SWITCHING_TEST_FULLLOAD_DONE, Event::TEST_FAILED,
+        State::SWITCHING_TEST_CHECK>::get_transition(),
+    // Same for a level that failed after its UPS edge already posted
+    // TIME_CAPTURE_OK and moved the sequence on
+    Row<State::SWITCHING_TEST_50P_START, Event::TEST_FAILED,
+        State::SWITCHING_TEST_CHECK>::get_transition(),
+    Row<State::SWITCHING_TEST_75P_START, Event::TEST_FAILED,
+        State::SWITCHING_TEST_CHECK>::get_transition(),
+    Row<State::SWITCHING_TEST_FULLLOAD_START, Event::TEST_FAILED,
+        State::SWITCHING_TEST_CHECK>::get_transition(),
+
+    // Efficiency Test Sequence
+    Row<State::READY_NEXT_TEST, Event::INPUT_OUTPUT_READY,
+        State::EFFICIENCY_TEST_START>::get_transition(),
+    Row<State::EFFICIENCY_TEST_START, Event::MESURED_DATA_RECEIVED,
+        State::EFFICIENCY_TEST_DONE>::get_transition(),
+    Row<State::EFFICIENCY_TEST_DONE, Event::POWER_MEASURE_OK,
+        State::EFFICIENCY_TEST_CHECK>::get_transition(),
+    Row<State::EFFICIENCY_TEST_CHECK, Event::TEST_SUCCESS,
+        State::EFFICIENCY_TEST_OK, &StateTable::resetRetries>::get_transition(),
+    Row<State::EFFICIENCY_TEST_OK, Event::SAVE,
+        State::SAVE_TEST_DATA>::get_transition(),
+    Row<State::EFFICIENCY_TEST_CHECK, Event::TEST_FAILED,
+        State::EFFICIENCY_TEST_START, &StateTable::countRetry,
+        &StateTable::canRetest>::get_transition(),
+    Row<State::EFFICIENCY_TEST_CHECK, Event::TEST_FAILED,
+        State::EFFICIENCY_TEST_FAILED>::get_transition(),
+
+    // Backup Time Test Sequence
+    Row<State::READY_NEXT_TEST, Event::TIMER_READY,
+        State::BACKUP_TIME_TEST_START>::get_transition(),
+    Row<State::BACKUP_TIME_TEST_START, Event::MESURED_DATA_RECEIVED,
+        State::BACKUP_TIME_TEST_DONE>::get_transition(),
+    Row<State::BACKUP_TIME_TEST_DONE, Event::VALID_BACKUP_TIME,
+        State::BACKUP_TIME_TEST_CHECK>::get_transition(),
+    Row<State::BACKUP_TIME_TEST_CHECK, Event::TEST_SUCCESS,
+        State::BACKUP_TIME_TEST_OK,
+        &StateTable::resetRetries>::get_transition(),
+    Row<State::BACKUP_TIME_TEST_OK, Event::SAVE,
+        State::ALL_TEST_DONE>::get_transition(),
+    Row<State::BACKUP_TIME_TEST_CHECK, Event::TEST_FAILED,
+        State::BACKUP_TIME_TEST_START, &StateTable::countRetry,
+        &StateTable::canRetest>::get_transition(),
+    Row<State::BACKUP_TIME_TEST_CHECK, Event::TEST_FAILED,
+        State::BACKUP_TIME_TEST_FAILED>::get_transition(),
+
+    // Test Data Handling
+    Row<State::SAVE_TEST_DATA, Event::DATA,
+        State::READY_NEXT_TEST>::get_transition(),
+    Row<State::ALL_TEST_DONE, Event::TRANSPORT_DATA,
+        State::REPORT_AVAILABLE>::get_transition(),
+    Row<State::REPORT_AVAILABLE, Event::PRINT_DATA,
+        State::PRINT_TEST_DATA>::get_transition(),
+    Row<State::ALL_TEST_DONE, Event::MANUAL_DATA_ENTRY,
+        State::ADDENDUM_TEST_DATA>::get_transition(),
+    Row<State::ADDENDUM_TEST_DATA, Event::TRANSPORT_DATA,
+        State::REPORT_AVAILABLE>::get_transition(),
+
+    // Fault Handling
+    Row<State::DEVICE_READY, Event::SYSTEM_FAULT,
+        State::FAULT>::get_transition(),
+    Row<State::FAULT, Event::RETRY_OK, State::DEVICE_READY>::get_transition(),
+    Row<State::FAULT, Event::RESTART, State::DEVICE_ON>::get_transition()};
+
+constexpr size_t ROW_COUNT
+    = sizeof(transition_table) / sizeof(transition_table[0]);
+constexpr uint8_t NO_ROW = 0xFF;
+static_assert(ROW_COUNT < NO_ROW, "row indices are stored in a uint8_t");
+
+// Compile-time index lists, split in halves to keep template depth low
+template <size_t... I>
+struct IndexList {};
+template <typename A, typename B>
+struct ConcatIndices;
+template <size_t... A, size_t... B>
+struct ConcatIndices<IndexList<A...>, IndexList<B...>> {
+  using type = IndexList<A..., (sizeof...(A) + B)...>;
+};
+template <size_t N>
+struct MakeIndices {
+  using type =
+      typename ConcatIndices<typename MakeIndices<N / 2>::type,
+                             typename MakeIndices<N - N / 2>::type>::type;
+};
+template <>
+struct MakeIndices<0> {
+  using type = IndexList<>;
+};
+template <>
+struct MakeIndices<1> {
+  using type = IndexList<0>;
+};
+
+constexpr bool rowMatches(const Transition& row, State state, Event event) {
+  return row.event == event
+         && (row.current_state == state
+             || row.current_state == StateMachine::ANY_STATE);
+}
+
+// First row at or after `from` for (state, event), first match wins
+constexpr uint8_t findRow(State state, Event event, size_t from) {
+  return from == ROW_COUNT ? NO_ROW
+         : rowMatches(transition_table[from], state, event)
+             ? static_cast<uint8_t>(from)
+             : findRow(state, event, from + 1);
+}
+
+// Next row with the same start state and event, taken when a guard fails
+constexpr uint8_t findFallback(size_t row, size_t from) {
+  return from == ROW_COUNT ? NO_ROW
+         : transition_table[from].current_state
+                     == transition_table[row].current_state
+                 && transition_table[from].event == transition_table[row].event
+             ? static_cast<uint8_t>(from)
+             : findFallback(row, from + 1);
+}
+
+struct DispatchTable {
+  // [state * EVENT_COUNT + event] -> first row, NO_ROW when unhandled
+  uint8_t row[StateMachine::STATE_COUNT * StateMachine::EVENT_COUNT];
+  uint8_t fallback[ROW_COUNT];
+};
+
+template <size_t... Cell, size_t... RowIndex>
+constexpr DispatchTable buildDispatch(IndexList<Cell...>,
+                                     IndexList<RowIndex...>) {
+  return {{findRow(static_cast<State>(Cell / StateMachine::EVENT_COUNT),
+                   static_cast<Event>(Cell % StateMachine::EVENT_COUNT), 0)...},
+          {findFallback(RowIndex, RowIndex + 1)...}};
+}
+
+constexpr DispatchTable dispatchTable = buildDispatch(
+    MakeIndices<StateMachine::STATE_COUNT
+                * StateMachine::EVENT_COUNT>::type(),
+    MakeIndices<ROW_COUNT>::type());
+
+// Tables loaded from flash name guards and actions by id, in TableGuard and
+// TableAction order
+const StateMachine::GuardFunction guardById[] = {
+    nullptr, &StateTable::notConnected, &StateTable::canRetryConnect,
+    &StateTable::canRetest};
+const StateMachine::ActionFunction actionById[] = {
+    nullptr, &StateTable::countRetry, &StateTable::resetRetries};
+static_assert(sizeof(guardById) / sizeof(guardById[0])
+                  == static_cast<size_t>(TableGuard::COUNT),
+              "one guard per TableGuard id");
+static_assert(sizeof(actionById) / sizeof(actionById[0])
+                  == static_cast<size_t>(TableAction::COUNT),
+              "one action per TableAction id");
+static_assert(NO_ROW == TransitionRecord::NO_ROW
+                  && ROW_COUNT <= StateMachine::MAX_TABLE_ROWS,
+              "built-in table must fit the binary format");
+
+constexpr size_t TABLE_CELLS
+    = StateMachine::STATE_COUNT * StateMachine::EVENT_COUNT;
+
+constexpr size_t imageSize(size_t rows) {
+  return sizeof(TransitionTableHeader)
+         + rows * (sizeof(TransitionRecord) + 1) + TABLE_CELLS;
+}
+
+// File image of the loaded table, dispatched from in place, or scratch for
+// exporting the built-in one
+uint8_t tableImage[imageSize(StateMachine::MAX_TABLE_ROWS)];
+Transition loadedRows[StateMachine::MAX_TABLE_ROWS];
+
+template <typename F, size_t N>
+uint8_t idOf(const F (&table)[N], F function) {
+  for (size_t id = 0; id < N; ++id) {
+    if (table[id] == function) {
+      return id;
     }
   }
+  return 0;
+}
+
+uint32_t imageCrc(const uint8_t* image, size_t size) {
+  return esp_rom_crc32_le(0, image + sizeof(TransitionTableHeader),
+                          size - sizeof(TransitionTableHeader));
+}
 
-  // Handle re-test events based on the new transition table
-  if (event == Event::TEST_FAILED) {
-    switch (current_state) {
-      case State::SWITCHING_TEST_CHECK:
-        if (retry_count < max_retest) {
-          retry_count++;
-          setState(State::SWITCHING_TEST_START);  // Restart the switching test
-        } else {
-          setState(State::SWITCHING_TEST_FAILED);  // Max retries exceeded
-        }
-        return;
-
-      case State::EFFICIENCY_TEST_CHECK:
-        if (retry_count < max_retest) {
-          retry_count++;
-          setState(State::EFFICIENCY_TEST_START);  // Restart the efficiency
-                                                   // test
-        } else {
-          setState(State::EFFICIENCY_TEST_FAILED);  // Max retries exceeded
-        }
-        return;
-
-      case State::BACKUP_TIME_TEST_CHECK:
-        if (retry_count < max_retest) {
-          retry_count++;
-          setState(State::BACKUP_TIME_TEST_START);  // Restart the backup time
-                                                    // test
-        } else {
-          setState(State::BACKUP_TIME_TEST_FAILED);  // Max retries exceeded
-        }
-        return;
-
-      default:
-        // No specific handling for other states
-        break;
+size_t encodeBuiltin(uint8_t* image) {
+  TransitionTableHeader header = {};
+  header.magic = TransitionTableHeader::MAGIC;
+  header.version = TransitionTableHeader::VERSION;
+  header.stateCount = StateMachine::STATE_COUNT;
+  header.eventCount = StateMachine::EVENT_COUNT;
+  header.rowCount = ROW_COUNT;
+  TransitionRecord* records
+      = reinterpret_cast<TransitionRecord*>(image + sizeof(header));
+  for (size_t i = 0; i < ROW_COUNT; ++i) {
+    const Transition& row = transition_table[i];
+    records[i].state = row.current_state == StateMachine::ANY_STATE
+                           ? TransitionRecord::ANY_STATE
+                           : static_cast<uint8_t>(row.current_state);
+    records[i].event = static_cast<uint8_t>(row.event);
+    records[i].next = static_cast<uint8_t>(row.next_state);
+    records[i].action = idOf(actionById, row.action);
+    records[i].guard = idOf(guardById, row.guard);
+  }
+  uint8_t* index = reinterpret_cast<uint8_t*>(records + ROW_COUNT);
+  memcpy(index, dispatchTable.row, TABLE_CELLS);
+  memcpy(index + TABLE_CELLS, dispatchTable.fallback, ROW_COUNT);
+  const size_t size = imageSize(ROW_COUNT);
+  header.crc = imageCrc(image, size);
+  memcpy(image, &header, sizeof(header));
+  return size;
+}
+
+// Bounds only: every id and row index in range and fallbacks moving
+// forward, so a bad table can misroute events but never loop or read past
+// the image
+bool validImage(const uint8_t* image, size_t size) {
+  TransitionTableHeader header;
+  if (size < sizeof(header)) {
+    return false;
+  }
+  memcpy(&header, image, sizeof(header));
+  if (header.magic != TransitionTableHeader::MAGIC
+      || header.version != TransitionTableHeader::VERSION
+      || header.stateCount != StateMachine::STATE_COUNT
+      || header.eventCount != StateMachine::EVENT_COUNT
+      || header.rowCount == 0
+      || header.rowCount > StateMachine::MAX_TABLE_ROWS
+      || size != imageSize(header.rowCount)
+      || header.crc != imageCrc(image, size)) {
+    return false;
+  }
+  const size_t rows = header.rowCount;
+  const TransitionRecord* records
+      = reinterpret_cast<const TransitionRecord*>(image + sizeof(header));
+  for (size_t i = 0; i < rows; ++i) {
+    const TransitionRecord& record = records[i];
+    if ((record.state >= StateMachine::STATE_COUNT
+         && record.state != TransitionRecord::ANY_STATE)
+        || record.event >= StateMachine::EVENT_COUNT
+        || record.next >= StateMachine::STATE_COUNT
+        || record.action >= static_cast<uint8_t>(TableAction::COUNT)
+        || record.guard >= static_cast<uint8_t>(TableGuard::COUNT)) {
+      return false;
+    }
+  }
+  const uint8_t* index = reinterpret_cast<const uint8_t*>(records + rows);
+  for (size_t cell = 0; cell < TABLE_CELLS; ++cell) {
+    if (index[cell] != NO_ROW && index[cell] >= rows) {
+      return false;
     }
   }
+  const uint8_t* fallback = index + TABLE_CELLS;
+  for (size_t i = 0; i < rows; ++i) {
+    if (fallback[i] != NO_ROW && (fallback[i] <= i || fallback[i] >= rows)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+StateMachine::StateMachine()
+    : _rows(transition_table),
+      _rowIndex(dispatchTable.row),
+      _fallback(dispatchTable.fallback),
+      current_state(State::DEVICE_SHUTDOWN),
+      retry_count(0) {}
+
+StateMachine::~StateMachine() {
+  if (_task != NULL) {
+    vTaskDelete(_task);
+  }
+  if (_queue != NULL) {
+    vQueueDelete(_queue);
+  }
+}
 
-  // Manually search for the transition
-  for (const auto &transition : transition_table) {
-    if (transition.current_state == current_state
-        && (transition.event == event || transition.event == Event::NONE)) {
-      if (!transition.guard || transition.guard()) {
-        setState(transition.next_state);
-        if (transition.action) {
-          transition.action();
-        }
-        // Reset retry_count after successful transition
-        retry_count = 0;
+bool StateMachine::begin(UBaseType_t priority, BaseType_t core) {
+  if (_task != NULL) {
+    return true;
+  }
+  _queue = xQueueCreateStatic(EVENT_QUEUE_LENGTH, sizeof(QueuedEvent),
+                              _queueStorage, &_queueBuffer);
+  if (_queue == NULL) {
+    return false;
+  }
+  return xTaskCreatePinnedToCore(stateMachineTask, "StateMachineTask", 4096,
+                                 this, priority, &_task, core)
+         == pdPASS;
+}
+
+// The only place transitions run once begin() has been called, so no lock
+// is needed around the table walk
+void StateMachine::stateMachineTask(void* pvParameters) {
+  StateMachine* sm = static_cast<StateMachine*>(pvParameters);
+  QueuedEvent item;
+  while (true) {
+    if (xQueueReceive(sm->_queue, &item, portMAX_DELAY) != pdTRUE) {
+      continue;
+    }
+    uint8_t handled = 0;
+    do {
+      sm->dispatch(item.event, item.timestamp_us);
+      if (item.done != NULL) {
+        xSemaphoreGive(item.done);
+      }
+    } while (++handled < EVENT_BATCH
+             && xQueueReceive(sm->_queue, &item, 0) == pdTRUE);
+    taskYIELD();
+  }
+  vTaskDelete(NULL);
+}
+
+void StateMachine::handleEvent(Event event) {
+  if (_task == NULL || xTaskGetCurrentTaskHandle() == _task) {
+    dispatch(event, IO_SETUP::now_us());
+    return;
+  }
+  // The semaphore lives on the caller's stack for the duration of the wait
+  StaticSemaphore_t doneBuffer;
+  QueuedEvent item = {event, IO_SETUP::now_us(),
+                      xSemaphoreCreateBinaryStatic(&doneBuffer)};
+  xQueueSend(_queue, &item, portMAX_DELAY);
+  xSemaphoreTake(item.done, portMAX_DELAY);
+  vSemaphoreDelete(item.done);
+}
+
+bool StateMachine::post(Event event) {
+  if (_task == NULL) {
+    dispatch(event, IO_SETUP::now_us());
+    return true;
+  }
+  QueuedEvent item = {event, IO_SETUP::now_us(), NULL};
+  if (xQueueSend(_queue, &item, 0) != pdTRUE) {
+    _dropped++;
+    return false;
+  }
+  return true;
+}
+
+bool IRAM_ATTR StateMachine::postFromISR(Event event,
+                                         BaseType_t* higherPriorityTaskWoken) {
+  QueuedEvent item = {event, IO_SETUP::now_us(), NULL};
+  return enqueueFromISR(item, higherPriorityTaskWoken);
+}
+
+bool IRAM_ATTR StateMachine::enqueueFromISR(
+    const QueuedEvent& item, BaseType_t* higherPriorityTaskWoken) {
+  if (_queue == NULL
+      || xQueueSendFromISR(_queue, &item, higherPriorityTaskWoken) != pdTRUE) {
+    _dropped++;
+    return false;
+  }
+  return true;
+}
+
+void StateMachine::flush() { handleEvent(Event::NONE); }
+
+void StateMachine::armEdgeEvent(uint8_t pin, EdgeType edge, Event event) {
+  _edgeArmed = false;
+  _edgePin = pin;
+  _edgeType = edge;
+  _edgeEvent = event;
+  _edgeFired = false;
+  _edgeArmed = true;
+}
+
+bool StateMachine::disarmEdgeEvent() {
+  _edgeArmed = false;
+  return _edgeFired;
+}
+
+// Called from the sense-pin ISRs; the event carries the edge timestamp
+void IRAM_ATTR StateMachine::onEdgeFromISR(
+    const EdgeEvent& edge, BaseType_t* higherPriorityTaskWoken) {
+  if (!_edgeArmed || edge.pin != _edgePin || edge.edge != _edgeType) {
+    return;
+  }
+  bool armed = true;
+  if (_edgeArmed.compare_exchange_strong(armed, false)) {
+    QueuedEvent item = {_edgeEvent, edge.timestamp_us, NULL};
+    _edgeFired = enqueueFromISR(item, higherPriorityTaskWoken);
+  }
+}
+
+// One indexed load picks the row; guards only matter for the retry rows
+void StateMachine::dispatch(Event event, int64_t timestamp_us) {
+  const size_t state = static_cast<size_t>(current_state.load());
+  const size_t eventIndex = static_cast<size_t>(event);
+  if (state >= STATE_COUNT || eventIndex >= EVENT_COUNT) {
+    return;  // Event::NONE from flush() and out of range values
+  }
+  _lastEvent_us = timestamp_us;
+  NODE_LOGI(SM_HANDLE_EVENT, event, current_state.load());
+
+  uint8_t row = _rowIndex[state * EVENT_COUNT + eventIndex];
+  while (row != NO_ROW) {
+    const Transition& transition = _rows[row];
+    if (!transition.guard || transition.guard(*this)) {
+      transitionTo(transition.next_state, timestamp_us);
+      if (transition.action) {
+        transition.action(*this);
       }
-      return;  // Exit after handling the event
+      saveState(transition.next_state);  // After the action's retry count
+      return;
     }
+    row = _fallback[row];
+  }
+}
+
+State StateMachine::getCurrentState() const { return current_state; }
+
+bool StateMachine::serializeTransitions(const char* filename) {
+  size_t size;
+  if (_tableLoaded) {
+    TransitionTableHeader header;
+    memcpy(&header, tableImage, sizeof(header));
+    size = imageSize(header.rowCount);
+  } else {
+    size = encodeBuiltin(tableImage);
+  }
+  if (!LittleFS.begin(true)) {
+    return false;
   }
+  File file = LittleFS.open(filename, "w");
+  if (!file) {
+    return false;
+  }
+  bool ok = file.write(tableImage, size) == size;
+  file.close();
+  return ok;
 }
 
-// Convert State enum to string
+bool StateMachine::deserializeTransitions(const char* filename) {
+  if (_task != NULL || !LittleFS.begin(true)) {
+    return false;
+  }
+  // A missing file is a plain build without a table; a file that is there
+  // but unreadable or fails validation is reported as rejected below
+  if (!LittleFS.exists(filename)) {
+    NODE_LOGI(SM_TABLE_MISSING);
+    return false;
+  }
+  File file = LittleFS.open(filename, "r");
+  if (!file) {
+    NODE_LOGW(SM_TABLE_INVALID);
+    return false;
+  }
+  // Back to the built-in rows first, the image is about to be overwritten
+  _rows = transition_table;
+  _rowIndex = dispatchTable.row;
+  _fallback = dispatchTable.fallback;
+  _tableLoaded = false;
+
+  const size_t size = file.size();
+  bool ok = size <= sizeof(tableImage)
+            && file.read(tableImage, size) == size;
+  file.close();
+  if (!ok || !validImage(tableImage, size)) {
+    NODE_LOGW(SM_TABLE_INVALID);
+    return false;
+  }
+  TransitionTableHeader header;
+  memcpy(&header, tableImage, sizeof(header));
+  const TransitionRecord* records
+      = reinterpret_cast<const TransitionRecord*>(tableImage + sizeof(header));
+  for (size_t i = 0; i < header.rowCount; ++i) {
+    const TransitionRecord& record = records[i];
+    Transition& row = loadedRows[i];
+    row.current_state = record.state == TransitionRecord::ANY_STATE
+                            ? ANY_STATE
+                            : static_cast<State>(record.state);
+    row.event = static_cast<Event>(record.event);
+    row.next_state = static_cast<State>(record.next);
+    row.action = actionById[record.action];
+    row.guard = guardById[record.guard];
+  }
+  _rows = loadedRows;
+  _rowIndex = reinterpret_cast<const uint8_t*>(records + header.rowCount);
+  _fallback = _rowIndex + TABLE_CELLS;
+  _tableLoaded = true;
+  NODE_LOGI(SM_TABLE_LOADED, header.rowCount);
+  return true;
+}
+
+void StateMachine::setState(State new_state) {
+  transitionTo(new_state, 0);
+  saveState(new_state);
+}
+
+void StateMachine::transitionTo(State new_state, int64_t eventTime_us) {
+  NODE_LOGI(SM_STATE_CHANGED, new_state);
+  STATE_PROFILE_TRANSITION(current_state.load(), new_state, eventTime_us,
+                           IO_SETUP::now_us());
+  current_state = new_state;
+}
+
+void StateMachine::saveState(State state) {
+  Checkpoint::saveState(state, static_cast<uint8_t>(retry_count.load()));
+}
+
+State StateMachine::loadState() {
+  retry_count = Checkpoint::retryCount();
+  // Records written before the end states stopped being resumable
+  return Checkpoint::safeState(Checkpoint::resumeState());
+}
 
 }  // namespace Node_Core
@@ -1,20 +1,33 @@
 #ifndef STATE_MACHINE_H_
 #define STATE_MACHINE_H_
 
+#include "EdgeEventQueue.h"
 #include "StateDefines.h"
-#include <array>
+#include "TransitionTable.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
 #include <atomic>
 #include <cstddef>
-#include <functional>
 
 namespace Node_Core {
 
 class StateMachine {
 
 public:
-  using GuardFunction = std::function<bool()>;
-  using ActionFunction = std::function<void()>;
-
+  using GuardFunction = bool (*)(const StateMachine&);
+  using ActionFunction = void (*)(StateMachine&);
+
+  static constexpr size_t STATE_COUNT = static_cast<size_t>(State::IDLE) + 1;
+  static constexpr size_t EVENT_COUNT
+      = static_cast<size_t>(Event::RESTART) + 1;
+  // Start state of a row that applies in every state
+  static constexpr State ANY_STATE = static_cast<State>(-1);
+
+  // Plain function pointers so the whole table is a constant in flash. A
+  // row whose guard fails falls back to the next row with the same start
+  // state and event, or leaves the event unhandled.
   struct Transition {
     State current_state;
     Event event;
@@ -23,155 +36,110 @@ public:
     GuardFunction guard;
   };
 
-  template <typename... Args>
-  static std::array<Transition, sizeof...(Args)> TransitionTable(Args... args) {
-    return {args.get_transition()...};
-  }
-
-  // Keeping the Row template with ActionEvent parameter
-  template <State Start, Event EventTrigger, State Next, Event ActionEvent>
+  template <State Start, Event EventTrigger, State Next,
+            ActionFunction Action = nullptr, GuardFunction Guard = nullptr>
   struct Row {
-    static Transition get_transition() {
-      return {Start, EventTrigger, Next,
-              []() { /* Action based on ActionEvent */ },
-              []() { return true; }};
+    static constexpr Transition get_transition() {
+      return {Start, EventTrigger, Next, Action, Guard};
     }
   };
 
+  // Events wait here for the state machine task. Items are copied into
+  // storage inside the object, so posting never allocates.
+  static constexpr size_t EVENT_QUEUE_LENGTH = 32;
+  // Events handled per wake before the task yields
+  static constexpr uint8_t EVENT_BATCH = 8;
+
+  struct QueuedEvent {
+    Event event;
+    int64_t timestamp_us;    // When it was posted, or the edge time
+    SemaphoreHandle_t done;  // Given once handled, NULL for post()
+  };
+
   StateMachine();
   ~StateMachine();
 
+  // Starts the state machine task; before this every call is handled inline
+  bool begin(UBaseType_t priority, BaseType_t core);
+
+  // Handled on the state machine task; a caller on another task blocks until
+  // the transition is done, so getCurrentState() afterwards is current
   void handleEvent(Event event);
-  State getCurrentState() const;
-  void serializeTransitions(const char *filename);
-  void deserializeTransitions(const char *filename);
+  // Fire and forget, never blocks; false and counted when the queue is full
+  bool post(Event event);
+  bool postFromISR(Event event, BaseType_t* higherPriorityTaskWoken);
+  // Returns once everything posted before the call has been handled
+  void flush();
+
+  // One-shot: the next matching edge seen by onEdgeFromISR() posts event
+  void armEdgeEvent(uint8_t pin, EdgeType edge, Event event);
+  // Disarms; true when the armed edge has posted its event
+  bool disarmEdgeEvent();
+  void onEdgeFromISR(const EdgeEvent& edge,
+                     BaseType_t* higherPriorityTaskWoken);
+
+  uint32_t droppedEvents() const { return _dropped; }
+  int64_t lastEventTime_us() const { return _lastEvent_us; }
 
-  void saveState(State state) {
-    // Save to persistent storage
-  }
+  State getCurrentState() const;
 
-  State loadState() {
-    // Load from persistent storage
-    return State::DEVICE_SHUTDOWN;
-  }
+  // Binary tables, see TransitionTable.h. TABLE_PATH comes from data/states
+  // in the LittleFS image; EXPORT_PATH receives the table in use.
+  static constexpr const char* TABLE_PATH = "/states/transitions.bin";
+  static constexpr const char* EXPORT_PATH = "/sm_table_export.bin";
+  static constexpr size_t MAX_TABLE_ROWS = 96;
+  // Writes the table in use, built-in or loaded
+  bool serializeTransitions(const char* filename = EXPORT_PATH);
+  // Replaces the built-in table with the one in filename. Only before
+  // begin(), since the rows are swapped without a lock. A missing, corrupt
+  // or mismatched file keeps the built-in table and returns false.
+  bool deserializeTransitions(const char* filename = TABLE_PATH);
+  bool tableLoaded() const { return _tableLoaded; }
+
+  // Checkpoints the state and retry count, see Checkpoint; every
+  // transition goes through here
+  void saveState(State state);
+  // Restores the checkpointed retry count and returns the state to resume
+  // in, DEVICE_SHUTDOWN when there is nothing to resume
+  State loadState();
 
   void setState(State new_state);
 
-#ifdef UNIT_TEST
-  void setMockAction(ActionFunction mock_action) {
-    this->mock_action = mock_action;
-  }
-
-  void setMockGuard(GuardFunction mock_guard) { this->mock_guard = mock_guard; }
-#endif
-
 private:
+  // Guards and actions of the transition table in StateMachine.cpp
+  friend struct StateTable;
+
+  void dispatch(Event event, int64_t timestamp_us);
+  // eventTime_us feeds the profiler's event-to-transition latency
+  void transitionTo(State new_state, int64_t eventTime_us);
+  bool enqueueFromISR(const QueuedEvent& item,
+                      BaseType_t* higherPriorityTaskWoken);
+  static void stateMachineTask(void* pvParameters);
+
+  QueueHandle_t _queue = NULL;
+  StaticQueue_t _queueBuffer;
+  uint8_t _queueStorage[EVENT_QUEUE_LENGTH * sizeof(QueuedEvent)];
+  TaskHandle_t _task = NULL;
+  std::atomic<uint32_t> _dropped{0};
+  int64_t _lastEvent_us = 0;
+
+  std::atomic<bool> _edgeArmed{false};
+  std::atomic<bool> _edgeFired{false};
+  uint8_t _edgePin = 0;
+  EdgeType _edgeType = EdgeType::RISING_EDGE;
+  Event _edgeEvent = Event::NONE;
+
+  // Rows, [state * EVENT_COUNT + event] -> first row, and guard fallbacks;
+  // the built-in tables unless deserializeTransitions() succeeded
+  const Transition* _rows;
+  const uint8_t* _rowIndex;
+  const uint8_t* _fallback;
+  bool _tableLoaded = false;
+
   std::atomic<State> current_state{State::DEVICE_SHUTDOWN};
   std::atomic<int> retry_count{0};
   const int max_retries = 3;
   const int max_retest = 2;
-
-  const std::array<Transition, 43> transition_table
-      = StateMachine::TransitionTable(
-          // Device Initialization and Setup
-          Row<State::DEVICE_SHUTDOWN, Event::POWER_ON, State::DEVICE_ON,
-              Event::NONE>(),
-          Row<State::DEVICE_ON, Event::SELF_CHECK_OK, State::DEVICE_OK,
-              Event::NONE>(),
-          Row<State::DEVICE_OK, Event::WIFI_CONNECTED, State::DEVICE_CONNECTED,
-              Event::NONE>(),
-          Row<State::DEVICE_OK, Event::WIFI_DISCONNECTED,
-              State::DEVICE_DISCONNECTED, Event::NONE>(),
-          Row<State::DEVICE_DISCONNECTED, Event::RETRY_CONNECT,
-              State::RECONNECT_NETWORK, Event::NONE>(),
-          Row<State::RECONNECT_NETWORK, Event::WIFI_CONNECTED,
-              State::DEVICE_CONNECTED, Event::NONE>(),
-          Row<State::DEVICE_CONNECTED, Event::SETTING_LOADED,
-              State::DEVICE_READY, Event::NONE>(),
-
-          // Mode Selection
-          Row<State::DEVICE_READY, Event::MANUAL_OVERRRIDE, State::MANUAL_MODE,
-              Event::NONE>(),
-          Row<State::DEVICE_READY, Event::AUTO_TEST_CMD, State::AUTO_MODE,
-              Event::NONE>(),
-
-          // Switching Test Sequence
-          Row<State::AUTO_MODE, Event::LOAD_BANK_ONLINE,
-              State::SWITCHING_TEST_START, Event::NONE>(),
-          Row<State::SWITCHING_TEST_START, Event::TIMER_READY,
-              State::SWITCHING_TEST_25P_START, Event::NONE>(),
-          Row<State::SWITCHING_TEST_25P_START, Event::LOAD_ON_OFF_25P,
-              State::SWITCHING_TEST_25P_DONE, Event::NONE>(),
-          Row<State::SWITCHING_TEST_25P_DONE, Event::TIME_CAPTURE_OK,
-              State::SWITCHING_TEST_50P_START, Event::NONE>(),
-          Row<State::SWITCHING_TEST_50P_START, Event::LOAD_ON_OFF_50P,
-              State::SWITCHING_TEST_50P_DONE, Event::NONE>(),
-          Row<State::SWITCHING_TEST_50P_DONE, Event::TIME_CAPTURE_OK,
-              State::SWITCHING_TEST_50P_DONE, Event::NONE>(),
-          Row<State::SWITCHING_TEST_50P_DONE, Event::TIME_CAPTURE_OK,
-              State::SWITCHING_TEST_75P_START, Event::NONE>(),
-          Row<State::SWITCHING_TEST_75P_START, Event::LOAD_ON_OFF_75P,
-              State::SWITCHING_TEST_75P_DONE, Event::NONE>(),
-          Row<State::SWITCHING_TEST_75P_DONE, Event::TIME_CAPTURE_OK,
-              State::SWITCHING_TEST_FULLLOAD_START, Event::NONE>(),
-          Row<State::SWITCHING_TEST_FULLLOAD_START, Event::FULL_LOAD_ON_OFF,
-              State::SWITCHING_TEST_FULLLOAD_DONE, Event::NONE>(),
-          Row<State::SWITCHING_TEST_FULLLOAD_DONE, Event::TIME_CAPTURE_OK,
-              State::SWITCHING_TEST_CHECK, Event::NONE>(),
-          Row<State::SWITCHING_TEST_CHECK, Event::TEST_SUCCESS,
-              State::SWITCHING_TEST_OK, Event::NONE>(),
-          Row<State::SWITCHING_TEST_OK, Event::SAVE, State::SAVE_TEST_DATA,
-              Event::NONE>(),
-
-          Row<State::SWITCHING_TEST_CHECK, Event::TEST_FAILED,
-              State::SWITCHING_TEST_START, Event::NONE>(),
-
-          // Efficiency Test Sequence
-          Row<State::READY_NEXT_TEST, Event::INPUT_OUTPUT_READY,
-              State::EFFICIENCY_TEST_START, Event::NONE>(),
-          Row<State::EFFICIENCY_TEST_START, Event::MESURED_DATA_RECEIVED,
-              State::EFFICIENCY_TEST_DONE, Event::NONE>(),
-          Row<State::EFFICIENCY_TEST_DONE, Event::POWER_MEASURE_OK,
-              State::EFFICIENCY_TEST_CHECK, Event::NONE>(),
-          Row<State::EFFICIENCY_TEST_CHECK, Event::TEST_SUCCESS,
-              State::EFFICIENCY_TEST_OK, Event::NONE>(),
-          Row<State::EFFICIENCY_TEST_OK, Event::SAVE, State::SAVE_TEST_DATA,
-              Event::NONE>(),
-          Row<State::EFFICIENCY_TEST_CHECK, Event::TEST_FAILED,
-              State::EFFICIENCY_TEST_START, Event::NONE>(),
-
-          // Backup Time Test Sequence
-          Row<State::READY_NEXT_TEST, Event::TIMER_READY,
-              State::BACKUP_TIME_TEST_START, Event::NONE>(),
-          Row<State::BACKUP_TIME_TEST_START, Event::MESURED_DATA_RECEIVED,
-              State::BACKUP_TIME_TEST_DONE, Event::NONE>(),
-          Row<State::BACKUP_TIME_TEST_DONE, Event::VALID_BACKUP_TIME,
-              State::BACKUP_TIME_TEST_CHECK, Event::NONE>(),
-          Row<State::BACKUP_TIME_TEST_CHECK, Event::TEST_SUCCESS,
-              State::BACKUP_TIME_TEST_OK, Event::NONE>(),
-          Row<State::BACKUP_TIME_TEST_OK, Event::SAVE, State::ALL_TEST_DONE,
-              Event::NONE>(),
-          Row<State::BACKUP_TIME_TEST_CHECK, Event::TEST_FAILED,
-              State::BACKUP_TIME_TEST_START, Event::NONE>(),
-
-          // Test Data Handling
-          Row<State::SAVE_TEST_DATA, Event::DATA, State::READY_NEXT_TEST,
-              Event::NONE>(),
-          Row<State::ALL_TEST_DONE, Event::TRANSPORT_DATA,
-              State::REPORT_AVAILABLE, Event::NONE>(),
-          Row<State::REPORT_AVAILABLE, Event::PRINT_DATA,
-              State::PRINT_TEST_DATA, Event::NONE>(),
-          Row<State::ALL_TEST_DONE, Event::MANUAL_DATA_ENTRY,
-              State::ADDENDUM_TEST_DATA, Event::NONE>(),
-          Row<State::ADDENDUM_TEST_DATA, Event::TRANSPORT_DATA,
-              State::REPORT_AVAILABLE, Event::NONE>(),
-
-          // Fault Handling
-          Row<State::DEVICE_READY, Event::SYSTEM_FAULT, State::FAULT,
-              Event::NONE>(),
-          Row<State::FAULT, Event::RETRY_OK, State::DEVICE_READY,
-              Event::NONE>(),
-          Row<State::FAULT, Event::RESTART, State::DEVICE_ON, Event::NONE>());
 };
 
 }  // namespace Node_Core
@@ -0,0 +1,164 @@
+#include "StateProfiler.h"
+
+#if STATE_PROFILER_ENABLED
+#include "HardwareSetup.h"
+#include <LittleFS.h>
+
+using NodeTask::IO_SETUP;
+
+namespace Node_Core {
+
+StateProfiler::StateStats StateProfiler::_stats[STATE_COUNT] = {};
+StateProfiler::TraceEntry StateProfiler::_trace[TRACE_LENGTH] = {};
+uint32_t StateProfiler::_traceCount = 0;
+State StateProfiler::_current = State::DEVICE_SHUTDOWN;
+int64_t StateProfiler::_enteredAt_us = 0;
+std::atomic<uint32_t> StateProfiler::_sequence{0};
+portMUX_TYPE StateProfiler::_writeLock = portMUX_INITIALIZER_UNLOCKED;
+
+void StateProfiler::onTransition(State from, State to, int64_t eventTime_us,
+                                 int64_t now_us) {
+  const size_t fromIndex = static_cast<size_t>(from);
+  const size_t toIndex = static_cast<size_t>(to);
+  if (fromIndex >= STATE_COUNT || toIndex >= STATE_COUNT) {
+    return;
+  }
+  uint32_t latency_us = 0;
+  if (eventTime_us > 0 && now_us > eventTime_us) {
+    int64_t latency = now_us - eventTime_us;
+    latency_us = latency > UINT32_MAX ? UINT32_MAX : latency;
+  }
+
+  portENTER_CRITICAL(&_writeLock);
+  _sequence.fetch_add(1, std::memory_order_acq_rel);  // Odd: writing
+  _stats[fromIndex].residency_us += now_us - _enteredAt_us;
+  StateStats& entered = _stats[toIndex];
+  entered.entries++;
+  if (eventTime_us > 0) {
+    entered.latencySum_us += latency_us;
+    entered.latencyCount++;
+    if (latency_us > entered.maxLatency_us) {
+      entered.maxLatency_us = latency_us;
+    }
+  }
+  _current = to;
+  _enteredAt_us = now_us;
+  TraceEntry& entry = _trace[_traceCount % TRACE_LENGTH];
+  entry.time_us = now_us;
+  entry.latency_us = latency_us;
+  entry.state = static_cast<uint8_t>(toIndex);
+  _traceCount++;
+  _sequence.fetch_add(1, std::memory_order_release);
+  portEXIT_CRITICAL(&_writeLock);
+}
+
+StateProfiler::StateStats StateProfiler::snapshot(State state,
+                                                  int64_t now_us) {
+  const size_t index = static_cast<size_t>(state);
+  StateStats copy = {};
+  if (index >= STATE_COUNT) {
+    return copy;
+  }
+  uint32_t before;
+  State current;
+  int64_t enteredAt_us;
+  do {
+    before = _sequence.load(std::memory_order_acquire);
+    copy = _stats[index];
+    current = _current;
+    enteredAt_us = _enteredAt_us;
+  } while ((before & 1)
+           || before != _sequence.load(std::memory_order_acquire));
+  if (current == state && now_us > enteredAt_us) {
+    copy.residency_us += now_us - enteredAt_us;
+  }
+  return copy;
+}
+
+void StateProfiler::reset(int64_t now_us) {
+  portENTER_CRITICAL(&_writeLock);
+  _sequence.fetch_add(1, std::memory_order_acq_rel);
+  for (StateStats& stats : _stats) {
+    stats = StateStats();
+  }
+  _traceCount = 0;
+  _enteredAt_us = now_us;
+  _sequence.fetch_add(1, std::memory_order_release);
+  portEXIT_CRITICAL(&_writeLock);
+}
+
+uint16_t StateProfiler::inputRegister(uint16_t index) {
+  if (index == 0) {
+    return static_cast<uint16_t>(_current);
+  }
+  if (index == 1) {
+    return STATE_COUNT;
+  }
+  const uint16_t offset = index - 2;
+  StateStats stats = snapshot(static_cast<State>(offset / REGS_PER_STATE),
+                              IO_SETUP::now_us());
+  const uint32_t residency_ms
+      = static_cast<uint32_t>(stats.residency_us / 1000);
+  const uint32_t meanLatency
+      = stats.latencyCount ? stats.latencySum_us / stats.latencyCount : 0;
+  switch (offset % REGS_PER_STATE) {
+    case 0:
+      return stats.entries > UINT16_MAX ? UINT16_MAX : stats.entries;
+    case 1:
+      return (residency_ms >> 16) & 0xFFFF;
+    case 2:
+      return residency_ms & 0xFFFF;
+    case 3:
+      return meanLatency > UINT16_MAX ? UINT16_MAX : meanLatency;
+    default:
+      return stats.maxLatency_us > UINT16_MAX ? UINT16_MAX
+                                              : stats.maxLatency_us;
+  }
+}
+
+// The ring is copied out first so the state machine never waits on flash
+bool StateProfiler::dumpChromeTrace(const char* path) {
+  static TraceEntry entries[TRACE_LENGTH];
+  uint32_t before;
+  uint32_t kept;
+  do {
+    before = _sequence.load(std::memory_order_acquire);
+    const uint32_t count = _traceCount;
+    kept = count;
+    if (kept > TRACE_LENGTH) {
+      kept = TRACE_LENGTH;
+    }
+    for (uint32_t i = 0; i < kept; ++i) {
+      entries[i] = _trace[(count - kept + i) % TRACE_LENGTH];
+    }
+  } while ((before & 1)
+           || before != _sequence.load(std::memory_order_acquire));
+  const int64_t now_us = IO_SETUP::now_us();
+
+  if (!LittleFS.begin(true)) {
+    return false;
+  }
+  File file = LittleFS.open(path, "w");
+  if (!file) {
+    return false;
+  }
+  file.print("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+  for (uint32_t i = 0; i < kept; ++i) {
+    const TraceEntry& entry = entries[i];
+    int64_t end_us = i + 1 < kept ? entries[i + 1].time_us : now_us;
+    file.printf("%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":1,"
+                "\"ts\":%lld,\"dur\":%lld,\"args\":{\"latency_us\":%u}}",
+                i ? "," : "",
+                stateToString(static_cast<State>(entry.state)),
+                static_cast<long long>(entry.time_us),
+                static_cast<long long>(end_us - entry.time_us),
+                static_cast<unsigned>(entry.latency_us));
+  }
+  file.print("]}");
+  file.close();
+  return true;
+}
+
+}  // namespace Node_Core
+
+#endif  // STATE_PROFILER_ENABLED
@@ -0,0 +1,82 @@
+#ifndef STATE_PROFILER_H
+#define STATE_PROFILER_H
+#include "StateDefines.h"
+#include "freertos/FreeRTOS.h"
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+// Build with -DSTATE_PROFILER_ENABLED=0 to drop the profiler, its storage
+// and its Modbus registers entirely
+#ifndef STATE_PROFILER_ENABLED
+#define STATE_PROFILER_ENABLED 1
+#endif
+
+#if STATE_PROFILER_ENABLED
+
+namespace Node_Core {
+
+// Per-state residency, entry count and event-to-transition latency, plus a
+// ring of the last transitions for a Chrome trace (chrome://tracing,
+// Perfetto). Writers are the state machine task, direct setState() callers
+// and the Modbus reset, so they serialize on a spinlock; readers go through
+// a sequence counter, so a Modbus read never sees a half-updated state.
+class StateProfiler {
+public:
+  static constexpr size_t STATE_COUNT = static_cast<size_t>(State::IDLE) + 1;
+  static constexpr size_t TRACE_LENGTH = 256;
+  static constexpr const char* TRACE_PATH = "/sm_trace.json";
+
+  struct StateStats {
+    uint32_t entries;
+    uint64_t residency_us;   // Closed visits only
+    uint64_t latencySum_us;  // Over the entries that came from an event
+    uint32_t latencyCount;
+    uint32_t maxLatency_us;
+  };
+
+  // eventTime_us is when the causing event was posted, 0 for a direct
+  // setState()
+  static void onTransition(State from, State to, int64_t eventTime_us,
+                           int64_t now_us);
+  // Consistent copy; the open visit of the current state is included
+  static StateStats snapshot(State state, int64_t now_us);
+  static State current() { return _current; }
+  static void reset(int64_t now_us);
+
+  // Complete events, one per visit, oldest first
+  static bool dumpChromeTrace(const char* path = TRACE_PATH);
+
+  // Input registers: current state and state count, then per state entries,
+  // residency ms as a hi/lo pair, mean and max latency us
+  static constexpr uint16_t REGS_PER_STATE = 5;
+  static constexpr uint16_t NUM_REGISTERS = 2 + REGS_PER_STATE * STATE_COUNT;
+  static uint16_t inputRegister(uint16_t index);
+
+private:
+  struct TraceEntry {
+    int64_t time_us;
+    uint32_t latency_us;
+    uint8_t state;
+  };
+
+  static StateStats _stats[STATE_COUNT];
+  static TraceEntry _trace[TRACE_LENGTH];
+  static uint32_t _traceCount;
+  static State _current;
+  static int64_t _enteredAt_us;
+  static std::atomic<uint32_t> _sequence;  // Odd while a writer is inside
+  static portMUX_TYPE _writeLock;
+};
+
+}  // namespace Node_Core
+
+#define STATE_PROFILE_TRANSITION(from, to, eventTime_us, now_us)               \
+  Node_Core::StateProfiler::onTransition(from, to, eventTime_us, now_us)
+#else
+#define STATE_PROFILE_TRANSITION(from, to, eventTime_us, now_us) \
+  do {                                                           \
+  } while (0)
+#endif  // STATE_PROFILER_ENABLED
+
+#endif  // STATE_PROFILER_H
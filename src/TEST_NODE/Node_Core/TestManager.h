@@ -3,15 +3,9 @@
 #include "Arduino.h"
 #include "Settings.h"
 #include "StateMachine.h"
+#include "TestRegistry.h"
 #include "UPSTesterSetup.h"
 
-static TaskHandle_t switchTestTaskHandle = NULL;
-static TaskHandle_t backupTimeTestTaskHandle = NULL;
-static TaskHandle_t efficiencyTestTaskHandle = NULL;
-static TaskHandle_t inputvoltageTestTaskHandle = NULL;
-static TaskHandle_t waveformTestTaskHandle = NULL;
-static TaskHandle_t tunepwmTestTaskHandle = NULL;
-
 using namespace Node_Core;
 
 class TestManager {
@@ -22,6 +16,19 @@ public:
   void manageTests();
   void terminateTest();
 
+  // Any registered test, looked up by TestType in the registry
+  bool startTest(TestType type) { return TestRegistry::start(type); }
+  void stopTest(TestType type) { TestRegistry::stop(type); }
+  bool isRegistered(TestType type) const {
+    return TestRegistry::isRegistered(type);
+  }
+  TaskHandle_t taskHandle(TestType type) const {
+    return TestRegistry::entry(type).taskHandle;
+  }
+  void* testData(TestType type) const {
+    return TestRegistry::entry(type).data;
+  }
+
 private:
   StateMachine _stateManager;
   State _currentstate;
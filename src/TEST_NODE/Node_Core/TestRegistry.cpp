@@ -0,0 +1,60 @@
+#include "TestRegistry.h"
+
+extern EdgeEventQueue edgeEventQueue;
+extern TaskHandle_t edgeEventTaskHandle;
+
+namespace Node_Core {
+
+constexpr TestSpec TestRegistry::SPECS[TestRegistry::COUNT];
+
+TestEntry TestRegistry::_entries[TestRegistry::COUNT] = {};
+
+std::atomic<uint8_t> TestRegistry::_edgeOwner{
+    static_cast<uint8_t>(TestRegistry::COUNT)};
+
+bool TestRegistry::start(TestType type) {
+  TestEntry& e = entry(type);
+  if (e.taskHandle == NULL) {
+    return false;
+  }
+  if (e.events != NULL) {
+    xEventGroupClearBits(e.events, TEST_ABORT_BIT);
+  }
+  xTaskNotifyGive(e.taskHandle);
+  return true;
+}
+
+void TestRegistry::stop(TestType type) {
+  TestEntry& e = entry(type);
+  if (e.events != NULL) {
+    xEventGroupSetBits(e.events, TEST_ABORT_BIT);
+  }
+}
+
+bool TestRegistry::beginEdgeTask(UBaseType_t priority, BaseType_t core) {
+  if (edgeEventTaskHandle != NULL) {
+    return true;
+  }
+  return xTaskCreatePinnedToCore(edgeEventTask, "EdgeEventTask", 4096, NULL,
+                                 priority, &edgeEventTaskHandle, core)
+         == pdPASS;
+}
+
+// Blocks on the ISR notification while the queue is empty. Edges that arrive
+// before any test claimed them are dropped here.
+void TestRegistry::edgeEventTask(void* pvParameters) {
+  EdgeEvent event;
+  while (true) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    while (edgeEventQueue.pop(event)) {
+      uint8_t owner = _edgeOwner.load(std::memory_order_acquire);
+      EdgeHandler onEdge = owner < COUNT ? _entries[owner].onEdge : nullptr;
+      if (onEdge != nullptr) {
+        onEdge(event);
+      }
+    }
+  }
+  vTaskDelete(NULL);
+}
+
+}  // namespace Node_Core
@@ -0,0 +1,96 @@
+#ifndef TEST_REGISTRY_H
+#define TEST_REGISTRY_H
+#include "EdgeEventQueue.h"
+#include "Settings.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "freertos/task.h"
+#include <atomic>
+#include <stddef.h>
+
+enum class TestType {
+  SwitchTest,
+  BackupTimeTest,
+  EfficiencyTest,
+  InputVoltageTest,
+  WaveformTest,
+  TunePWMTest,
+  TransientTest,
+  COUNT
+};
+
+namespace Node_Core {
+
+// Abort request shared by every test's event group
+static constexpr EventBits_t TEST_ABORT_BIT = BIT1;
+
+// Hands one edge to a test, see UPSTest::dispatchEdge()
+typedef void (*EdgeHandler)(const EdgeEvent& event);
+
+// Main task of one test type, fixed at build time
+struct TestSpec {
+  const char* name;
+  uint32_t stack;
+  UBaseType_t priority;
+  BaseType_t core;
+};
+
+// Runtime state of one test type, filled by UPSTest::init()
+struct TestEntry {
+  TaskHandle_t taskHandle;
+  EventGroupHandle_t events;
+  void* data;
+  EdgeHandler onEdge;
+};
+
+// One slot per TestType, indexed directly by the enum value
+class TestRegistry {
+public:
+  static constexpr size_t COUNT = static_cast<size_t>(TestType::COUNT);
+
+  // Same order as TestType. All below the state machine and the edge
+  // consumer (priority 3); the timing tests sit above the calibration and
+  // the PZEM sweeps. Recheck TASK_STACK_HWM after resizing a stack.
+  static constexpr TestSpec SPECS[COUNT] = {
+      {"SwitchTest", 12000, 2, 0},      {"BackupTimeTest", 10240, 2, 0},
+      {"EfficiencyTest", 8192, 1, 0},   {"InputVoltageTest", 8192, 1, 0},
+      {"WaveformTest", 10240, 2, 0},    {"TunePWMTest", 8192, 1, 0},
+      {"TransientTest", 8192, 2, 0},
+  };
+
+  static constexpr size_t index(TestType type) {
+    return static_cast<size_t>(type);
+  }
+  static constexpr const TestSpec& spec(TestType type) {
+    return SPECS[index(type)];
+  }
+  static constexpr const char* name(TestType type) { return spec(type).name; }
+  static TestEntry& entry(TestType type) { return _entries[index(type)]; }
+
+  // Main test tasks block on a notification between runs. stop() sets
+  // TEST_ABORT_BIT, which stays set through the whole run; only start()
+  // clears it, so tests never clear it themselves.
+  static bool start(TestType type);
+  static void stop(TestType type);
+  static bool isRegistered(TestType type) {
+    return _entries[index(type)].taskHandle != NULL;
+  }
+
+  // One consumer task drains edgeEventQueue for every test and hands each
+  // edge to the test that claimed the edges last. Created by the first call.
+  static bool beginEdgeTask(UBaseType_t priority, BaseType_t core);
+  static void claimEdges(TestType type) {
+    _edgeOwner.store(static_cast<uint8_t>(index(type)),
+                     std::memory_order_release);
+  }
+
+private:
+  static void edgeEventTask(void* pvParameters);
+
+  static TestEntry _entries[COUNT];
+  static std::atomic<uint8_t> _edgeOwner;  // COUNT until a test claims
+};
+
+}  // namespace Node_Core
+
+#endif  // TEST_REGISTRY_H
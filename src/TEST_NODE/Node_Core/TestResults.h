@@ -0,0 +1,46 @@
+#ifndef TEST_RESULTS_H
+#define TEST_RESULTS_H
+#include <stdint.h>
+
+enum LoadPercentage {
+  LOAD_0P = 0,
+  LOAD_25P = 25,
+  LOAD_50P = 50,
+  LOAD_75P = 75,
+  LOAD_100P = 100
+};
+
+namespace Node_Core {
+
+// Per-level results the tests keep and Checkpoint carries across a reset.
+// They live here rather than in the test headers so Checkpoint does not
+// depend on the test engines.
+
+// Edge times are esp_timer microseconds truncated to 32 bits; the switch
+// time is taken from the full 64-bit difference before truncation.
+struct SwitchResult {
+  uint8_t testNo;
+  unsigned long testTimestamp;
+  unsigned long switchtime_us;
+  unsigned long starttime_us;
+  unsigned long endtime_us;
+  LoadPercentage load_percentage : 7;  // Adjusted to cover all possible
+  bool valid_data : 1;
+};
+
+// Backup times run to hours, so they are kept in milliseconds; the edge
+// times are esp_timer microseconds truncated to 32 bits.
+struct BackupResult {
+  uint8_t testNo;
+  unsigned long testTimestamp;
+  unsigned long backuptime_ms;
+  unsigned long starttime_us;
+  unsigned long endtime_us;
+  uint32_t samples;  // Records streamed to BackupLog::PATH
+  LoadPercentage load_percentage : 7;  // Adjusted to cover all possible
+  bool valid_data : 1;
+};
+
+}  // namespace Node_Core
+
+#endif  // TEST_RESULTS_H
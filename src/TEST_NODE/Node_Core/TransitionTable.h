@@ -0,0 +1,62 @@
+#ifndef TRANSITION_TABLE_H
+#define TRANSITION_TABLE_H
+#include <stddef.h>
+#include <stdint.h>
+
+namespace Node_Core {
+
+// Binary transition table, compiled from JSON or CSV by
+// tools/transition_compiler.py. Layout, little endian:
+//   TransitionTableHeader
+//   TransitionRecord rows[rowCount]
+//   uint8_t index[stateCount * eventCount]  First row for (state, event)
+//   uint8_t fallback[rowCount]              Next row when a guard fails
+// Index and fallback hold NO_ROW where nothing applies, so the firmware
+// dispatches straight from the file image. crc is CRC-32 (zlib) over
+// everything after the header.
+struct TransitionTableHeader {
+  static constexpr uint32_t MAGIC = 0x42545453;  // "STTB"
+  static constexpr uint16_t VERSION = 1;
+  uint32_t magic;
+  uint16_t version;
+  uint8_t stateCount;  // Must match the firmware's State and Event enums
+  uint8_t eventCount;
+  uint16_t rowCount;
+  uint16_t reserved;
+  uint32_t crc;
+};
+static_assert(sizeof(TransitionTableHeader) == 16,
+              "transition table header is 16 bytes on flash");
+
+struct TransitionRecord {
+  static constexpr uint8_t ANY_STATE = 0xFF;
+  static constexpr uint8_t NO_ROW = 0xFF;
+  uint8_t state;  // ANY_STATE matches every state
+  uint8_t event;
+  uint8_t next;
+  uint8_t action;  // TableAction
+  uint8_t guard;   // TableGuard
+};
+static_assert(sizeof(TransitionRecord) == 5,
+              "transition records are 5 bytes on flash");
+
+// Guard and action ids in TransitionRecord. The names are the ones the
+// compiler accepts; append only, since the values are stored in tables.
+enum class TableGuard : uint8_t {
+  NONE = 0,
+  NOT_CONNECTED,
+  CAN_RETRY_CONNECT,
+  CAN_RETEST,
+  COUNT
+};
+
+enum class TableAction : uint8_t {
+  NONE = 0,
+  COUNT_RETRY,
+  RESET_RETRIES,
+  COUNT
+};
+
+}  // namespace Node_Core
+
+#endif  // TRANSITION_TABLE_H
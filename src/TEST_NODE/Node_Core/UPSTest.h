@@ -2,53 +2,31 @@
 #define UPS_TEST_H
 
 #include "Arduino.h"
+#include "EdgeEventQueue.h"
 #include "HardwareConfig.h"
+#include "HardwareSetup.h"
+#include "LoadBanks.h"
+#include "LoadTable.h"
 #include "TestManager.h"
+#include "TestRegistry.h"
+#include "TestResults.h"
 #include "UPSTesterSetup.h"
+#include "driver/gpio.h"
+#include "freertos/event_groups.h"
 
 extern void IRAM_ATTR keyISR1(void* pvParameters);
 extern void IRAM_ATTR keyISR2(void* pvParameters);
-extern volatile bool mains_triggered;
-extern volatile bool ups_triggered;
 extern UPSTesterSetup* TesterSetup;
 using namespace Node_Core;
 
 enum TestResult { TEST_FAILED = 0, TEST_SUCESSFUL = 1 };
-enum LoadPercentage {
-  LOAD_0P = 0,
-  LOAD_25P = 25,
-  LOAD_50P = 50,
-  LOAD_75P = 75,
-  LOAD_100P = 100
-};
-
-enum class TestType {
-  SwitchTest,
-  BackupTimeTest,
-  EfficiencyTest,
-  InputVoltageTest,
-  WaveformTest,
-  TunePWMTest,
-};
-static const char* testTypeToString(TestType type) {
-  switch (type) {
-    case TestType::SwitchTest:
-      return "SwitchTest";
-    case TestType::BackupTimeTest:
-      return "BackupTimeTest";
-    case TestType::EfficiencyTest:
-      return "EfficiencyTest";
-    case TestType::InputVoltageTest:
-      return "InputVoltageTest";
-    case TestType::WaveformTest:
-      return "WaveformTest";
-    case TestType::TunePWMTest:
-      return "TunePWMTest";
-    default:
-      return "UnknownTest";
-  }
-}
 
+// Shared base for the test engines. T is the concrete test (CRTP), U its
+// data struct. Calls into T are resolved at compile time; T provides:
+//   void resetData();                          clear U before the first run
+//   void onEdgeEvent(const EdgeEvent& event);  edge consumer, task context
+//   static void MainTestTask(void* pvParameters);  receives SetupTaskParams*
+// and declares `friend class UPSTest<...>` so the base can construct it.
 template <typename T, typename U, TestType testype>
 class UPSTest {
 public:
@@ -67,7 +45,21 @@ public:
     }
   }
 
-  virtual void init() = 0;
+  void init() {
+    if (_initialized) {
+      return;
+    }
+    _testEvents = xEventGroupCreate();
+    TestEntry& entry = TestRegistry::entry(testype);
+    entry.events = _testEvents;
+    entry.data = &_data;
+    entry.onEdge = &UPSTest::dispatchEdge;
+    derived().resetData();
+    createEdgeEventTask();
+    setupPins();
+    createTask();
+    _initialized = true;
+  }
 
   U& data() { return _data; }
   void updateSettings() {
@@ -78,51 +70,173 @@ public:
       _cfgTaskParam = TesterSetup->paramSetup();
       _cfgHardware = TesterSetup->hardwareSetup();
     };
+    LoadTable::ensure(_cfgHardware);
   }
-  static void (*taskFunctionPointerToFunction(void (T::*taskFunction)(void*)))(
-      void*) {
-    // The return type is a function pointer: void(*)(void*)
-    return [taskFunction](void* param) {
-      T* obj = static_cast<T*>(param);
-      (obj->*taskFunction)(param);
-    };
+
+  TaskHandle_t createTask() {
+    constexpr const TestSpec& spec = TestRegistry::spec(testype);
+    TestEntry& entry = TestRegistry::entry(testype);
+    if (entry.taskHandle == NULL) {
+      xTaskCreatePinnedToCore(T::MainTestTask, spec.name, spec.stack,
+                              &_cfgTaskParam, spec.priority, &entry.taskHandle,
+                              spec.core);
+    }
+    return entry.taskHandle;
   }
-  virtual TestResult run(uint16_t testVARating = 4000,
-                         unsigned long testDuration = 10000)
-      = 0;
-  TaskHandle_t createTask();
-  void startTest();
-  void stopTest();
+  TaskHandle_t taskHandle() const {
+    return TestRegistry::entry(testype).taskHandle;
+  }
+
+  void startTest() { TestRegistry::start(testype); }
+  void stopTest() { TestRegistry::stop(testype); }
+  void abort() { TestRegistry::stop(testype); }
 
 protected:
-  UPSTest();
-  virtual ~UPSTest() = default;
-
-  void setupPins();
-  void configureInterrupts();
-  void setTestDuration(unsigned long duration);
-  void setLoad(uint16_t testVARating);
-  void selectLoadBank(uint16_t bankNumbers);
-  void simulatePowerCut();
-  void simulatePowerRestore();
-  void sendEndSignal();
-  void processTest(T& test);
-
-  TaskHandle_t createTask(void (T::*taskFunction)(void*), const char* taskName);
-  virtual void createISRTasks() = 0;
-
-  virtual void MainTestTask(void* pvParameters) = 0;
-  virtual void onMainsPowerISRTask(void* pvParameters) = 0;
-  virtual void onUPSPowerISRTask(void* pvParameters) = 0;
-
-  virtual void startTestCapture() = 0;
-  virtual void stopTestCapture() = 0;
-  virtual void checkRange() = 0;
-  virtual void processTestImpl(T& test) = 0;
+  static constexpr EventBits_t CAPTURE_DONE_BIT = BIT0;
+  static constexpr EventBits_t ABORT_BIT = TEST_ABORT_BIT;
+  static constexpr EventBits_t MAINS_RESTORED_BIT = BIT2;
+
+  UPSTest()
+      : _data(),
+        _initialized(false),
+        _testRunning(false),
+        _dataCaptureRunning(false),
+        _dataCaptureOk(false),
+        _currentTest(0),
+        _testDuration(0),
+        _testEvents(NULL) {
+    updateSettings();
+    _testDuration = _cfgTest.testDuration_ms;
+  }
+
+  ~UPSTest() {
+    TestEntry& entry = TestRegistry::entry(testype);
+    if (entry.taskHandle != NULL) {
+      vTaskDelete(entry.taskHandle);
+      entry.taskHandle = NULL;
+    }
+    entry.events = NULL;
+    entry.data = nullptr;
+    entry.onEdge = nullptr;
+    if (_testEvents != NULL) {
+      vEventGroupDelete(_testEvents);
+      _testEvents = NULL;
+    }
+  }
+
+  T& derived() { return static_cast<T&>(*this); }
+
+  void setupPins() {
+    pinMode(SENSE_MAINS_POWER_PIN, INPUT_PULLDOWN);
+    pinMode(SENSE_UPS_POWER_PIN, INPUT_PULLDOWN);
+    pinMode(UPS_POWER_CUT_PIN, OUTPUT);  // Set power cut pin as output
+    pinMode(TEST_END_INT_PIN, OUTPUT);
+    pinMode(LOAD_PWM_PIN, OUTPUT);
+    pinMode(LOAD25P_ON_PIN, OUTPUT);
+    pinMode(LOAD50P_ON_PIN, OUTPUT);
+    pinMode(LOAD75P_ON_PIN, OUTPUT);
+    pinMode(LOAD_FULL_ON_PIN, OUTPUT);
+
+    ledcSetup(_cfgHardware.pwmchannelNo, _cfgHardware.pwm_frequency,
+              LoadTable::resolutionBits(_cfgHardware));
+    ledcWrite(_cfgHardware.pwmchannelNo, 0);
+    ledcAttachPin(LOAD_PWM_PIN, _cfgHardware.pwmchannelNo);
+    configureInterrupts();
+
+    pinMode(SENSE_MAINS_POWER_PIN, INPUT_PULLDOWN);
+    pinMode(SENSE_UPS_POWER_PIN, INPUT_PULLDOWN);
+  }
+
+  // Both sense inputs interrupt on either edge; keyISR1/keyISR2 timestamp
+  // the edge and each test filters the ones it cares about in onEdgeEvent()
+  void configureInterrupts() {
+    gpio_num_t mainpowerPin = static_cast<gpio_num_t>(SENSE_MAINS_POWER_PIN);
+    gpio_num_t upspowerPin = static_cast<gpio_num_t>(SENSE_UPS_POWER_PIN);
+    gpio_set_intr_type(mainpowerPin, GPIO_INTR_ANYEDGE);
+    gpio_set_intr_type(upspowerPin, GPIO_INTR_ANYEDGE);
+
+    gpio_install_isr_service(0);  // Already installed is not an error here
+    gpio_isr_handler_add(mainpowerPin, keyISR1, NULL);
+    gpio_isr_handler_add(upspowerPin, keyISR2, NULL);
+  }
+
+  // The shared consumer runs above the main test tasks so edges are
+  // consumed as soon as they arrive
+  void createEdgeEventTask() {
+    TestRegistry::beginEdgeTask(_cfgTask.mainTest_taskIdlePriority + 1,
+                                _cfgTask.mainsISR_taskCore);
+    claimEdgeEvents();
+  }
+  // Routes the edges to this test until another one claims them
+  void claimEdgeEvents() { TestRegistry::claimEdges(testype); }
+
+  // Called by the shared edge consumer, task context
+  static void dispatchEdge(const EdgeEvent& event) {
+    if (instance) {
+      instance->trackMains(event);
+      instance->derived().onEdgeEvent(event);
+    }
+  }
+
+  // Waits for the mains sense input to come back after a restore so the next
+  // attempt starts from a settled UPS
+  bool waitMainsRestored(TickType_t timeout) {
+    if (NodeTask::IO_SETUP::readPin(SENSE_MAINS_POWER_PIN) == HIGH) {
+      return true;
+    }
+    EventBits_t bits = xEventGroupWaitBits(
+        _testEvents, MAINS_RESTORED_BIT | ABORT_BIT, pdFALSE, pdFALSE, timeout);
+    return (bits & MAINS_RESTORED_BIT) != 0;
+  }
+  bool abortRequested() const {
+    return (xEventGroupGetBits(_testEvents) & ABORT_BIT) != 0;
+  }
+
+  void setTestDuration(unsigned long duration) { _testDuration = duration; }
+
+  // Selects the smallest bank combination that covers testVARating and trims
+  // it with the PWM channel, both read from the shared LoadTable (calibrated
+  // when TunePWMTest has run). Returns the duty of the active banks.
+  LoadPercentage setLoad(uint16_t testVARating) {
+    LoadTable::ensure(_cfgHardware);
+    uint8_t reqbankNumbers = 0;
+    uint16_t pwmValue = 0;
+    LoadTable::lookup(testVARating, reqbankNumbers, pwmValue);
+
+    uint32_t bankVA = (maxVARating / 4) * static_cast<uint32_t>(reqbankNumbers);
+    uint16_t duty = bankVA ? (testVARating * 100UL) / bankVA : 0;
+    _cfgHardware.pwmduty_set = pwmValue;
+    writeLoadPwm(pwmValue);
+
+    selectLoadBank(reqbankNumbers);
+    return static_cast<LoadPercentage>(duty);
+  }
+
+  // Duty at LoadTable::resolutionBits(), up to 14 bits
+  void writeLoadPwm(uint16_t pwmValue) {
+    uint16_t full = LoadTable::maxDuty();
+    ledcWrite(_cfgHardware.pwmchannelNo, pwmValue > full ? full : pwmValue);
+  }
+
+  // One masked write, or the bankDelay_* soft-start profile when set
+  void selectLoadBank(uint16_t bankNumbers) {
+    LoadBanks::apply(bankNumbers, _cfgHardware);
+  }
+
+  void sendEndSignal() {
+    NodeTask::IO_SETUP::writePin(TEST_END_INT_PIN, HIGH);
+    vTaskDelay(pdMS_TO_TICKS(10));
+    NodeTask::IO_SETUP::writePin(TEST_END_INT_PIN, LOW);
+  }
+
+  void simulatePowerCut() {
+    NodeTask::IO_SETUP::writePin(UPS_POWER_CUT_PIN, HIGH);  // Simulate cut
+  }
+
+  void simulatePowerRestore() {
+    NodeTask::IO_SETUP::writePin(UPS_POWER_CUT_PIN, LOW);  // Mains Power In
+  }
 
-private:
-  friend class TestManager;
-  TaskHandle_t getTaskhandle();
   static T* instance;
   U _data;
   SetupSpec _cfgSpec;
@@ -137,6 +251,23 @@ private:
   bool _dataCaptureOk;
   uint8_t _currentTest;
   unsigned long _testDuration;
+  EventGroupHandle_t _testEvents;
+
+private:
+  friend class TestManager;
+
+  // Mains state is common to every test: a rising mains edge releases
+  // waitMainsRestored(), a falling one re-arms it
+  void trackMains(const EdgeEvent& event) {
+    if (event.pin != SENSE_MAINS_POWER_PIN) {
+      return;
+    }
+    if (event.edge == EdgeType::RISING_EDGE) {
+      xEventGroupSetBits(_testEvents, MAINS_RESTORED_BIT);
+    } else {
+      xEventGroupClearBits(_testEvents, MAINS_RESTORED_BIT);
+    }
+  }
 
   // Prevent copying
   UPSTest(const UPSTest&) = delete;
@@ -173,6 +173,10 @@ void UPSTesterSetup::serializeSettings(const char* filename) {
   doc["hardware"]["adjust_pwm_50P"] = _hardwareSetting.adjust_pwm_50P;
   doc["hardware"]["adjust_pwm_75P"] = _hardwareSetting.adjust_pwm_75P;
   doc["hardware"]["adjust_pwm_100P"] = _hardwareSetting.adjust_pwm_100P;
+  doc["hardware"]["bankDelay_25P_us"] = _hardwareSetting.bankDelay_25P_us;
+  doc["hardware"]["bankDelay_50P_us"] = _hardwareSetting.bankDelay_50P_us;
+  doc["hardware"]["bankDelay_75P_us"] = _hardwareSetting.bankDelay_75P_us;
+  doc["hardware"]["bankDelay_100P_us"] = _hardwareSetting.bankDelay_100P_us;
   doc["hardware"]["lastsetting_updated"] = _hardwareSetting.lastsetting_updated;
 
   doc["network"]["AP_SSID"] = _networkSetting.AP_SSID;
@@ -323,6 +327,14 @@ void UPSTesterSetup::deserializeSettings(const char* filename) {
       = doc["hardware"]["adjust_pwm_75P"] | _hardwareSetting.adjust_pwm_75P;
   _hardwareSetting.adjust_pwm_100P
       = doc["hardware"]["adjust_pwm_100P"] | _hardwareSetting.adjust_pwm_100P;
+  _hardwareSetting.bankDelay_25P_us = doc["hardware"]["bankDelay_25P_us"]
+                                      | _hardwareSetting.bankDelay_25P_us;
+  _hardwareSetting.bankDelay_50P_us = doc["hardware"]["bankDelay_50P_us"]
+                                      | _hardwareSetting.bankDelay_50P_us;
+  _hardwareSetting.bankDelay_75P_us = doc["hardware"]["bankDelay_75P_us"]
+                                      | _hardwareSetting.bankDelay_75P_us;
+  _hardwareSetting.bankDelay_100P_us = doc["hardware"]["bankDelay_100P_us"]
+                                       | _hardwareSetting.bankDelay_100P_us;
   _hardwareSetting.lastsetting_updated = doc["hardware"]["lastsetting_updated"]
                                          | _hardwareSetting.lastsetting_updated;
 
@@ -474,12 +486,16 @@ void UPSTesterSetup::registerReportCallback(OnSetupReportCallback callback) {
 //   // SetupHardware factory settings
 //   SetupHardware factoryHardware = {
 //       0,       // pwmchannelNo (uint8_t)
-//       8,       // pwmResolusion_bits (uint8_t)
+//       14,      // pwmResolusion_bits (uint8_t)
 //       0,       // pwmduty_set (uint16_t)
 //       25,      // adjust_pwm_25P (uint16_t)
 //       50,      // adjust_pwm_50P (uint16_t)
 //       75,      // adjust_pwm_75P (uint16_t)
 //       100,     // adjust_pwm_100P (uint16_t)
+//       0,       // bankDelay_25P_us (uint16_t)
+//       0,       // bankDelay_50P_us (uint16_t)
+//       0,       // bankDelay_75P_us (uint16_t)
+//       0,       // bankDelay_100P_us (uint16_t)
 //       3000UL,  // pwm_frequecy (uint32_t)
 //       0UL      // lastsetting_updated (unsigned long)
 //   };
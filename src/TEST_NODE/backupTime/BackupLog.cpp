@@ -0,0 +1,70 @@
+#include "BackupLog.h"
+#include <LittleFS.h>
+#include <string.h>
+
+bool BackupLog::open(uint32_t sampleInterval_ms, uint32_t loadVA,
+                     size_t maxBytes) {
+  close();
+  if (!LittleFS.begin(true)) {
+    return false;
+  }
+  _file = LittleFS.open(PATH, "w");
+  if (!_file) {
+    return false;
+  }
+
+  BackupLogHeader header;
+  header.magic = BackupLogHeader::MAGIC;
+  header.version = 1;
+  header.blockSize = BackupLogBlock::SIZE;
+  header.sampleInterval_ms = sampleInterval_ms;
+  header.loadVA = loadVA;
+  _written = _file.write(reinterpret_cast<const uint8_t*>(&header),
+                         sizeof(header));
+
+  memset(&_block, 0, sizeof(_block));
+  _block.magic = BackupLogBlock::MAGIC;
+  _sequence = 0;
+  _samples = 0;
+  _dropped = 0;
+  _maxBytes = maxBytes;
+  _open = _written == sizeof(header);
+  return _open;
+}
+
+void BackupLog::append(const BackupSample& sample) {
+  if (!_open || _written + BackupLogBlock::SIZE > _maxBytes) {
+    _dropped++;
+    return;
+  }
+  _block.samples[_block.count++] = sample;
+  _samples++;
+  if (_block.count == BackupLogBlock::CAPACITY) {
+    flushBlock();
+  }
+}
+
+// Writes the whole block and flushes, so a reset loses at most one block
+void BackupLog::flushBlock() {
+  _block.sequence = _sequence++;
+  size_t n = _file.write(reinterpret_cast<const uint8_t*>(&_block),
+                         sizeof(_block));
+  _file.flush();
+  if (n != sizeof(_block)) {
+    _dropped += _block.count;
+    _open = false;  // Stop on a write error, keep what is on flash
+  }
+  _written += n;
+  memset(_block.samples, 0, sizeof(_block.samples));
+  _block.count = 0;
+}
+
+void BackupLog::close() {
+  if (_open && _block.count > 0) {
+    flushBlock();
+  }
+  if (_file) {
+    _file.close();
+  }
+  _open = false;
+}
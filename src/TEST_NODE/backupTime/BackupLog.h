@@ -0,0 +1,70 @@
+#ifndef BACKUP_LOG_H
+#define BACKUP_LOG_H
+#include <FS.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Streams backup-time samples to LittleFS in fixed 512-byte blocks. Only
+// one block is held in RAM, so memory use does not grow with the run
+// length. File layout: BackupLogHeader, then BackupLogBlock records; the
+// last block may be partly filled (see count).
+
+struct BackupSample {
+  uint32_t time_ms;           // Since the power cut command
+  uint32_t outputPower_dW;    // PZEM units, 0.1 W
+  uint16_t outputVoltage_dV;  // PZEM units, 0.1 V
+  uint16_t battery_mV;
+};
+
+struct BackupLogHeader {
+  static constexpr uint32_t MAGIC = 0x50554B42;  // "BKUP"
+  uint32_t magic;
+  uint16_t version;
+  uint16_t blockSize;
+  uint32_t sampleInterval_ms;
+  uint32_t loadVA;
+};
+
+struct BackupLogBlock {
+  static constexpr size_t SIZE = 512;
+  static constexpr uint16_t MAGIC = 0xB10C;
+  static constexpr uint16_t CAPACITY
+      = (SIZE - 4 * sizeof(uint16_t)) / sizeof(BackupSample);
+
+  uint16_t magic;
+  uint16_t sequence;
+  uint16_t count;
+  uint16_t reserved;
+  BackupSample samples[CAPACITY];
+};
+static_assert(sizeof(BackupLogBlock) == BackupLogBlock::SIZE,
+              "backup log block must stay 512 bytes");
+
+class BackupLog {
+public:
+  static constexpr const char* PATH = "/backup.bin";
+
+  bool open(uint32_t sampleInterval_ms, uint32_t loadVA,
+            size_t maxBytes = 512 * 1024);
+  void append(const BackupSample& sample);
+  void close();
+
+  bool isOpen() const { return _open; }
+  uint32_t samples() const { return _samples; }
+  uint16_t blocks() const { return _sequence; }
+  uint32_t dropped() const { return _dropped; }
+
+private:
+  File _file;
+  BackupLogBlock _block;
+  bool _open = false;
+  uint16_t _sequence = 0;
+  uint32_t _samples = 0;
+  uint32_t _dropped = 0;  // Samples lost to a full file or write error
+  size_t _maxBytes = 0;
+  size_t _written = 0;
+
+  void flushBlock();
+};
+
+#endif  // BACKUP_LOG_H
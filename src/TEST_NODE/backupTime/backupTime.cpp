@@ -0,0 +1,250 @@
+#include "backupTime.h"
+#include "Checkpoint.h"
+#include "NodeLog.h"
+#include "PowerMeters.h"
+
+using namespace Node_Core;
+using NodeTask::IO_SETUP;
+
+// Private Constructor
+BackupTimeTest::BackupTimeTest()
+    : _config(),
+      _captureStart_us(0),
+      _captureEnd_us(0),
+      _lastMainsEdge_us(0),
+      _upsFall_us(0),
+      _cutTime_us(0),
+      _fallLock(portMUX_INITIALIZER_UNLOCKED) {
+  _testDuration = _cfgTest.maxBackupTime_ms;
+}
+
+void BackupTimeTest::resetData() {
+  for (auto& test : _data.backupTest) {
+    test.testNo = 0;
+    test.testTimestamp = 0;
+    test.valid_data = false;
+    test.backuptime_ms = 0;
+    test.starttime_us = 0;
+    test.endtime_us = 0;
+    test.samples = 0;
+    test.load_percentage = LoadPercentage::LOAD_0P;
+  }
+  // Runs finished before a reset, see Checkpoint
+  Checkpoint::restoreBackupResults(_data.backupTest);
+}
+
+// Main BackupTimeTest task, runs one test per startTest()
+void BackupTimeTest::MainTestTask(void* pvParameters) {
+  if (instance) {
+    while (true) {
+      ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+      SetupTaskParams* params = (SetupTaskParams*)pvParameters;
+      NODE_LOGI(BACKUP_START, params->task_TestVARating);
+      instance->run(params->task_TestVARating,
+                    instance->_cfgTest.maxBackupTime_ms);
+      NODE_LOGD(TASK_STACK_HWM, uxTaskGetStackHighWaterMark(NULL));
+    }
+  }
+  vTaskDelete(NULL);
+}
+
+// Backup starts on the mains falling edge and ends at the UPS output fall
+// that waitShutdown() confirms; both ends use the ISR timestamps. A rise
+// cancels the pending fall, so the transfer gap never ends the run.
+void BackupTimeTest::onEdgeEvent(const EdgeEvent& event) {
+  const int64_t debounce_us = _config.debounceDelay_us;
+  if (event.pin == SENSE_UPS_POWER_PIN) {
+    if (!_dataCaptureRunning) {
+      return;
+    }
+    const bool fell = event.edge == EdgeType::FALLING_EDGE;
+    portENTER_CRITICAL(&_fallLock);
+    _upsFall_us = fell ? event.timestamp_us : 0;
+    portEXIT_CRITICAL(&_fallLock);
+    if (fell) {
+      xEventGroupSetBits(_testEvents, UPS_LOW_BIT);
+    } else {
+      xEventGroupClearBits(_testEvents, UPS_LOW_BIT);
+    }
+    return;
+  }
+  if (event.edge != EdgeType::FALLING_EDGE) {
+    return;
+  }
+  if (event.pin == SENSE_MAINS_POWER_PIN) {
+    if (event.timestamp_us - _lastMainsEdge_us <= debounce_us) {
+      return;
+    }
+    _lastMainsEdge_us = event.timestamp_us;
+    if (!_dataCaptureRunning) {
+      _dataCaptureRunning = true;
+      _dataCaptureOk = false;
+      _captureStart_us = event.timestamp_us;
+      _data.backupTest[_currentTest].starttime_us
+          = static_cast<unsigned long>(event.timestamp_us);
+      NODE_LOGD(BACKUP_MAINS_LOSS, static_cast<uint32_t>(event.timestamp_us));
+    }
+  }
+}
+
+// Waits up to timeout for a confirmed UPS shutdown (CAPTURE_DONE_BIT) or an
+// abort (ABORT_BIT), 0 when neither came. A pending fall is confirmed once
+// shutdownConfirm_ms have passed and the output still reads low.
+EventBits_t BackupTimeTest::waitShutdown(TickType_t timeout) {
+  const TickType_t start = xTaskGetTickCount();
+  const int64_t confirm_us = _config.shutdownConfirm_ms * 1000LL;
+  while (true) {
+    const TickType_t elapsed = xTaskGetTickCount() - start;
+    TickType_t wait = elapsed < timeout ? timeout - elapsed : 0;
+    EventBits_t waitFor = ABORT_BIT | UPS_LOW_BIT;
+    if (xEventGroupGetBits(_testEvents) & UPS_LOW_BIT) {
+      portENTER_CRITICAL(&_fallLock);
+      const int64_t fall_us = _upsFall_us;
+      portEXIT_CRITICAL(&_fallLock);
+      const int64_t low_us = IO_SETUP::now_us() - fall_us;
+      if (IO_SETUP::readPin(SENSE_UPS_POWER_PIN) == HIGH) {
+        // Back before the edge task saw the rise
+        xEventGroupClearBits(_testEvents, UPS_LOW_BIT);
+        continue;
+      }
+      if (low_us >= confirm_us) {
+        _captureEnd_us = fall_us;
+        _data.backupTest[_currentTest].endtime_us
+            = static_cast<unsigned long>(fall_us);
+        NODE_LOGD(BACKUP_UPS_SHUTDOWN, static_cast<uint32_t>(fall_us));
+        _dataCaptureRunning = false;
+        _dataCaptureOk = true;
+        return CAPTURE_DONE_BIT;
+      }
+      TickType_t left = pdMS_TO_TICKS((confirm_us - low_us) / 1000) + 1;
+      wait = left < wait ? left : wait;
+      waitFor = ABORT_BIT;
+    }
+    if (wait == 0) {
+      return xEventGroupGetBits(_testEvents) & ABORT_BIT;
+    }
+    EventBits_t bits = xEventGroupWaitBits(_testEvents, waitFor, pdFALSE,
+                                           pdFALSE, wait);
+    if (bits & ABORT_BIT) {
+      return ABORT_BIT;
+    }
+  }
+}
+
+bool BackupTimeTest::process_time_capture() {
+  if (_captureStart_us <= 0 || _captureEnd_us <= _captureStart_us) {
+    return false;
+  }
+  unsigned long backupTime_ms
+      = static_cast<unsigned long>((_captureEnd_us - _captureStart_us) / 1000);
+  if (backupTime_ms < _config.min_valid_backup_time_ms) {
+    return false;
+  }
+  BackupTimeTestData::TestData& test = _data.backupTest[_currentTest];
+  test.valid_data = true;
+  test.testNo = _currentTest + 1;
+  test.testTimestamp = static_cast<unsigned long>(IO_SETUP::now_us() / 1000);
+  test.backuptime_ms = backupTime_ms;
+  return true;
+}
+
+// One record per interval; the PZEM read dominates (tens of ms) and runs in
+// the test task, never in the edge path
+void BackupTimeTest::takeSample() {
+  BackupSample sample = {};
+  sample.time_ms
+      = static_cast<uint32_t>((IO_SETUP::now_us() - _cutTime_us) / 1000);
+  powerMeasure output;
+  if (PowerMeters::readOutput(output)) {
+    sample.outputPower_dW = output.power;
+    sample.outputVoltage_dV = output.voltage;
+  }
+  uint32_t battery_mV = 0;
+  if (PowerMeters::readBattery_mV(_config.batteryDivider_x1000, battery_mV)) {
+    sample.battery_mV = battery_mV > UINT16_MAX ? UINT16_MAX : battery_mV;
+  }
+  _log.append(sample);
+}
+
+// Cuts mains and samples until the UPS output falls, the run is aborted or
+// testduration expires. The backup time itself comes from the edge
+// timestamps, not from the sampling clock.
+TestResult BackupTimeTest::run(uint16_t testVARating,
+                               unsigned long testduration) {
+  _testDuration = testduration;
+  _data.backupTest[_currentTest].load_percentage = setLoad(testVARating);
+  claimEdgeEvents();
+  xEventGroupClearBits(_testEvents, UPS_LOW_BIT);
+
+  _captureStart_us = 0;
+  _captureEnd_us = 0;
+  _dataCaptureRunning = false;
+  _dataCaptureOk = false;
+  _data.backupTest[_currentTest].valid_data = false;
+  _data.backupTest[_currentTest].samples = 0;
+  if (_config.logToFlash) {
+    PowerMeters::init();
+    _log.open(_config.sampleInterval_ms, testVARating);
+  }
+
+  const TickType_t interval = pdMS_TO_TICKS(_config.sampleInterval_ms);
+  TickType_t nextSample = xTaskGetTickCount();
+  const TickType_t deadline = nextSample + pdMS_TO_TICKS(_testDuration);
+  EventBits_t bits = 0;
+  _cutTime_us = IO_SETUP::now_us();
+  simulatePowerCut();
+
+  while (true) {
+    if (_log.isOpen()) {
+      takeSample();
+    }
+    // RTC only between the coalesced NVS commits, so this is cheap
+    Checkpoint::saveBackupProgress(
+        _currentTest + 1,
+        static_cast<uint32_t>((IO_SETUP::now_us() - _cutTime_us) / 1000),
+        _log.samples());
+    nextSample += interval;
+    TickType_t now = xTaskGetTickCount();
+    int32_t toDeadline = static_cast<int32_t>(deadline - now);
+    if (toDeadline <= 0) {
+      break;
+    }
+    // Fixed sampling grid, a slow meter read shortens the next wait
+    int32_t toSample = static_cast<int32_t>(nextSample - now);
+    int32_t wait = toSample < toDeadline ? toSample : toDeadline;
+    bits = waitShutdown(wait > 0 ? wait : 0);
+    if (bits & (CAPTURE_DONE_BIT | ABORT_BIT)) {
+      break;
+    }
+  }
+  // ABORT_BIT is left for TestRegistry::start() to clear
+  simulatePowerRestore();
+  _dataCaptureRunning = false;
+  xEventGroupClearBits(_testEvents, UPS_LOW_BIT);
+  Checkpoint::saveBackupProgress(0, 0, 0);
+
+  if (_log.isOpen()) {
+    if (bits & CAPTURE_DONE_BIT) {
+      takeSample();  // Last record at shutdown
+    }
+    _log.close();
+    _data.backupTest[_currentTest].samples = _log.samples();
+    NODE_LOGI(BACKUP_LOG_DONE, _log.samples(), _log.blocks(), _log.dropped());
+  }
+
+  if (bits & ABORT_BIT) {
+    NODE_LOGW(BACKUP_ABORTED);
+    return TEST_FAILED;
+  }
+  if (!(bits & CAPTURE_DONE_BIT)) {
+    NODE_LOGW(BACKUP_TIMEOUT, _testDuration);
+    return TEST_FAILED;
+  }
+  if (_dataCaptureOk && process_time_capture()) {
+    NODE_LOGI(BACKUP_TIME, _data.backupTest[_currentTest].backuptime_ms);
+    Checkpoint::saveBackupResult(_currentTest, _data.backupTest[_currentTest]);
+    sendEndSignal();
+    return TEST_SUCESSFUL;
+  }
+  return TEST_FAILED;
+}
@@ -1,93 +1,62 @@
 #ifndef BACKUP_TIME_H
 #define BACKUP_TIME_H
 #include "Arduino.h"
+#include "BackupLog.h"
 #include "HardwareConfig.h"
-#include "Testmanager.h"
+#include "TestManager.h"
+#include "UPSTest.h"
 
 struct BackupTimeTestData {
-
-  struct TestData {
-    uint8_t testNo;
-    unsigned long testTimestamp;
-    unsigned long switchtime;
-    unsigned long starttime;
-    unsigned long endtime;
-    LoadPercentage load_percentage : 7;  // Adjusted to cover all possible
-    bool valid_data : 1;
-  } switchTest[5];
+  using TestData = Node_Core::BackupResult;
+  TestData backupTest[5];
   struct TestSettings {
-    uint8_t pwmchannelNo = 0;
-    uint8_t pwmResolusion_bits = 8;
-    uint16_t pwmduty_set = 0;
-    uint16_t adjust_pwm_25P = 0;
-    uint16_t adjust_pwm_50P = 0;
-    uint16_t adjust_pwm_75P = 0;
-    uint16_t adjust_pwm_100P = 0;
-    uint32_t pwm_frequecy = 3000;
-    unsigned long ToleranceSwitchTime_ms = 50;
-    unsigned long min_valid_switch_time_ms = 0;
-    unsigned long max_valid_switch_time_ms = 10000;
-    unsigned long testduration_ms = 10000;
-    uint8_t max_retest = 3;
+    unsigned long ToleranceBackupTime_ms = 300000;
+    unsigned long min_valid_backup_time_ms = 1000;
+    unsigned long debounceDelay_us = 100000;
+    // The UPS output has to stay low this long to count as shutdown; the
+    // gap while the UPS transfers to battery comes back well within it
+    unsigned long shutdownConfirm_ms = 2000;
+    unsigned long sampleInterval_ms = 1000;
+    uint32_t batteryDivider_x1000 = 11000;  // Battery volts per ADC volt
+    bool logToFlash = true;
+    uint8_t max_retest = 1;
   } testsettings;
-
-  struct TaskSettings {
-    BaseType_t switchtaskCore = 0;
-    BaseType_t mainsISRtaskCore = ARDUINO_RUNNING_CORE;
-    BaseType_t upsISRtaskCore = ARDUINO_RUNNING_CORE;
-
-    UBaseType_t switchtaskPr = 2;
-    UBaseType_t mainsISRtaskPr = 1;
-    UBaseType_t upsISRtaskPr = 1;
-    uint32_t switchtaskStack = 12000;
-    uint32_t mainsISRtaskStack = 12000;
-    uint32_t upsISRtaskStack = 12000;
-  } tasksettings;
 };
-class BackupTimeTest {
+
+class BackupTimeTest : public UPSTest<BackupTimeTest, BackupTimeTestData,
+                                      TestType::BackupTimeTest> {
 public:
-  static BackupTimeTest* getInstance();  // Singleton accessor
-  static void deleteInstance();
-  void init();
-  BackupTimeTestData& data();
   TestResult run(uint16_t testVARating = 4000,
-                 unsigned long testduration = 10000);
+                 unsigned long testduration = 28800000UL);
 
 private:
+  friend class UPSTest<BackupTimeTest, BackupTimeTestData,
+                       TestType::BackupTimeTest>;
+  friend class TestManager;
   BackupTimeTest();  // Private Constructor
-  ~BackupTimeTest();
-  static BackupTimeTest* instance;  // Static pointer to hold the instance
+  ~BackupTimeTest() = default;
 
-  BackupTimeTestData _data;
-  BackupTimeTestData::TestSettings _config;
-  BackupTimeTestData::TaskSettings _tasksetting;
-  bool _initialized = false;
-  bool _testRunning;
-  bool _time_capture_running;
-  bool _time_capture_ok;
-  uint8_t _currentTest;
-  unsigned long _testDuration;
+  // Set while the UPS output is low after the mains loss but not yet
+  // confirmed as shutdown
+  static constexpr EventBits_t UPS_LOW_BIT = BIT3;
 
-  void setupPins();
-  void configureInterrupts();
-  void createMainTasks();
-  void createISRTasks();
-
-  static void backuptimeTestTask(void* pvParameters);
-  static void onMainsPowerLossTask(void* pvParameters);
-  static void onUPSShutDownTask(void* pvParameters);
-
-  void simulatePowerCut();
-  void simulatePowerRestore();
-  void sendEndSignal();
-  void settestDuration(unsigned long duration);
-  void setLoad(uint16_t testVARating);
-  void selectLoadBank(uint16_t bankNumbers);
-
-  void startTimeCapture();
-  void stopTimeCapture();
+  BackupTimeTestData::TestSettings _config;
+  int64_t _captureStart_us;
+  int64_t _captureEnd_us;
+  int64_t _lastMainsEdge_us;
+  int64_t _upsFall_us;  // Last UPS output fall, guarded by _fallLock
+  int64_t _cutTime_us;
+  portMUX_TYPE _fallLock;
+  BackupLog _log;
+
+  // UPSTest hooks
+  void resetData();
+  void onEdgeEvent(const EdgeEvent& event);
+  static void MainTestTask(void* pvParameters);
+
+  void takeSample();
+  EventBits_t waitShutdown(TickType_t timeout);
   bool process_time_capture();
-  bool checkTimerange(unsigned long switchtime);
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,211 @@
+#include "EfficiencyTest.h"
+#include "NodeLog.h"
+#include "PowerMeters.h"
+
+extern StateMachine* stateMachine;
+
+using namespace Node_Core;
+using NodeTask::IO_SETUP;
+
+// Private Constructor
+EfficiencyTest::EfficiencyTest() : _config() {
+  _testDuration = _config.window_ms;
+}
+
+void EfficiencyTest::resetData() {
+  for (auto& test : _data.efficiencyTest) {
+    test.testNo = 0;
+    test.testTimestamp = 0;
+    test.valid_data = false;
+    test.efficiency_x100 = 0;
+    test.inputEnergy_mWh = 0;
+    test.outputEnergy_mWh = 0;
+    test.inputPower_W = 0;
+    test.outputPower_W = 0;
+    test.pairs = 0;
+    test.maxSkew_ms = 0;
+    test.load_percentage = LoadPercentage::LOAD_0P;
+  }
+}
+
+// Main EfficiencyTest task, measures all four load levels per startTest()
+void EfficiencyTest::MainTestTask(void* pvParameters) {
+  if (instance) {
+    while (true) {
+      ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+      SetupTaskParams* params = (SetupTaskParams*)pvParameters;
+      NODE_LOGI(EFFICIENCY_START, params->task_TestVARating);
+      instance->runLevels(stateMachine, params->task_TestVARating);
+      NODE_LOGD(TASK_STACK_HWM, uxTaskGetStackHighWaterMark(NULL));
+    }
+  }
+  vTaskDelete(NULL);
+}
+
+// Reads both meters back to back and books the pair at their common mean
+// time, so input and output energy are integrated over identical intervals.
+// Each read is stamped at its midpoint; pairs too far apart are dropped.
+bool EfficiencyTest::samplePair(bool inputFirst, uint16_t& skew_ms) {
+  powerMeasure input;
+  powerMeasure output;
+  int64_t inputTime_us = 0;
+  int64_t outputTime_us = 0;
+
+  auto read = [](bool fromInput, powerMeasure& values, int64_t& time_us) {
+    int64_t before = IO_SETUP::now_us();
+    bool ok = fromInput ? PowerMeters::readInput(values)
+                        : PowerMeters::readOutput(values);
+    time_us = before + (IO_SETUP::now_us() - before) / 2;
+    return ok;
+  };
+
+  bool ok = inputFirst ? read(true, input, inputTime_us)
+                             && read(false, output, outputTime_us)
+                       : read(false, output, outputTime_us)
+                             && read(true, input, inputTime_us);
+  if (!ok) {
+    return false;
+  }
+
+  int64_t skew_us = outputTime_us > inputTime_us
+                        ? outputTime_us - inputTime_us
+                        : inputTime_us - outputTime_us;
+  if (skew_us > static_cast<int64_t>(_config.maxPairSkew_ms) * 1000) {
+    return false;
+  }
+  skew_ms = static_cast<uint16_t>(skew_us / 1000);
+
+  int64_t pairTime_us = inputTime_us + (outputTime_us - inputTime_us) / 2;
+  _input.add(pairTime_us, input.power);
+  _output.add(pairTime_us, output.power);
+  return true;
+}
+
+bool EfficiencyTest::process_measurement() {
+  EfficiencyTestData::TestData& test = _data.efficiencyTest[_currentTest];
+  if (test.pairs < _config.minPairs) {
+    NODE_LOGW(EFFICIENCY_TOO_FEW_PAIRS, test.pairs, _config.minPairs);
+    return false;
+  }
+  double inputEnergy = _input.energy_mWh();
+  double outputEnergy = _output.energy_mWh();
+  if (inputEnergy <= 0.0) {
+    return false;
+  }
+
+  uint32_t efficiency
+      = static_cast<uint32_t>(outputEnergy / inputEnergy * 10000.0 + 0.5);
+  test.efficiency_x100 = efficiency > UINT16_MAX ? UINT16_MAX : efficiency;
+  test.inputEnergy_mWh = static_cast<uint32_t>(inputEnergy);
+  test.outputEnergy_mWh = static_cast<uint32_t>(outputEnergy);
+  test.inputPower_W = static_cast<uint16_t>(_input.averagePower_W());
+  test.outputPower_W = static_cast<uint16_t>(_output.averagePower_W());
+  test.testNo = _currentTest + 1;
+  test.testTimestamp = static_cast<unsigned long>(IO_SETUP::now_us() / 1000);
+
+  if (test.efficiency_x100 < _config.min_valid_efficiency_x100
+      || test.efficiency_x100 > _config.max_valid_efficiency_x100) {
+    return false;
+  }
+  test.valid_data = true;
+  return true;
+}
+
+// Applies the load, waits for it to settle, then samples both meters on a
+// fixed grid for testduration ms
+TestResult EfficiencyTest::run(uint16_t testVARating,
+                               unsigned long testduration) {
+  EfficiencyTestData::TestData& test = _data.efficiencyTest[_currentTest];
+  _testDuration = testduration;
+  test.valid_data = false;
+  test.pairs = 0;
+  test.maxSkew_ms = 0;
+  test.load_percentage = setLoad(testVARating);
+  PowerMeters::init();
+
+  EventBits_t bits
+      = xEventGroupWaitBits(_testEvents, ABORT_BIT, pdFALSE, pdFALSE,
+                            pdMS_TO_TICKS(_config.settleTime_ms));
+
+  _input.reset();
+  _output.reset();
+  const TickType_t interval = pdMS_TO_TICKS(_config.sampleInterval_ms);
+  TickType_t nextSample = xTaskGetTickCount();
+  const TickType_t end = nextSample + pdMS_TO_TICKS(_testDuration);
+  bool inputFirst = true;
+
+  while (!(bits & ABORT_BIT)
+         && static_cast<int32_t>(end - xTaskGetTickCount()) > 0) {
+    uint16_t skew_ms = 0;
+    if (samplePair(inputFirst, skew_ms)) {
+      test.pairs++;
+      if (skew_ms > test.maxSkew_ms) {
+        test.maxSkew_ms = skew_ms;
+      }
+    }
+    // Alternate the read order so neither meter always lags the other
+    inputFirst = !inputFirst;
+
+    nextSample += interval;
+    int32_t wait = static_cast<int32_t>(nextSample - xTaskGetTickCount());
+    bits = xEventGroupWaitBits(_testEvents, ABORT_BIT, pdFALSE, pdFALSE,
+                               wait > 0 ? wait : 0);
+  }
+
+  if (bits & ABORT_BIT) {
+    NODE_LOGW(EFFICIENCY_ABORTED);
+    return TEST_FAILED;
+  }
+  if (!process_measurement()) {
+    return TEST_FAILED;
+  }
+  NODE_LOGI(EFFICIENCY_RESULT, test.load_percentage, test.efficiency_x100,
+            test.pairs);
+  return TEST_SUCESSFUL;
+}
+
+namespace {
+
+const LoadPercentage efficiencyLevels[] = {LOAD_25P, LOAD_50P, LOAD_75P,
+                                           LOAD_100P};
+
+}  // namespace
+
+// Measures efficiencyTest[0..3] at 25/50/75/100 % of fullLoadVA. When the
+// state machine is in EFFICIENCY_TEST_START the result is reported through
+// the START -> DONE -> CHECK chain, and CHECK may ask for a retry.
+TestResult EfficiencyTest::runLevels(StateMachine* stateMachine,
+                                     uint16_t fullLoadVA) {
+  const bool driveStateMachine
+      = stateMachine
+        && stateMachine->getCurrentState() == State::EFFICIENCY_TEST_START;
+
+  while (true) {
+    bool allValid = true;
+    for (uint8_t level = 0; level < 4; ++level) {
+      _currentTest = level;
+      LoadPercentage load = efficiencyLevels[level];
+      uint16_t levelVA = (static_cast<uint32_t>(fullLoadVA) * load) / 100;
+      if (run(levelVA, _config.window_ms) != TEST_SUCESSFUL) {
+        allValid = false;
+        break;
+      }
+      _data.efficiencyTest[level].load_percentage = load;
+    }
+    _currentTest = 0;
+
+    if (abortRequested() || !driveStateMachine) {
+      return allValid ? TEST_SUCESSFUL : TEST_FAILED;
+    }
+    stateMachine->handleEvent(Event::MESURED_DATA_RECEIVED);
+    stateMachine->handleEvent(Event::POWER_MEASURE_OK);
+    stateMachine->handleEvent(allValid ? Event::TEST_SUCCESS
+                                       : Event::TEST_FAILED);
+    if (stateMachine->getCurrentState() != State::EFFICIENCY_TEST_START) {
+      break;
+    }
+  }
+  return stateMachine->getCurrentState() == State::EFFICIENCY_TEST_OK
+             ? TEST_SUCESSFUL
+             : TEST_FAILED;
+}
@@ -0,0 +1,93 @@
+#ifndef EFFICIENCY_TEST_H
+#define EFFICIENCY_TEST_H
+#include "Arduino.h"
+#include "HardwareConfig.h"
+#include "TestManager.h"
+#include "UPSTest.h"
+#include "powerMeasure.h"
+
+struct EfficiencyTestData {
+
+  // Efficiency is the ratio of integrated output to input energy over the
+  // measurement window, not of two instantaneous readings
+  struct TestData {
+    uint8_t testNo;
+    unsigned long testTimestamp;
+    uint16_t efficiency_x100;  // 0.01 % units
+    uint32_t inputEnergy_mWh;
+    uint32_t outputEnergy_mWh;
+    uint16_t inputPower_W;   // Window average
+    uint16_t outputPower_W;  // Window average
+    uint16_t pairs;          // Aligned input/output samples used
+    uint16_t maxSkew_ms;     // Worst input/output timestamp difference kept
+    LoadPercentage load_percentage : 7;  // Adjusted to cover all possible
+    bool valid_data : 1;
+  } efficiencyTest[5];
+  struct TestSettings {
+    unsigned long settleTime_ms = 5000;  // After a load change
+    unsigned long window_ms = 60000;
+    unsigned long sampleInterval_ms = 1000;  // PZEM refreshes about 1 Hz
+    unsigned long maxPairSkew_ms = 150;  // Pairs further apart are dropped
+    uint16_t minPairs = 20;
+    uint16_t min_valid_efficiency_x100 = 5000;
+    uint16_t max_valid_efficiency_x100 = 10000;
+    uint8_t max_retest = 3;
+  } testsettings;
+};
+
+// Trapezoidal integration of power over irregular sample times
+struct EnergyIntegrator {
+  bool started = false;
+  int64_t first_us = 0;
+  int64_t last_us = 0;
+  uint32_t lastPower_dW = 0;
+  double energy_dWus = 0.0;
+
+  void reset() { *this = EnergyIntegrator(); }
+  void add(int64_t time_us, uint32_t power_dW) {
+    if (started) {
+      energy_dWus += 0.5 * (static_cast<double>(lastPower_dW) + power_dW)
+                     * static_cast<double>(time_us - last_us);
+    } else {
+      started = true;
+      first_us = time_us;
+    }
+    last_us = time_us;
+    lastPower_dW = power_dW;
+  }
+  // 0.1 W * us -> mWh
+  double energy_mWh() const { return energy_dWus / 36000000.0; }
+  double averagePower_W() const {
+    return last_us > first_us ? energy_dWus / 10.0 / (last_us - first_us)
+                              : lastPower_dW / 10.0;
+  }
+};
+
+class EfficiencyTest : public UPSTest<EfficiencyTest, EfficiencyTestData,
+                                      TestType::EfficiencyTest> {
+public:
+  TestResult run(uint16_t testVARating = 4000,
+                 unsigned long testduration = 60000);
+  TestResult runLevels(StateMachine* stateMachine, uint16_t fullLoadVA);
+
+private:
+  friend class UPSTest<EfficiencyTest, EfficiencyTestData,
+                       TestType::EfficiencyTest>;
+  friend class TestManager;
+  EfficiencyTest();  // Private Constructor
+  ~EfficiencyTest() = default;
+
+  EfficiencyTestData::TestSettings _config;
+  EnergyIntegrator _input;
+  EnergyIntegrator _output;
+
+  // UPSTest hooks
+  void resetData();
+  void onEdgeEvent(const EdgeEvent& event) {}
+  static void MainTestTask(void* pvParameters);
+
+  bool samplePair(bool inputFirst, uint16_t& skew_ms);
+  bool process_measurement();
+};
+
+#endif
@@ -0,0 +1,160 @@
+#include "InputVoltageTest.h"
+#include "NodeLog.h"
+#include "PowerMeters.h"
+
+using namespace Node_Core;
+using NodeTask::IO_SETUP;
+
+namespace {
+
+StubVoltageSource defaultSource;
+
+}  // namespace
+
+// Private Constructor
+InputVoltageTest::InputVoltageTest() : _config(), _source(&defaultSource) {}
+
+void InputVoltageTest::resetData() {
+  for (auto& step : _data.steps) {
+    step.inputSetpoint_volt = 0;
+    step.inputVoltage_dV = 0;
+    step.outputVoltage_dV = 0;
+    step.outputStddev_dV = 0;
+    step.settleTime_ms = 0;
+    step.settled = false;
+    step.in_regulation = false;
+  }
+  _data.stepCount = 0;
+  _data.testTimestamp = 0;
+  _data.sweepTime_ms = 0;
+  _data.load_percentage = LoadPercentage::LOAD_0P;
+  _data.valid_data = false;
+}
+
+void InputVoltageTest::setSource(VoltageSource* source) {
+  _source = source ? source : &defaultSource;
+}
+
+// Main InputVoltageTest task, runs one sweep per startTest()
+void InputVoltageTest::MainTestTask(void* pvParameters) {
+  if (instance) {
+    while (true) {
+      ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+      SetupTaskParams* params = (SetupTaskParams*)pvParameters;
+      instance->run(params->task_TestVARating);
+      NODE_LOGD(TASK_STACK_HWM, uxTaskGetStackHighWaterMark(NULL));
+    }
+  }
+  vTaskDelete(NULL);
+}
+
+// Applies one setpoint and samples the output until the variance over the
+// settling window drops below the threshold, or maxDwell_ms runs out.
+// Returns false only on abort or when the source rejects the setpoint.
+bool InputVoltageTest::runStep(uint16_t setpoint_volt,
+                               InputVoltageTestData::StepData& step) {
+  step.inputSetpoint_volt = setpoint_volt;
+  step.settled = false;
+  step.in_regulation = false;
+  if (!_source->setVoltage(setpoint_volt)) {
+    NODE_LOGE(INPUT_SOURCE_FAILED, setpoint_volt);
+    return false;
+  }
+
+  _settling.reset();
+  const TickType_t interval = pdMS_TO_TICKS(_config.sampleInterval_ms);
+  const TickType_t start = xTaskGetTickCount();
+  const TickType_t deadline = start + pdMS_TO_TICKS(_config.maxDwell_ms);
+  TickType_t nextSample = start;
+
+  while (true) {
+    powerMeasure output;
+    if (PowerMeters::readOutput(output)) {
+      _settling.add(output.voltage);
+      if (_settling.settled(_config.settleStddev_dV)) {
+        step.settled = true;
+        break;
+      }
+    }
+    if (static_cast<int32_t>(deadline - xTaskGetTickCount()) <= 0) {
+      break;
+    }
+    nextSample += interval;
+    int32_t wait = static_cast<int32_t>(nextSample - xTaskGetTickCount());
+    EventBits_t bits = xEventGroupWaitBits(_testEvents, ABORT_BIT, pdFALSE,
+                                           pdFALSE, wait > 0 ? wait : 0);
+    if (bits & ABORT_BIT) {
+      return false;
+    }
+  }
+
+  step.settleTime_ms = static_cast<uint16_t>(
+      (xTaskGetTickCount() - start) * portTICK_PERIOD_MS);
+  step.outputVoltage_dV = static_cast<uint16_t>(_settling.mean() + 0.5);
+  step.outputStddev_dV = static_cast<uint16_t>(_settling.stddev() + 0.5);
+
+  powerMeasure input;
+  if (PowerMeters::readInput(input)) {
+    step.inputVoltage_dV = input.voltage;
+  }
+
+  const uint32_t rated_dV = _cfgSpec.RatedVoltage_volt * 10UL;
+  const uint32_t tolerance_dV = rated_dV * _config.outputTolerance_pct / 100;
+  const uint32_t deviation_dV = step.outputVoltage_dV > rated_dV
+                                    ? step.outputVoltage_dV - rated_dV
+                                    : rated_dV - step.outputVoltage_dV;
+  step.in_regulation = step.settled && deviation_dV <= tolerance_dV;
+
+  if (step.settled) {
+    NODE_LOGI(INPUT_STEP, setpoint_volt, step.outputVoltage_dV,
+              step.settleTime_ms);
+  } else {
+    NODE_LOGW(INPUT_STEP_UNSETTLED, setpoint_volt, step.settleTime_ms);
+  }
+  return true;
+}
+
+// Steps the input from the spec minimum to maximum in step_volt increments.
+// Each step moves on as soon as the output has settled rather than after a
+// fixed dwell. The source is returned to the rated voltage afterwards.
+TestResult InputVoltageTest::run(uint16_t testVARating) {
+  resetData();
+  const uint16_t minVolt = _cfgSpec.MinInputVoltage_volt;
+  const uint16_t maxVolt = _cfgSpec.MaxInputVoltage_volt;
+  if (_config.step_volt == 0 || minVolt > maxVolt || !_source->begin()) {
+    return TEST_FAILED;
+  }
+  NODE_LOGI(INPUT_SWEEP_START, minVolt, maxVolt);
+
+  _data.load_percentage = setLoad(testVARating);
+  PowerMeters::init();
+
+  const int64_t start_us = IO_SETUP::now_us();
+  bool completed = true;
+  bool allValid = true;
+  for (uint32_t volt = minVolt; volt <= maxVolt; volt += _config.step_volt) {
+    if (_data.stepCount == InputVoltageTestData::MAX_STEPS) {
+      break;
+    }
+    InputVoltageTestData::StepData& step = _data.steps[_data.stepCount];
+    if (!runStep(static_cast<uint16_t>(volt), step)) {
+      completed = false;
+      break;
+    }
+    _data.stepCount++;
+    allValid = allValid && step.in_regulation;
+  }
+  _source->setVoltage(_cfgSpec.RatedVoltage_volt);
+
+  if (abortRequested()) {
+    NODE_LOGW(INPUT_SWEEP_ABORTED);
+    return TEST_FAILED;
+  }
+  _data.sweepTime_ms
+      = static_cast<uint32_t>((IO_SETUP::now_us() - start_us) / 1000);
+  _data.testTimestamp = static_cast<unsigned long>(IO_SETUP::now_us() / 1000);
+  NODE_LOGI(INPUT_SWEEP_DONE, _data.stepCount, _data.sweepTime_ms);
+
+  _data.valid_data = completed && allValid;
+  return _data.valid_data ? TEST_SUCESSFUL : TEST_FAILED;
+}
@@ -0,0 +1,65 @@
+#ifndef INPUT_VOLTAGE_TEST_H
+#define INPUT_VOLTAGE_TEST_H
+#include "Arduino.h"
+#include "HardwareConfig.h"
+#include "SettlingDetector.h"
+#include "TestManager.h"
+#include "UPSTest.h"
+#include "VoltageSource.h"
+#include "powerMeasure.h"
+
+struct InputVoltageTestData {
+  static constexpr uint8_t MAX_STEPS = 32;
+
+  // One entry per input voltage step of the sweep
+  struct StepData {
+    uint16_t inputSetpoint_volt;
+    uint16_t inputVoltage_dV;   // Measured at the UPS input once settled
+    uint16_t outputVoltage_dV;  // Mean of the settling window
+    uint16_t outputStddev_dV;
+    uint16_t settleTime_ms;
+    bool settled : 1;
+    bool in_regulation : 1;
+  } steps[MAX_STEPS];
+  uint8_t stepCount;
+  unsigned long testTimestamp;
+  uint32_t sweepTime_ms;
+  LoadPercentage load_percentage : 7;  // Adjusted to cover all possible
+  bool valid_data : 1;
+  struct TestSettings {
+    uint16_t step_volt = 10;
+    unsigned long sampleInterval_ms = 1000;  // PZEM refreshes about 1 Hz
+    unsigned long maxDwell_ms = 15000;       // Step is unsettled after this
+    uint16_t settleStddev_dV = 5;            // 0.5 V over the window
+    uint8_t outputTolerance_pct = 10;        // Around RatedVoltage_volt
+  } testsettings;
+};
+
+class InputVoltageTest
+    : public UPSTest<InputVoltageTest, InputVoltageTestData,
+                     TestType::InputVoltageTest> {
+public:
+  // Sweeps MinInputVoltage_volt..MaxInputVoltage_volt of the UPS spec
+  TestResult run(uint16_t testVARating = 4000);
+  void setSource(VoltageSource* source);
+
+private:
+  friend class UPSTest<InputVoltageTest, InputVoltageTestData,
+                       TestType::InputVoltageTest>;
+  friend class TestManager;
+  InputVoltageTest();  // Private Constructor
+  ~InputVoltageTest() = default;
+
+  InputVoltageTestData::TestSettings _config;
+  VoltageSource* _source;
+  SettlingDetector _settling;
+
+  // UPSTest hooks
+  void resetData();
+  void onEdgeEvent(const EdgeEvent& event) {}
+  static void MainTestTask(void* pvParameters);
+
+  bool runStep(uint16_t setpoint_volt, InputVoltageTestData::StepData& step);
+};
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef SETTLING_DETECTOR_H
+#define SETTLING_DETECTOR_H
+#include <math.h>
+#include <stdint.h>
+
+// Variance over the last WINDOW readings, updated in O(1) per sample from
+// running sums. The signal counts as settled once the window is full and
+// its standard deviation is at or below the threshold.
+struct SettlingDetector {
+  static constexpr uint8_t WINDOW = 4;
+
+  int32_t samples[WINDOW] = {};
+  uint8_t count = 0;
+  uint8_t next = 0;
+  int64_t sum = 0;
+  int64_t sumSq = 0;
+
+  void reset() { *this = SettlingDetector(); }
+
+  void add(int32_t value) {
+    if (count == WINDOW) {
+      int32_t old = samples[next];
+      sum -= old;
+      sumSq -= static_cast<int64_t>(old) * old;
+    } else {
+      count++;
+    }
+    samples[next] = value;
+    next = (next + 1) % WINDOW;
+    sum += value;
+    sumSq += static_cast<int64_t>(value) * value;
+  }
+
+  double mean() const { return count ? static_cast<double>(sum) / count : 0; }
+  double variance() const {
+    if (count < 2) {
+      return 0.0;
+    }
+    double m = mean();
+    double v = (static_cast<double>(sumSq) - count * m * m) / (count - 1);
+    return v > 0.0 ? v : 0.0;
+  }
+  double stddev() const { return sqrt(variance()); }
+  bool settled(double maxStddev) const {
+    return count == WINDOW && stddev() <= maxStddev;
+  }
+};
+
+#endif  // SETTLING_DETECTOR_H
@@ -0,0 +1,30 @@
+#ifndef VOLTAGE_SOURCE_H
+#define VOLTAGE_SOURCE_H
+#include <stdint.h>
+
+// Controllable AC source feeding the UPS input. Only setpoint changes go
+// through here, a few per second at most, so a virtual call is fine.
+class VoltageSource {
+public:
+  virtual ~VoltageSource() = default;
+  virtual bool begin() = 0;
+  virtual bool setVoltage(uint16_t volt) = 0;
+  virtual uint16_t setpoint() const = 0;
+};
+
+// Records the setpoint and reports success. Used when no programmable source
+// is wired (the operator follows the logged setpoints) and in host builds.
+class StubVoltageSource : public VoltageSource {
+public:
+  bool begin() override { return true; }
+  bool setVoltage(uint16_t volt) override {
+    _setpoint = volt;
+    return true;
+  }
+  uint16_t setpoint() const override { return _setpoint; }
+
+private:
+  uint16_t _setpoint = 0;
+};
+
+#endif  // VOLTAGE_SOURCE_H
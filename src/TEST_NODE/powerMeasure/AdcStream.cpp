@@ -0,0 +1,69 @@
+#include "AdcStream.h"
+#include "HardwareConfig.h"
+#include "HardwareSetup.h"
+#include "PowerMeters.h"
+#include "driver/gpio.h"
+
+using NodeTask::IO_SETUP;
+
+namespace {
+
+// Two 860 SPS periods without a conversion means the ADC stalled
+constexpr TickType_t READY_TIMEOUT = pdMS_TO_TICKS(10);
+
+// ALERT/RDY pulses low after every conversion in continuous mode. The pin is
+// open drain and needs the external pull-up, GPIO34 has none.
+void IRAM_ATTR adsReadyISR(void* arg) {
+  BaseType_t higherPriorityTaskWoken = pdFALSE;
+  vTaskNotifyGiveFromISR(static_cast<TaskHandle_t>(arg),
+                         &higherPriorityTaskWoken);
+  portYIELD_FROM_ISR(higherPriorityTaskWoken);
+}
+
+}  // namespace
+
+bool AdcStream::begin(ADS1115_MUX channel, ADS1115_RANGE range) {
+  PowerMeters::init();
+  if (_active || !PowerMeters::adcReady() || !PowerMeters::lockAdc()) {
+    return false;
+  }
+  ADS1115_WE& adc = PowerMeters::adc();
+  adc.setCompareChannels(channel);
+  adc.setVoltageRange_mV(range);
+  adc.setConvRate(ADS1115_860_SPS);
+  adc.setAlertPinMode(ADS1115_ASSERT_AFTER_1);
+  adc.setAlertPinToConversionReady();
+
+  gpio_num_t readyPin = static_cast<gpio_num_t>(ADS_ALERT_RDY_PIN);
+  gpio_set_direction(readyPin, GPIO_MODE_INPUT);
+  gpio_set_intr_type(readyPin, GPIO_INTR_NEGEDGE);
+  gpio_install_isr_service(0);  // Already installed is not an error here
+  gpio_isr_handler_add(readyPin, adsReadyISR, xTaskGetCurrentTaskHandle());
+  ulTaskNotifyTake(pdTRUE, 0);
+  adc.setMeasureMode(ADS1115_CONTINUOUS);
+  _active = true;
+  return true;
+}
+
+bool AdcStream::read(int16_t& value, int64_t& time_us, uint32_t& missed) {
+  uint32_t ready = ulTaskNotifyTake(pdTRUE, READY_TIMEOUT);
+  if (!_active || ready == 0) {
+    return false;
+  }
+  time_us = IO_SETUP::now_us();
+  value = PowerMeters::adc().getRawResult();
+  missed = ready - 1;
+  return true;
+}
+
+void AdcStream::end() {
+  if (!_active) {
+    return;
+  }
+  gpio_isr_handler_remove(static_cast<gpio_num_t>(ADS_ALERT_RDY_PIN));
+  ADS1115_WE& adc = PowerMeters::adc();
+  adc.setMeasureMode(ADS1115_SINGLE);
+  adc.setAlertPinMode(ADS1115_DISABLE_ALERT);
+  PowerMeters::unlockAdc();
+  _active = false;
+}
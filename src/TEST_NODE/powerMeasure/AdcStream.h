@@ -0,0 +1,23 @@
+#ifndef ADC_STREAM_H
+#define ADC_STREAM_H
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <ADS1115_WE.h>
+#include <stdint.h>
+
+// ADS1115 in continuous mode at 860 SPS, one result per ALERT/RDY pulse.
+// The pulse ISR notifies the reading task, so it sleeps between
+// conversions. Holds the PowerMeters ADC lock from begin() to end().
+class AdcStream {
+public:
+  bool begin(ADS1115_MUX channel, ADS1115_RANGE range);
+  // Waits for the next conversion; false when the ADC stalled. missed
+  // counts conversions that completed before the previous one was read.
+  bool read(int16_t& value, int64_t& time_us, uint32_t& missed);
+  void end();
+
+private:
+  bool _active = false;
+};
+
+#endif  // ADC_STREAM_H
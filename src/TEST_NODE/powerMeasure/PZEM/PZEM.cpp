@@ -132,6 +132,15 @@ uint16_t PZEM::getPowerFactor() {
   return _currentValues.pf;
 }
 
+bool PZEM::sample(powerMeasure& values) {
+  if (!updateValues()) {
+    return false;
+  }
+  _currentValues.last_measured_ms = millis();
+  values = _currentValues;
+  return true;
+}
+
 uint8_t PZEM::readAddress(bool update) {
 
   if (update) {
@@ -307,12 +316,14 @@ uint32_t PZEM::extract32BitValue(const uint8_t *response, int startIndex) {
 powerMeasure PZEM::extractAllBits(const uint8_t *response) {
   powerMeasure power;
 
-  power.voltage = extract16BitValue(response, 0) / 10.0;
-  power.current = extract32BitValue(response, 2) / 1000.0;
-  power.power = extract32BitValue(response, 6) / 10.0;
-  power.energy = extract32BitValue(response, 10) / 1000.0;
-  power.frequency = extract16BitValue(response, 14) / 10.0;
-  power.pf = extract16BitValue(response, 16) / 100.0;
+  // Kept in register units, dividing into the integer fields truncated
+  // current to whole amps and pf to 0 or 1
+  power.voltage = extract16BitValue(response, 0);
+  power.current = extract32BitValue(response, 2);
+  power.power = extract32BitValue(response, 6);
+  power.energy = extract32BitValue(response, 10);
+  power.frequency = extract16BitValue(response, 14);
+  power.pf = extract16BitValue(response, 16);
   power.alarms = extract16BitValue(response, 18);
 
   return power;
@@ -75,6 +75,8 @@ public:
   uint32_t getEnergy();
   uint16_t getFrequency();
   uint16_t getPowerFactor();
+  // One register read for all quantities, so they belong to the same instant
+  bool sample(powerMeasure& values);
 
   bool getPowerAlarm();
   bool setPowerAlarm(uint16_t watts);
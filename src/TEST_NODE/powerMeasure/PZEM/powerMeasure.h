@@ -2,14 +2,15 @@
 #define POWER_MEASURE_H
 #include <stdint.h>
 
+// PZEM-004T register units
 struct powerMeasure {
-  uint16_t voltage;
-  uint16_t frequency;
-  uint16_t pf;
+  uint16_t voltage;    // 0.1 V
+  uint16_t frequency;  // 0.1 Hz
+  uint16_t pf;         // 0.01
   uint16_t alarms;
-  uint32_t current;
-  uint32_t power;
-  uint32_t energy;
+  uint32_t current;  // 1 mA
+  uint32_t power;    // 0.1 W
+  uint32_t energy;   // 1 Wh
   bool isValid;
   unsigned long last_measured_ms;
   powerMeasure()
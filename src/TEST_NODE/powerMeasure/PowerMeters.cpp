@@ -0,0 +1,79 @@
+#include "PowerMeters.h"
+#include "HardwareConfig.h"
+#include <Wire.h>
+
+PZEM PowerMeters::_input;
+PZEM PowerMeters::_output;
+ADS1115_WE PowerMeters::_adc(ADS_I2C_ADDR);
+SemaphoreHandle_t PowerMeters::_busLock = NULL;
+SemaphoreHandle_t PowerMeters::_adcLock = NULL;
+bool PowerMeters::_adcReady = false;
+
+void PowerMeters::init() {
+  if (_busLock != NULL) {
+    return;
+  }
+  _busLock = xSemaphoreCreateMutex();
+  _adcLock = xSemaphoreCreateMutex();
+
+  Serial1.begin(PZEM_BAUD_RATE, SERIAL_8N1, PZEM_RX_PIN, PZEM_TX_PIN);
+  _input.init(&Serial1, false, PZEM_INPUT_ADDR);
+  _output.init(&Serial1, false, PZEM_OUTPUT_ADDR);
+
+  Wire.begin(ADS_SDA_PIN, ADS_SCL_PIN);
+  Wire.setClock(400000);  // A result read must fit in one 860 SPS period
+  _adcReady = _adc.init();
+  if (_adcReady) {
+    _adc.setVoltageRange_mV(ADS1115_RANGE_6144);
+    _adc.setMeasureMode(ADS1115_SINGLE);
+  }
+}
+
+bool PowerMeters::lockBus(TickType_t timeout) {
+  return _busLock != NULL && xSemaphoreTake(_busLock, timeout) == pdTRUE;
+}
+
+void PowerMeters::unlockBus() { xSemaphoreGive(_busLock); }
+
+bool PowerMeters::lockAdc(TickType_t timeout) {
+  return _adcLock != NULL && xSemaphoreTake(_adcLock, timeout) == pdTRUE;
+}
+
+void PowerMeters::unlockAdc() { xSemaphoreGive(_adcLock); }
+
+bool PowerMeters::readInput(powerMeasure& values) {
+  if (!lockBus()) {
+    return false;
+  }
+  bool ok = _input.sample(values);
+  unlockBus();
+  return ok;
+}
+
+bool PowerMeters::readOutput(powerMeasure& values) {
+  if (!lockBus()) {
+    return false;
+  }
+  bool ok = _output.sample(values);
+  unlockBus();
+  return ok;
+}
+
+bool PowerMeters::readBattery_mV(uint32_t dividerRatio_x1000, uint32_t& mV) {
+  if (!_adcReady || !lockAdc()) {
+    return false;
+  }
+  // The waveform capture leaves other range and mode settings behind
+  _adc.setVoltageRange_mV(ADS1115_RANGE_6144);
+  _adc.setMeasureMode(ADS1115_SINGLE);
+  _adc.setCompareChannels(ADS1115_COMP_0_GND);
+  _adc.startSingleMeasurement();
+  while (_adc.isBusy()) {
+    vTaskDelay(1);
+  }
+  float pin_mV = _adc.getResult_mV();
+  unlockAdc();
+  mV = pin_mV > 0 ? static_cast<uint32_t>(pin_mV * dividerRatio_x1000 / 1000)
+                  : 0;
+  return true;
+}
@@ -0,0 +1,39 @@
+#ifndef POWER_METERS_H
+#define POWER_METERS_H
+#include "PZEM.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <ADS1115_WE.h>
+#include <stdint.h>
+
+// Meters shared by the test engines: UPS input and output PZEM-004T on one
+// RS485 bus, and the ADS1115 used for battery voltage and waveforms.
+// PZEM reads take the bus lock, so two tasks never interleave frames. The
+// ADS1115 sits on I2C and has its own lock, so a waveform capture holding it
+// does not stall PZEM readers.
+class PowerMeters {
+public:
+  static void init();
+
+  static bool readInput(powerMeasure& values);
+  static bool readOutput(powerMeasure& values);
+  // Single-shot read of ADS1115 channel 0 scaled by the battery divider
+  static bool readBattery_mV(uint32_t dividerRatio_x1000, uint32_t& mV);
+
+  static ADS1115_WE& adc() { return _adc; }
+  static bool adcReady() { return _adcReady; }
+  static bool lockBus(TickType_t timeout = portMAX_DELAY);
+  static void unlockBus();
+  static bool lockAdc(TickType_t timeout = portMAX_DELAY);
+  static void unlockAdc();
+
+private:
+  static PZEM _input;
+  static PZEM _output;
+  static ADS1115_WE _adc;
+  static SemaphoreHandle_t _busLock;
+  static SemaphoreHandle_t _adcLock;
+  static bool _adcReady;
+};
+
+#endif  // POWER_METERS_H
@@ -0,0 +1,72 @@
+#ifndef EDGE_EVENT_QUEUE_H
+#define EDGE_EVENT_QUEUE_H
+#include <atomic>
+#include <esp_attr.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Not FALLING/RISING: Arduino defines those as interrupt mode macros
+enum class EdgeType : uint8_t { FALLING_EDGE = 0, RISING_EDGE = 1 };
+
+struct EdgeEvent {
+  int64_t timestamp_us;  // esp_timer time taken inside the ISR
+  uint8_t pin;
+  EdgeType edge;
+};
+
+// Single-producer/single-consumer ring. The producer side is the GPIO ISR
+// service, which dispatches keyISR1/keyISR2 one after another on the core
+// that installed it, so both handlers count as one producer. The consumer is
+// the edge event task. N must be a power of two.
+template <typename T, size_t N>
+class SPSCRing {
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "N must be a power of two");
+
+public:
+  SPSCRing() : _head(0), _tail(0), _dropped(0) {}
+
+  // Producer side, safe to call from an IRAM ISR
+  IRAM_ATTR bool push(const T& item) {
+    uint32_t head = _head.load(std::memory_order_relaxed);
+    if (head - _tail.load(std::memory_order_acquire) >= N) {
+      _dropped.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    _buffer[head & (N - 1)] = item;
+    _head.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side
+  bool pop(T& item) {
+    uint32_t tail = _tail.load(std::memory_order_relaxed);
+    if (tail == _head.load(std::memory_order_acquire)) {
+      return false;
+    }
+    item = _buffer[tail & (N - 1)];
+    _tail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  size_t size() const {
+    return _head.load(std::memory_order_acquire)
+           - _tail.load(std::memory_order_acquire);
+  }
+  bool empty() const { return size() == 0; }
+  uint32_t dropped() const { return _dropped.load(std::memory_order_relaxed); }
+  static constexpr size_t capacity() { return N; }
+
+private:
+  T _buffer[N];
+  std::atomic<uint32_t> _head;
+  std::atomic<uint32_t> _tail;
+  std::atomic<uint32_t> _dropped;
+
+  SPSCRing(const SPSCRing&) = delete;
+  SPSCRing& operator=(const SPSCRing&) = delete;
+};
+
+// 64 slots absorb a full relay-chatter burst between two consumer wake-ups
+using EdgeEventQueue = SPSCRing<EdgeEvent, 64>;
+
+#endif  // EDGE_EVENT_QUEUE_H
@@ -0,0 +1,86 @@
+#include "EdgeTrace.h"
+
+namespace {
+
+constexpr size_t MAX_TRANSITIONS = 16;
+
+struct Transition {
+  int64_t first_us;
+  EdgeType level;
+};
+
+struct PinTransitions {
+  Transition items[MAX_TRANSITIONS];
+  uint8_t count = 0;
+  uint16_t edges = 0;
+  int64_t last_us = 0;
+
+  // Groups edges closer than debounce_us into one transition
+  void add(const EdgeEvent& event, int64_t debounce_us) {
+    edges++;
+    bool newGroup = count == 0 || event.timestamp_us - last_us > debounce_us;
+    last_us = event.timestamp_us;
+    if (newGroup) {
+      if (count == MAX_TRANSITIONS) {
+        return;
+      }
+      items[count].first_us = event.timestamp_us;
+      count++;
+    }
+    items[count - 1].level = event.edge;
+  }
+};
+
+}  // namespace
+
+EdgeTraceAnalysis analyzeEdgeTrace(const EdgeEvent* events, size_t count,
+                                   uint8_t mainsPin, uint8_t upsPin,
+                                   int64_t debounce_us) {
+  EdgeTraceAnalysis result;
+  PinTransitions mains;
+  PinTransitions ups;
+
+  for (size_t i = 0; i < count; ++i) {
+    if (events[i].pin == mainsPin) {
+      mains.add(events[i], debounce_us);
+    } else if (events[i].pin == upsPin) {
+      ups.add(events[i], debounce_us);
+    }
+  }
+  result.mainsEdges = mains.edges;
+  result.upsEdges = ups.edges;
+  result.mainsTransitions = mains.count;
+  result.upsTransitions = ups.count;
+
+  for (uint8_t i = 0; i < mains.count; ++i) {
+    if (mains.items[i].level == EdgeType::FALLING_EDGE) {
+      result.mainsLoss_us = mains.items[i].first_us;
+      break;
+    }
+  }
+  if (result.mainsLoss_us == 0) {
+    return result;
+  }
+
+  // Only UPS transitions after the mains loss belong to the transfer
+  for (uint8_t i = 0; i < ups.count; ++i) {
+    const Transition& t = ups.items[i];
+    if (t.first_us < result.mainsLoss_us) {
+      continue;
+    }
+    if (t.level == EdgeType::RISING_EDGE) {
+      if (result.upsGain_us == 0) {
+        result.upsGain_us = t.first_us;
+      }
+    } else if (result.upsGain_us != 0) {
+      result.doubleTransfer = true;
+    }
+  }
+
+  if (result.upsGain_us > result.mainsLoss_us) {
+    result.switchtime_us
+        = static_cast<unsigned long>(result.upsGain_us - result.mainsLoss_us);
+    result.valid = !result.doubleTransfer;
+  }
+  return result;
+}
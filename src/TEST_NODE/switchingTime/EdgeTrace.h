@@ -0,0 +1,60 @@
+#ifndef EDGE_TRACE_H
+#define EDGE_TRACE_H
+#include "EdgeEventQueue.h"
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+// Preallocated record of every raw edge seen during one SwitchTest attempt.
+// Filled by the edge consumer task only, never by the ISR; armed by the test
+// task and read by the test and Modbus tasks. An event is written before
+// count moves past it, so readers only look below size().
+struct EdgeTrace {
+  static constexpr size_t MAX_EVENTS = 256;
+
+  EdgeEvent events[MAX_EVENTS];
+  std::atomic<uint16_t> count{0};
+  std::atomic<uint16_t> overflow{0};  // Edges that did not fit
+  std::atomic<bool> armed{false};
+
+  void arm() {
+    count.store(0, std::memory_order_relaxed);
+    overflow.store(0, std::memory_order_relaxed);
+    armed.store(true, std::memory_order_release);
+  }
+  void disarm() { armed.store(false, std::memory_order_release); }
+  void record(const EdgeEvent& event) {
+    if (!armed.load(std::memory_order_acquire)) {
+      return;
+    }
+    const uint16_t index = count.load(std::memory_order_relaxed);
+    if (index < MAX_EVENTS) {
+      events[index] = event;
+      count.store(index + 1, std::memory_order_release);
+    } else {
+      overflow.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+  uint16_t size() const { return count.load(std::memory_order_acquire); }
+};
+
+struct EdgeTraceAnalysis {
+  int64_t mainsLoss_us = 0;      // First edge of the settled mains-loss group
+  int64_t upsGain_us = 0;        // First edge of the settled UPS-gain group
+  unsigned long switchtime_us = 0;
+  uint16_t mainsEdges = 0;       // Raw edges, bounce included
+  uint16_t upsEdges = 0;
+  uint8_t mainsTransitions = 0;  // Debounced transitions
+  uint8_t upsTransitions = 0;
+  bool doubleTransfer = false;   // UPS output dropped again after gaining
+  bool valid = false;
+};
+
+// Pure debounce and switch-time extraction over a recorded trace. Edges on a
+// pin that follow each other within debounce_us form one transition whose
+// time is its first edge and whose level is its last edge.
+EdgeTraceAnalysis analyzeEdgeTrace(const EdgeEvent* events, size_t count,
+                                   uint8_t mainsPin, uint8_t upsPin,
+                                   int64_t debounce_us);
+
+#endif  // EDGE_TRACE_H
@@ -19,6 +19,20 @@
 #define LOAD_FULL_ON_PIN 14
 #define TEST_END_INT_PIN 12
 #define LOAD_PWM_PIN 13
+// Rising edge at each positive-going mains zero crossing, from an isolated
+// detector; 36 is input only and has no pull resistors
+#define ZERO_CROSS_PIN 36
+
+// Metering: PZEM-004T meters share one RS485 bus on Serial1, the ADS1115
+// sits on its own I2C pins (22 is taken by SENSE_UPS_POWER_PIN)
+#define PZEM_RX_PIN 35
+#define PZEM_TX_PIN 4
+#define PZEM_INPUT_ADDR 0x01
+#define PZEM_OUTPUT_ADDR 0x02
+#define ADS_SDA_PIN 21
+#define ADS_SCL_PIN 15
+#define ADS_ALERT_RDY_PIN 34
+#define ADS_I2C_ADDR 0x48
 
 const uint16_t maxVARating = 4000;
 
@@ -1,11 +1,76 @@
 #ifndef HARDWARE_SETUP_H
 #define HARDWARE_SETUP_H
 #include "HardwareConfig.h"
+#include <Arduino.h>
+#include <esp_attr.h>
+#include <esp_timer.h>
+
+#ifdef NODE_HOST_SIM
+// Host builds link these against a stand-in layer (virtual clock, virtual
+// GPIO, UPS model) instead of the ESP32 peripherals, see lib/NodeHostSim
+#include "NodeSim.h"
+#else
+#include <soc/gpio_reg.h>
+#endif
 
 namespace NodeTask {
 
-class IO_SETUP {}
+// Single access point for the clock and the test-node pins used on the
+// measurement path. Everything is inline and statically dispatched, so the
+// firmware pays nothing for the seam and a host build only swaps the bodies.
+class IO_SETUP {
+public:
+#ifdef NODE_HOST_SIM
+  static int64_t now_us() { return NodeSim::now_us(); }
+  static uint8_t readPinFromISR(uint8_t pin) { return NodeSim::readPin(pin); }
+  static uint8_t readPin(uint8_t pin) { return NodeSim::readPin(pin); }
+  static void writePin(uint8_t pin, uint8_t level) {
+    NodeSim::writePin(pin, level);
+  }
+  static void writeMask(uint32_t setMask, uint32_t clearMask) {
+    for (uint8_t pin = 0; pin < 32; ++pin) {
+      if (setMask & (1UL << pin)) {
+        NodeSim::writePin(pin, 1);
+      } else if (clearMask & (1UL << pin)) {
+        NodeSim::writePin(pin, 0);
+      }
+    }
+  }
+  static uint32_t readInputs() {
+    uint32_t levels = 0;
+    for (uint8_t pin = 0; pin < 32; ++pin) {
+      levels |= static_cast<uint32_t>(NodeSim::readPin(pin) & 0x1) << pin;
+    }
+    return levels;
+  }
+  static uint32_t cycleCount() {
+    return static_cast<uint32_t>(NodeSim::now_us());
+  }
+  static uint32_t cyclesPerUs() { return 1; }
+#else
+  static inline int64_t IRAM_ATTR now_us() { return esp_timer_get_time(); }
+  // Direct register read, safe inside an IRAM ISR (pins 0..31 only)
+  static inline uint8_t IRAM_ATTR readPinFromISR(uint8_t pin) {
+    return (REG_READ(GPIO_IN_REG) >> pin) & 0x1;
+  }
+  static uint8_t readPin(uint8_t pin) { return digitalRead(pin); }
+  static void writePin(uint8_t pin, uint8_t level) {
+    digitalWrite(pin, level);
+  }
+  // One W1TS and one W1TC store, every pin in a mask changes on the same
+  // APB write (pins 0..31 only)
+  static inline void IRAM_ATTR writeMask(uint32_t setMask, uint32_t clearMask) {
+    REG_WRITE(GPIO_OUT_W1TS_REG, setMask);
+    REG_WRITE(GPIO_OUT_W1TC_REG, clearMask);
+  }
+  static inline uint32_t IRAM_ATTR readInputs() {
+    return REG_READ(GPIO_IN_REG);
+  }
+  static inline uint32_t IRAM_ATTR cycleCount() { return ESP.getCycleCount(); }
+  static uint32_t cyclesPerUs() { return getCpuFrequencyMhz(); }
+#endif
+};
 
 }  // namespace NodeTask
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,114 @@
+#include "PhaseTrigger.h"
+#include "HardwareConfig.h"
+#include "HardwareSetup.h"
+#include "driver/gpio.h"
+
+using NodeTask::IO_SETUP;
+
+esp_timer_handle_t PhaseTrigger::_timer = NULL;
+portMUX_TYPE PhaseTrigger::_lock = portMUX_INITIALIZER_UNLOCKED;
+volatile int64_t PhaseTrigger::_lastCrossing_us = 0;
+volatile uint32_t PhaseTrigger::_period_us = 0;
+int64_t PhaseTrigger::_target_us = 0;
+volatile int64_t PhaseTrigger::_fired_us = 0;
+volatile uint16_t PhaseTrigger::_firedPhase_x10 = 0;
+volatile bool PhaseTrigger::_armed = false;
+bool PhaseTrigger::_begun = false;
+
+bool PhaseTrigger::begin() {
+  if (_begun) {
+    return true;
+  }
+  esp_timer_create_args_t args = {};
+  args.callback = &PhaseTrigger::onTimer;
+  args.name = "phaseTrigger";
+  if (esp_timer_create(&args, &_timer) != ESP_OK) {
+    return false;
+  }
+  // Input-only pin fed by the isolated zero-crossing detector
+  gpio_num_t pin = static_cast<gpio_num_t>(ZERO_CROSS_PIN);
+  gpio_set_direction(pin, GPIO_MODE_INPUT);
+  gpio_set_intr_type(pin, GPIO_INTR_POSEDGE);
+  gpio_install_isr_service(0);  // Already installed is not an error here
+  gpio_isr_handler_add(pin, onCrossing, NULL);
+  _begun = true;
+  return true;
+}
+
+// Period is averaged over eight crossings so one late edge barely moves the
+// prediction; a gap longer than MAX_PERIOD_US starts the average again
+void IRAM_ATTR PhaseTrigger::onCrossing(void* arg) {
+  int64_t now = IO_SETUP::now_us();
+  portENTER_CRITICAL_ISR(&_lock);
+  int64_t delta = now - _lastCrossing_us;
+  if (delta >= MIN_PERIOD_US) {
+    if (delta > MAX_PERIOD_US) {
+      _period_us = 0;
+    } else if (_period_us == 0) {
+      _period_us = static_cast<uint32_t>(delta);
+    } else {
+      _period_us = (7 * _period_us + static_cast<uint32_t>(delta)) / 8;
+    }
+    _lastCrossing_us = now;
+  }
+  portEXIT_CRITICAL_ISR(&_lock);
+}
+
+bool PhaseTrigger::ready() {
+  portENTER_CRITICAL(&_lock);
+  uint32_t period = _period_us;
+  int64_t last = _lastCrossing_us;
+  portEXIT_CRITICAL(&_lock);
+  return _begun && period != 0
+         && IO_SETUP::now_us() - last < 2 * static_cast<int64_t>(period);
+}
+
+bool PhaseTrigger::schedule(uint16_t phase_deg) {
+  cancel();
+  _fired_us = 0;
+  if (!ready()) {
+    return false;
+  }
+  portENTER_CRITICAL(&_lock);
+  const int64_t period = _period_us;
+  int64_t target = _lastCrossing_us + period * (phase_deg % 360) / 360;
+  portEXIT_CRITICAL(&_lock);
+
+  const int64_t now = IO_SETUP::now_us();
+  while (target < now + LEAD_US) {
+    target += period;
+  }
+  _target_us = target;
+  _armed = true;
+  esp_timer_start_once(_timer, target - now - SPIN_US);
+  return true;
+}
+
+void PhaseTrigger::cancel() {
+  if (_timer != NULL) {
+    esp_timer_stop(_timer);
+  }
+  portENTER_CRITICAL(&_lock);
+  _armed = false;
+  portEXIT_CRITICAL(&_lock);
+}
+
+// Runs in the esp_timer task; the check and the pin write share the lock
+// with cancel() so a cancelled cut can never land after a restore
+void PhaseTrigger::onTimer(void* arg) {
+  while (IO_SETUP::now_us() < _target_us) {
+  }
+  portENTER_CRITICAL(&_lock);
+  if (_armed) {
+    IO_SETUP::writePin(UPS_POWER_CUT_PIN, HIGH);
+    int64_t now = IO_SETUP::now_us();
+    uint32_t period = _period_us;
+    _fired_us = now;
+    _firedPhase_x10
+        = period ? static_cast<uint16_t>((now - _lastCrossing_us) % period
+                                         * 3600 / period)
+                 : 0;
+    _armed = false;
+  }
+  portEXIT_CRITICAL(&_lock);
+}
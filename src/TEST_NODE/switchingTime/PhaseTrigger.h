@@ -0,0 +1,50 @@
+#ifndef PHASE_TRIGGER_H
+#define PHASE_TRIGGER_H
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include <stdint.h>
+
+// Schedules the power cut at a fixed phase of the mains cycle. The rising
+// zero crossings on ZERO_CROSS_PIN give the phase reference and a smoothed
+// period; a one-shot esp_timer wakes SPIN_US early and spins onto the
+// target, so task dispatch latency does not move the cut.
+class PhaseTrigger {
+public:
+  // Accepts 40..70 Hz mains; crossings closer than MIN_PERIOD_US are bounce
+  static constexpr uint32_t MIN_PERIOD_US = 14285;
+  static constexpr uint32_t MAX_PERIOD_US = 25000;
+  // Earliest cut after schedule(), and how early the timer fires to spin
+  static constexpr uint32_t LEAD_US = 1000;
+  static constexpr uint32_t SPIN_US = 300;
+
+  static bool begin();
+  // A crossing within the last two periods and a measured period
+  static bool ready();
+  static uint32_t period_us() { return _period_us; }
+
+  // Cuts at phase_deg after the next usable rising crossing. False when
+  // there is no live mains reference; the caller then cuts directly.
+  static bool schedule(uint16_t phase_deg);
+  // Drops a pending cut; after it returns the timer cannot fire the cut
+  static void cancel();
+  static bool fired() { return _fired_us != 0; }
+  static int64_t firedAt_us() { return _fired_us; }
+  // Phase the cut actually landed at, in 0.1 degrees
+  static uint16_t firedPhase_x10() { return _firedPhase_x10; }
+
+private:
+  static void onCrossing(void* arg);
+  static void onTimer(void* arg);
+
+  static esp_timer_handle_t _timer;
+  static portMUX_TYPE _lock;
+  static volatile int64_t _lastCrossing_us;
+  static volatile uint32_t _period_us;
+  static int64_t _target_us;
+  static volatile int64_t _fired_us;
+  static volatile uint16_t _firedPhase_x10;
+  static volatile bool _armed;
+  static bool _begun;
+};
+
+#endif  // PHASE_TRIGGER_H
@@ -0,0 +1,73 @@
+#ifndef SWITCH_STATS_H
+#define SWITCH_STATS_H
+#include <math.h>
+#include <stdint.h>
+
+// Constant-memory statistics over repeated switch-time shots: Welford
+// mean/variance, min/max and a fixed-bin histogram for percentiles.
+struct SwitchTimeStats {
+  static constexpr uint16_t NUM_BINS = 200;
+  static constexpr uint32_t BIN_WIDTH_US = 100;  // Covers 0..20 ms
+
+  uint32_t count = 0;
+  double mean_us = 0.0;
+  double m2 = 0.0;
+  uint32_t min_us = UINT32_MAX;
+  uint32_t max_us = 0;
+  uint16_t bins[NUM_BINS] = {};
+  uint16_t overflow = 0;  // Samples beyond the last bin
+
+  void reset() { *this = SwitchTimeStats(); }
+
+  void add(uint32_t sample_us) {
+    count++;
+    double delta = sample_us - mean_us;
+    mean_us += delta / count;
+    m2 += delta * (sample_us - mean_us);
+    if (sample_us < min_us) {
+      min_us = sample_us;
+    }
+    if (sample_us > max_us) {
+      max_us = sample_us;
+    }
+    uint32_t bin = sample_us / BIN_WIDTH_US;
+    if (bin < NUM_BINS) {
+      if (bins[bin] < UINT16_MAX) {
+        bins[bin]++;
+      }
+    } else {
+      overflow++;
+    }
+  }
+
+  double variance() const { return count > 1 ? m2 / (count - 1) : 0.0; }
+  double stddev() const { return sqrt(variance()); }
+
+  // Percentile (0..100) interpolated inside the histogram bin, clamped to
+  // the observed min/max
+  uint32_t percentile(uint8_t p) const {
+    if (count == 0) {
+      return 0;
+    }
+    double rank = (static_cast<double>(p) / 100.0) * count;
+    uint32_t seen = 0;
+    for (uint16_t i = 0; i < NUM_BINS; ++i) {
+      if (bins[i] == 0) {
+        continue;
+      }
+      if (seen + bins[i] >= rank) {
+        double fraction = (rank - seen) / bins[i];
+        uint32_t value = static_cast<uint32_t>(
+            (i + fraction) * static_cast<double>(BIN_WIDTH_US));
+        if (value < min_us) {
+          value = min_us;
+        }
+        return value > max_us ? max_us : value;
+      }
+      seen += bins[i];
+    }
+    return max_us;  // Rank falls in the overflow bin
+  }
+};
+
+#endif  // SWITCH_STATS_H
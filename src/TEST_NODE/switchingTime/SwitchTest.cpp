@@ -1,344 +1,222 @@
 #include "SwitchTest.h"
-#include "driver/gpio.h"
+#include "Checkpoint.h"
+#include "NodeLog.h"
+#include "HardwareSetup.h"
 
-extern void IRAM_ATTR keyISR1(void* pvParameters);
-extern void IRAM_ATTR keyISR2(void* pvParameters);
-extern volatile bool mains_triggered;
-extern volatile bool ups_triggered;
-extern TaskHandle_t ISR_MAINS_POWER_LOSS;
-extern TaskHandle_t ISR_UPS_POWER_GAIN;
+extern StateMachine* stateMachine;
 
 using namespace Node_Core;
-// Initialize static members
-SwitchTest* SwitchTest::instance = nullptr;
+using NodeTask::IO_SETUP;
 
 // Private Constructor
 SwitchTest::SwitchTest()
-    : _data(),
-      _config(),
-      _tasksetting(),
-      _taskparams(),
-      _testRunning(false),
-      _time_capture_running(false),
-      _time_capture_ok(false),
-      _currentTest(0),
-      _testDuration(_config.testduration_ms) {}
-
-SwitchTest::~SwitchTest() {
-  // Cleanup actions (if needed)
-  if (instance == this) {
-
-    if (switchTestTaskHandle != NULL) {
-      vTaskDelete(switchTestTaskHandle);
-      switchTestTaskHandle = NULL;
-    }
-    // Delete the ISR tasks
-    if (ISR_MAINS_POWER_LOSS != NULL) {
-      vTaskDelete(ISR_MAINS_POWER_LOSS);
-      ISR_MAINS_POWER_LOSS = NULL;
-    }
-    if (ISR_UPS_POWER_GAIN != NULL) {
-      vTaskDelete(ISR_UPS_POWER_GAIN);
-      ISR_UPS_POWER_GAIN = NULL;
-    }
-
-    // Clear the singleton instance
-    instance = nullptr;
-  }
-}
-
-// Singleton accessor
-SwitchTest* SwitchTest::getInstance() {
-  if (instance == nullptr) {
-    instance = new SwitchTest();
-  }
-  return instance;
-}
-
-void SwitchTest::deleteInstance() {
-  if (instance != nullptr) {
-    delete instance;
-    instance = nullptr;
-  }
+    : _config(),
+      _pending(),
+      _settingsLock(portMUX_INITIALIZER_UNLOCKED),
+      _captureStart_us(0),
+      _captureEnd_us(0),
+      _lastMainsEdge_us(0),
+      _lastUPSEdge_us(0),
+      _cutPhase_deg(_config.cutPhase_deg),
+      _phaseSweepRequested(false),
+      _shot(&_data.switchTest[0]),
+      _phaseShot() {
+  _testDuration = _config.testduration_ms;
 }
 
-void SwitchTest::init() {
-
-  if (_initialized) {
-    return;  // Already initialized, do nothing
-  }
-
-  // Perform initialization
+void SwitchTest::resetData() {
   for (auto& test : _data.switchTest) {
     test.testNo = 0;
     test.testTimestamp = 0;
     test.valid_data = false;
-    test.switchtime = 0;
-    test.starttime = 0;
-    test.endtime = 0;
+    test.switchtime_us = 0;
+    test.starttime_us = 0;
+    test.endtime_us = 0;
     test.load_percentage = LoadPercentage::LOAD_0P;
   };
-  setupPins();
-  createMainTasks();
-  createISRTasks();
-
-  _initialized = true;  // Mark as initialized
-}
-void SwitchTest::createMainTasks() {
-
-  xTaskCreatePinnedToCore(
-      instance->switchTestTask, "SwitchTestTask",
-      instance->_tasksetting.mainTest_taskStack, &_taskparams,
-      instance->_tasksetting.mainTest_taskIdlePriority, &switchTestTaskHandle,
-      instance->_tasksetting.mainTest_taskCore);
-}
-
-// void SwitchTest::createISRTasks() {
-//   xTaskCreatePinnedToCore(instance->onMainsPowerLossTask, "MainslossTask",
-//                           instance->_tasksetting.mainsISR_taskStack, NULL,
-//                           instance->_tasksetting.mainsISR_taskIdlePriority,
-//                           &ISR_MAINS_POWER_LOSS,
-//                           instance->_tasksetting.mainsISR_taskCore);
-//   xTaskCreatePinnedToCore(instance->onUPSPowerGainTask, "UPSgainTask",
-//                           instance->_tasksetting.upsISR_taskStack, NULL,
-//                           instance->_tasksetting.upsISR_taskIdlePriority,
-//                           &ISR_UPS_POWER_GAIN,
-//                           instance->_tasksetting.upsISR_taskCore);
-// }
-
-void SwitchTest::createISRTasks() {
-  xTaskCreatePinnedToCore(instance->onMainsPowerLossTask, "MainslossTask",
-                          12000, NULL, 1, &ISR_MAINS_POWER_LOSS,
-                          ARDUINO_RUNNING_CORE);
-  xTaskCreatePinnedToCore(instance->onUPSPowerGainTask, "UPSgainTask", 12000,
-                          NULL, 1, &ISR_UPS_POWER_GAIN, ARDUINO_RUNNING_CORE);
+  for (auto& stats : _data.switchStats) {
+    stats.reset();
+  }
+  for (auto& result : _data.phaseSweep) {
+    result.phase_deg = 0;
+    result.firedPhase_x10 = 0;
+    result.switchtime_us = 0;
+  }
+  _data.phaseSteps = 0;
+  _data.worstPhaseStep = 0;
+  // Levels finished before a reset, see Checkpoint
+  Checkpoint::restoreSwitchResults(_data.switchTest);
 }
 
-// Function for SwitchTest task
-void SwitchTest::switchTestTask(void* pvParameters) {
+// Main SwitchTest task, runs one four-level sweep per startTest(), or
+// statShots transfers at one level when statShots is above one
+void SwitchTest::MainTestTask(void* pvParameters) {
   if (instance) {
     while (true) {
+      ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
       SetupTaskParams* params = (SetupTaskParams*)pvParameters;
-      Serial.print("Switchtask VA rating is: ");
-      Serial.println(params->task_TestVARating);
-      Serial.print("Switchtask duration is: ");
-      Serial.println(params->task_testDuration_ms);
-
-      instance->run(params->task_TestVARating, params->task_testDuration_ms);
-      Serial.print("Switch Stack High Water Mark: ");
-      Serial.println(uxTaskGetStackHighWaterMark(NULL));  // Monitor stack usage
-      vTaskDelay(pdMS_TO_TICKS(100));  // Delay to prevent tight loop
+      NODE_LOGI(SWEEP_START, params->task_TestVARating);
+      instance->applySettings();
+
+      if (instance->_phaseSweepRequested) {
+        instance->_phaseSweepRequested = false;
+        instance->runPhaseSweep(params->task_TestVARating,
+                                params->task_testDuration_ms);
+      } else if (instance->_config.statShots > 1) {
+        instance->runStatistical(params->task_TestVARating,
+                                 instance->_config.statShots,
+                                 params->task_testDuration_ms);
+      } else if (stateMachine) {
+        instance->runSweep(*stateMachine, params->task_TestVARating,
+                           params->task_testDuration_ms);
+      }
+      NODE_LOGD(TASK_STACK_HWM, uxTaskGetStackHighWaterMark(NULL));
     }
   }
   vTaskDelete(NULL);
 }
 
-// ISR for mains power loss
-void SwitchTest::onMainsPowerLossTask(void* pvParameters) {
-  while (true) {
-
-    if (mains_triggered) {
-      if (instance) {
-        instance->_time_capture_running = true;
-        instance->startTimeCapture();
-        Serial.print("\033[31m");  // Start red color
-        Serial.print("mains Powerloss triggered...");
-        Serial.print("\033[0m");  // Reset color
-        mains_triggered = false;
-      }
-      Serial.print("mains task High Water Mark: ");
-      Serial.println(uxTaskGetStackHighWaterMark(NULL));  // Monitor stack usage
+void SwitchTest::onEdgeEvent(const EdgeEvent& event) {
+  const int64_t debounce_us = _config.debounceDelay_us;
+  _trace.record(event);
 
-      vTaskDelay(pdMS_TO_TICKS(100));  // Task delay
-      vTaskSuspend(NULL);
+  // Interrupts fire on both edges so the trace sees bounce; live capture only
+  // uses mains falling and UPS rising edges
+  if (event.pin == SENSE_MAINS_POWER_PIN
+      && event.edge == EdgeType::FALLING_EDGE) {
+    if (event.timestamp_us - _lastMainsEdge_us <= debounce_us) {
+      return;
     }
+    _lastMainsEdge_us = event.timestamp_us;
+    _dataCaptureRunning = true;
+    startTimeCapture(event.timestamp_us);
+    NODE_LOGD(SWITCH_MAINS_LOSS, static_cast<uint32_t>(event.timestamp_us));
+  } else if (event.pin == SENSE_UPS_POWER_PIN
+             && event.edge == EdgeType::RISING_EDGE) {
+    if (event.timestamp_us - _lastUPSEdge_us <= debounce_us) {
+      return;
+    }
+    _lastUPSEdge_us = event.timestamp_us;
+    stopTimeCapture(event.timestamp_us);
+    NODE_LOGD(SWITCH_UPS_GAIN, static_cast<uint32_t>(event.timestamp_us));
   }
-  vTaskDelete(NULL);
 }
 
-// ISR for UPS power gain
-void SwitchTest::onUPSPowerGainTask(void* pvParameters) {
-
-  while (true) {
-    if (ups_triggered) {
+const EdgeTrace& SwitchTest::edgeTrace() const { return _trace; }
 
-      if (instance) {
-        instance->stopTimeCapture();
-        Serial.print("\033[31m");  // Start red color
-        Serial.print("UPS Powerloss triggered...");
-        Serial.print("\033[0m");  // Reset color
-        ups_triggered = false;
-      }
-      Serial.print("UPS High Water Mark: ");
-      Serial.println(uxTaskGetStackHighWaterMark(NULL));  // Monitor stack usage
-
-      vTaskDelay(pdMS_TO_TICKS(100));  // Task delay
-      vTaskSuspend(NULL);
-    }
-  }
-  vTaskDelete(NULL);
+void SwitchTest::setRecordEdgeTrace(bool enabled) {
+  portENTER_CRITICAL(&_settingsLock);
+  _pending.recordEdgeTrace = enabled;
+  portEXIT_CRITICAL(&_settingsLock);
 }
 
-SwithTestData& SwitchTest::data() { return _data; }
-// Pin setup
-void SwitchTest::setupPins() {
-
-  pinMode(SENSE_MAINS_POWER_PIN, INPUT_PULLDOWN);
-  pinMode(SENSE_UPS_POWER_PIN, INPUT_PULLDOWN);
-  pinMode(UPS_POWER_CUT_PIN, OUTPUT);  // Set power cut pin as output
-  pinMode(TEST_END_INT_PIN, OUTPUT);
-  pinMode(LOAD_PWM_PIN, OUTPUT);
-  pinMode(LOAD25P_ON_PIN, OUTPUT);
-  pinMode(LOAD50P_ON_PIN, OUTPUT);
-  pinMode(LOAD75P_ON_PIN, OUTPUT);
-  pinMode(LOAD_FULL_ON_PIN, OUTPUT);
-  pinMode(TEST_END_INT_PIN, OUTPUT);
-
-  ledcSetup(_config.pwmchannelNo, _config.pwm_frequecy,
-            _config.pwmResolusion_bits);
-  ledcWrite(_config.pwmchannelNo, 0);
-  ledcAttachPin(LOAD_PWM_PIN, 0);
-  configureInterrupts();
-  Serial.println("After configuring interrupts:");
-
-  pinMode(SENSE_MAINS_POWER_PIN, INPUT_PULLDOWN);
-  pinMode(SENSE_UPS_POWER_PIN, INPUT_PULLDOWN);
+void SwitchTest::setStatShots(uint16_t shots) {
+  portENTER_CRITICAL(&_settingsLock);
+  _pending.statShots = shots;
+  portEXIT_CRITICAL(&_settingsLock);
 }
 
-// Interrupt configuration
-void SwitchTest::configureInterrupts() {
-  Serial.println("configuring button");
-  gpio_num_t mainpowerPin = static_cast<gpio_num_t>(SENSE_MAINS_POWER_PIN);
-  gpio_set_intr_type(mainpowerPin, GPIO_INTR_NEGEDGE);
-
-  gpio_num_t upspowerPin = static_cast<gpio_num_t>(SENSE_UPS_POWER_PIN);
-  gpio_set_intr_type(upspowerPin, GPIO_INTR_POSEDGE);
-
-  gpio_install_isr_service(0);
-  gpio_isr_handler_add(mainpowerPin, keyISR1, NULL);
-  gpio_isr_handler_add(upspowerPin, keyISR2, NULL);
+void SwitchTest::setPhaseSync(bool enabled) {
+  portENTER_CRITICAL(&_settingsLock);
+  _pending.phaseSync = enabled;
+  portEXIT_CRITICAL(&_settingsLock);
+}
 
-  Serial.println("config complete");
+void SwitchTest::setCutPhase(uint16_t phase_deg) {
+  portENTER_CRITICAL(&_settingsLock);
+  _pending.cutPhase_deg = phase_deg % 360;
+  portEXIT_CRITICAL(&_settingsLock);
 }
 
-// Start the test
-void SwitchTest::startTimeCapture() {
-  if (_time_capture_running) {
-    _data.switchTest[_currentTest].starttime = millis();
-    _time_capture_ok = false;
-    Serial.println("time capture started...");
-    Serial.print("start time:");
-    Serial.println(_data.switchTest[_currentTest].starttime);
-  }
+void SwitchTest::setEdgeDrivesCapture(bool enabled) {
+  portENTER_CRITICAL(&_settingsLock);
+  _pending.edgeDrivesCapture = enabled;
+  portEXIT_CRITICAL(&_settingsLock);
+}
 
-  else {
-    Serial.println("Debounce...");
-  }
+void SwitchTest::applySettings() {
+  portENTER_CRITICAL(&_settingsLock);
+  _config = _pending;
+  portEXIT_CRITICAL(&_settingsLock);
+  _cutPhase_deg = _config.cutPhase_deg;
 }
 
-// Stop the test
-void SwitchTest::stopTimeCapture() {
-  if (_time_capture_running) {
-    _data.switchTest[_currentTest].endtime = millis();
-    Serial.println("time capture done...");
-    Serial.print("stop time:");
-    Serial.println(_data.switchTest[_currentTest].endtime);
-    Serial.print("switch time:");
-    Serial.println(_data.switchTest[_currentTest].endtime
-                   - _data.switchTest[_currentTest].starttime);
-    _time_capture_running = false;
-    _time_capture_ok = true;  // Set flag to process timing data
-
-    if (_time_capture_ok) {
-      Serial.println("time capture ok recorded");
+// With phaseSync the cut lands at _cutPhase_deg of the mains cycle, so the
+// switch-time spread is the UPS and not where in the cycle we happened to
+// cut. Without a zero-crossing reference it falls back to cutting at once.
+void SwitchTest::cutPower() {
+  if (_config.phaseSync) {
+    if (PhaseTrigger::schedule(_cutPhase_deg)) {
+      return;
     }
+    NODE_LOGW(PHASE_NO_ZERO_CROSS);
   }
+  simulatePowerCut();
 }
 
-void SwitchTest::settestDuration(unsigned long duration) {
-  _testDuration = duration;
+void SwitchTest::restorePower() {
+  PhaseTrigger::cancel();
+  simulatePowerRestore();
 }
-void SwitchTest::setLoad(uint16_t testVARating) {
-  uint16_t singlebankVA = maxVARating / 4;
-  uint16_t dualbankVA = (maxVARating / 4) * 2;
-  uint16_t triplebankVA = (maxVARating / 4) * 3;
-  uint16_t reqbankNumbers = 0;
-  uint16_t duty = 0;
-  uint16_t pwmValue = 0;
-  uint16_t adjustpwm = 0;
-
-  if (testVARating <= singlebankVA) {
-    reqbankNumbers = 1;
-    duty = (testVARating * 100) / singlebankVA;
-    pwmValue = map(testVARating, 0, singlebankVA, 0, 255);
-    adjustpwm = _config.adjust_pwm_25P;
-  }
-  if (testVARating > singlebankVA && testVARating <= dualbankVA) {
-    reqbankNumbers = 2;
-    duty = (testVARating * 100) / dualbankVA;
-    pwmValue = map(testVARating, 0, dualbankVA, 0, 255);
-    adjustpwm = _config.adjust_pwm_50P;
-  }
-  if (testVARating > dualbankVA && testVARating <= triplebankVA) {
-    reqbankNumbers = 3;
-    duty = (testVARating * 100) / triplebankVA;
-    pwmValue = map(testVARating, 0, triplebankVA, 0, 255);
-    adjustpwm = _config.adjust_pwm_75P;
+
+// Replaces the live capture result with the post-hoc trace analysis
+void SwitchTest::applyTraceAnalysis() {
+  EdgeTraceAnalysis result
+      = analyzeEdgeTrace(_trace.events, _trace.size(), SENSE_MAINS_POWER_PIN,
+                         SENSE_UPS_POWER_PIN, _config.traceBounce_us);
+  NODE_LOGI(SWITCH_TRACE_EDGES, result.mainsEdges, result.upsEdges);
+  if (result.doubleTransfer) {
+    NODE_LOGW(SWITCH_TRACE_DOUBLE);
   }
-  if (testVARating > triplebankVA && testVARating <= maxVARating) {
-    reqbankNumbers = 4;
-    duty = (testVARating * 100) / maxVARating;
-    pwmValue = map(testVARating, 0, maxVARating, 0, 255);
-    adjustpwm = _config.adjust_pwm_100P;
+  const uint16_t overflow = _trace.overflow.load();
+  if (overflow > 0) {
+    NODE_LOGW(SWITCH_TRACE_OVERFLOW, overflow);
   }
-  _config.pwmduty_set = pwmValue;
-  uint16_t set_pwmValue = pwmValue + adjustpwm;
-  analogWrite(LOAD_PWM_PIN, set_pwmValue);
-  LoadPercentage loadPercentage = static_cast<LoadPercentage>(duty);
-  _data.switchTest[_currentTest].load_percentage = loadPercentage;
 
-  selectLoadBank(reqbankNumbers);
+  _captureStart_us = result.mainsLoss_us;
+  _captureEnd_us = result.upsGain_us;
+  _dataCaptureOk = result.valid;
 }
-
-void SwitchTest::selectLoadBank(uint16_t bankNumbers) {
-  digitalWrite(LOAD25P_ON_PIN, bankNumbers >= 1 ? HIGH : LOW);
-  digitalWrite(LOAD50P_ON_PIN, bankNumbers >= 2 ? HIGH : LOW);
-  digitalWrite(LOAD75P_ON_PIN, bankNumbers >= 3 ? HIGH : LOW);
-  digitalWrite(LOAD_FULL_ON_PIN, bankNumbers >= 4 ? HIGH : LOW);
+// Start the test, edgeTime_us is the timestamp taken in keyISR1
+void SwitchTest::startTimeCapture(int64_t edgeTime_us) {
+  _captureStart_us = edgeTime_us;
+  _shot->starttime_us = static_cast<unsigned long>(edgeTime_us);
+  _dataCaptureOk = false;
+  NODE_LOGD(SWITCH_CAPTURE_START, _shot->starttime_us);
 }
 
-void SwitchTest::sendEndSignal() {
-  digitalWrite(TEST_END_INT_PIN, HIGH);
-  vTaskDelay(pdMS_TO_TICKS(10));
-  digitalWrite(TEST_END_INT_PIN, LOW);
-}
-
-void SwitchTest::simulatePowerCut() {
-  digitalWrite(UPS_POWER_CUT_PIN, HIGH);  // Simulate power cut
+// Stop the test, edgeTime_us is the timestamp taken in keyISR2
+void SwitchTest::stopTimeCapture(int64_t edgeTime_us) {
+  if (_dataCaptureRunning) {
+    _captureEnd_us = edgeTime_us;
+    _shot->endtime_us = static_cast<unsigned long>(edgeTime_us);
+    NODE_LOGD(SWITCH_CAPTURE_DONE, _shot->endtime_us,
+              switchTimeFromEdges_us(_captureStart_us, _captureEnd_us));
+    _dataCaptureRunning = false;
+    _dataCaptureOk = true;  // Set flag to process timing data
+    xEventGroupSetBits(_testEvents, CAPTURE_DONE_BIT);
+  }
 }
 
-void SwitchTest::simulatePowerRestore() {
-  digitalWrite(UPS_POWER_CUT_PIN, LOW);  // Simulate Mains Power In
-}
-bool SwitchTest::checkTimerange(unsigned long switchtime) {
-  if (switchtime >= _config.min_valid_switch_time_ms
-      && switchtime <= _config.max_valid_switch_time_ms) {
+bool SwitchTest::checkTimerange(unsigned long switchtime_us) {
+  if (switchtime_us >= _config.min_valid_switch_time_ms * 1000UL
+      && switchtime_us <= _config.max_valid_switch_time_ms * 1000UL) {
     return true;
   }
   return false;
 }
 
 bool SwitchTest::process_time_capture() {
-  unsigned long endtime = _data.switchTest[_currentTest].endtime;
-  unsigned long starttime = _data.switchTest[_currentTest].starttime;
-  unsigned long switchTime = endtime - starttime;
-
-  if (starttime > 0 && endtime > 0) {
-    if (checkTimerange(switchTime)) {
-      _data.switchTest[_currentTest].valid_data = true;
-      _data.switchTest[_currentTest].testNo = _currentTest + 1;
-      _data.switchTest[_currentTest].testTimestamp = millis();
-      _data.switchTest[_currentTest].switchtime = switchTime;
+  unsigned long switchTime_us
+      = switchTimeFromEdges_us(_captureStart_us, _captureEnd_us);
+
+  if (_captureStart_us > 0 && switchTime_us > 0) {
+    if (checkTimerange(switchTime_us)) {
+      _shot->valid_data = true;
+      _shot->testNo = _currentTest + 1;
+      _shot->testTimestamp
+          = static_cast<unsigned long>(IO_SETUP::now_us() / 1000);
+      _shot->switchtime_us = switchTime_us;
       return true;
     }
   }
@@ -346,80 +224,267 @@ bool SwitchTest::process_time_capture() {
 }
 
 TestResult SwitchTest::run(uint16_t testVARating, unsigned long testduration) {
-  uint8_t retries = 0;
-  setLoad(testVARating);                   // Set the load
-  unsigned long testStartTime = millis();  // Overall start time
-  bool valid_data = false;                 // Initially assume data is not valid
-  bool testInProgress = false;
-  unsigned long currentTestStartTime = 0;
-  uint8_t maximum_retest_number = _config.max_retest;
-  unsigned long testDurationWithRetest = 0;
-  if (testduration == _testDuration) {
-
-    testDurationWithRetest = maximum_retest_number * _testDuration;
-  } else {
-    _testDuration = testduration;
-    testDurationWithRetest = maximum_retest_number * _testDuration;
+  return runShot(_data.switchTest[_currentTest], testVARating, testduration);
+}
+
+TestResult SwitchTest::runShot(SwithTestData::TestData& shot,
+                               uint16_t testVARating,
+                               unsigned long testduration) {
+  _testDuration = testduration;
+  _shot = &shot;
+  shot.load_percentage = setLoad(testVARating);
+  claimEdgeEvents();
+
+  bool valid_data = false;
+  bool aborted = false;
+  const uint8_t maximum_retest_number = _config.max_retest;
+
+  for (uint8_t attempt = 0; attempt < maximum_retest_number; ++attempt) {
+    NODE_LOGI(SWITCH_ATTEMPT_START, attempt + 1);
+
+    _captureStart_us = 0;
+    _captureEnd_us = 0;
+    // Each attempt is a new transfer; the debounce only filters bounce
+    // within one, or back-to-back statistical shots would be swallowed
+    _lastMainsEdge_us = 0;
+    _lastUPSEdge_us = 0;
+    _dataCaptureOk = false;
+    xEventGroupClearBits(_testEvents, CAPTURE_DONE_BIT);
+    if (_config.recordEdgeTrace) {
+      _trace.arm();
+    }
+    cutPower();
+
+    // Wakes on the UPS edge, an abort, or the attempt deadline. ABORT_BIT
+    // stays set until the next TestRegistry::start() so callers up the
+    // stack see it too.
+    EventBits_t bits = xEventGroupWaitBits(
+        _testEvents, CAPTURE_DONE_BIT | ABORT_BIT, pdFALSE, pdFALSE,
+        pdMS_TO_TICKS(_testDuration));
+    xEventGroupClearBits(_testEvents, CAPTURE_DONE_BIT);
+
+    if ((bits & CAPTURE_DONE_BIT) && _config.recordEdgeTrace) {
+      // Keep recording for one debounce window to catch trailing bounce
+      vTaskDelay(pdMS_TO_TICKS(_config.debounceDelay_us / 1000));
+    }
+    restorePower();
+
+    if (bits & ABORT_BIT) {
+      NODE_LOGW(SWITCH_ABORTED);
+      _trace.disarm();
+      aborted = true;
+      break;
+    }
+
+    if (_config.recordEdgeTrace) {
+      _trace.disarm();
+      applyTraceAnalysis();
+    }
+
+    if (_dataCaptureOk && process_time_capture()) {
+      NODE_LOGI(SWITCH_TIME, shot.switchtime_us);
+      sendEndSignal();
+      valid_data = true;
+      break;
+    }
+
+    shot.valid_data = false;
+    _dataCaptureRunning = false;
+    NODE_LOGW(SWITCH_RETRY);
+
+    if (!waitMainsRestored(pdMS_TO_TICKS(_config.mainsRestoreTimeout_ms))) {
+      NODE_LOGW(SWITCH_MAINS_NOT_BACK);
+    }
   }
 
-  while (millis() - testStartTime < testDurationWithRetest) {
-    if (!testInProgress) {
-      Serial.print("Starting test attempt ");
-      Serial.println(retries + 1);
-      simulatePowerCut();
-      currentTestStartTime = millis();
-      testInProgress = true;
+  if (valid_data) {
+    // Leave the UPS back on mains before the caller moves to the next level
+    waitMainsRestored(pdMS_TO_TICKS(_config.mainsRestoreTimeout_ms));
+    NODE_LOGI(SWITCH_TEST_OK);
+    return TEST_SUCESSFUL;
+  }
+  if (!aborted) {
+    NODE_LOGE(SWITCH_TEST_FAILED);
+  }
+  return TEST_FAILED;
+}
+
+// Repeats the transfer at one load level and accumulates the distribution in
+// switchStats[_currentTest]. switchTest[_currentTest] keeps the last shot.
+TestResult SwitchTest::runStatistical(uint16_t testVARating, uint16_t shots,
+                                      unsigned long testduration) {
+  SwitchTimeStats& stats = _data.switchStats[_currentTest];
+  stats.reset();
+
+  for (uint16_t shot = 0; shot < shots; ++shot) {
+    if (run(testVARating, testduration) == TEST_SUCESSFUL) {
+      stats.add(_data.switchTest[_currentTest].switchtime_us);
+    } else if (abortRequested()) {
+      break;
     }
+  }
 
-    unsigned long elapsedTime = millis() - currentTestStartTime;
-    long remainingTime = _testDuration - elapsedTime;
-    Serial.print("test duration set is:");
-    Serial.println(_testDuration);
-
-    Serial.print("Remaining single test time: ");
-    Serial.println(remainingTime);
-
-    if (elapsedTime >= _testDuration) {
-      Serial.println("Ending switch test...");
-      simulatePowerRestore();
-      testInProgress = false;
-
-      vTaskDelay(pdMS_TO_TICKS(100));  // Small delay before processing
-
-      if (_time_capture_ok) {
-        Serial.println("Processing time capture...");
-
-        if (process_time_capture()) {
-          Serial.print("Switching Time: ");
-          Serial.print(_data.switchTest[_currentTest].switchtime);
-          Serial.println(" ms");
-          sendEndSignal();
-          valid_data = true;
-          break;  // Exit the loop as the test was successful
-        }
-
-      } else {
-        _data.switchTest[_currentTest].valid_data = false;
-        Serial.println("Invalid timing data, retrying...");
-        retries++;
-
-        if (retries >= maximum_retest_number) {
-          Serial.println("Max retries reached. Test failed.");
-          break;
-        }
+  NODE_LOGI(SWITCH_STATS, stats.count, static_cast<uint32_t>(stats.mean_us),
+            stats.percentile(99));
+
+  return stats.count == shots ? TEST_SUCESSFUL : TEST_FAILED;
+}
+
+// Repeats the transfer at one load level with the cut stepped through the
+// mains cycle; phaseSweep[] keeps one shot per phase and worstPhaseStep
+// points at the longest switch time. switchTest[] and _currentTest are left
+// as the last sweep had them.
+TestResult SwitchTest::runPhaseSweep(uint16_t testVARating,
+                                     unsigned long testduration) {
+  const uint16_t minStep = (360 + SwithTestData::MAX_PHASE_STEPS - 1)
+                           / SwithTestData::MAX_PHASE_STEPS;
+  const uint16_t step
+      = _config.phaseStep_deg > minStep ? _config.phaseStep_deg : minStep;
+  if (!PhaseTrigger::ready()) {
+    NODE_LOGE(PHASE_NO_ZERO_CROSS);
+    return TEST_FAILED;
+  }
+
+  const bool phaseSync = _config.phaseSync;
+  _config.phaseSync = true;
+  _data.phaseSteps = 0;
+  _data.worstPhaseStep = 0;
+  bool allValid = true;
+  for (uint16_t phase = 0; phase < 360; phase += step) {
+    SwithTestData::PhaseResult& result = _data.phaseSweep[_data.phaseSteps];
+    _data.phaseSteps++;
+    result.phase_deg = phase;
+    _cutPhase_deg = phase;
+
+    bool ok
+        = runShot(_phaseShot, testVARating, testduration) == TEST_SUCESSFUL;
+    result.firedPhase_x10
+        = PhaseTrigger::fired() ? PhaseTrigger::firedPhase_x10() : 0;
+    result.switchtime_us = ok ? _phaseShot.switchtime_us : 0;
+    if (!ok) {
+      allValid = false;
+      if (abortRequested()) {
+        break;
+      }
+      continue;
+    }
+    NODE_LOGI(PHASE_SHOT, phase, result.switchtime_us);
+    if (result.switchtime_us
+        > _data.phaseSweep[_data.worstPhaseStep].switchtime_us) {
+      _data.worstPhaseStep = _data.phaseSteps - 1;
+    }
+  }
+  _cutPhase_deg = _config.cutPhase_deg;
+  _config.phaseSync = phaseSync;
+
+  const SwithTestData::PhaseResult& worst
+      = _data.phaseSweep[_data.worstPhaseStep];
+  NODE_LOGI(PHASE_SWEEP_WORST, worst.phase_deg, worst.switchtime_us);
+  return allValid ? TEST_SUCESSFUL : TEST_FAILED;
+}
+
+namespace {
+
+struct SweepLevel {
+  State start;
+  Event loadEvent;
+  LoadPercentage load;
+};
+
+const SweepLevel sweepLevels[] = {
+    {State::SWITCHING_TEST_25P_START, Event::LOAD_ON_OFF_25P, LOAD_25P},
+    {State::SWITCHING_TEST_50P_START, Event::LOAD_ON_OFF_50P, LOAD_50P},
+    {State::SWITCHING_TEST_75P_START, Event::LOAD_ON_OFF_75P, LOAD_75P},
+    {State::SWITCHING_TEST_FULLLOAD_START, Event::FULL_LOAD_ON_OFF,
+     LOAD_100P},
+};
+
+}  // namespace
+
+// Walks the 25/50/75/100 % chain of the state machine, filling
+// switchTest[0..3]. A failed level goes through SWITCHING_TEST_CHECK, which
+// either restarts the sweep or ends it in SWITCHING_TEST_FAILED. A sweep
+// resumed from a checkpoint in a level start state carries on from there.
+TestResult SwitchTest::runSweep(StateMachine& stateMachine,
+                                uint16_t fullLoadVA,
+                                unsigned long testduration) {
+  if (stateMachine.getCurrentState() == State::AUTO_MODE) {
+    stateMachine.handleEvent(Event::LOAD_BANK_ONLINE);
+  }
+
+  uint8_t firstLevel = 0;
+  while (firstLevel < 4
+         && sweepLevels[firstLevel].start != stateMachine.getCurrentState()) {
+    firstLevel++;
+  }
+  bool resumed = firstLevel < 4;
+  if (resumed) {
+    NODE_LOGI(SWEEP_RESUMED, firstLevel);
+  }
+
+  while (resumed
+         || stateMachine.getCurrentState() == State::SWITCHING_TEST_START) {
+    if (!resumed) {
+      stateMachine.handleEvent(Event::TIMER_READY);
+      firstLevel = 0;
+    }
+    resumed = false;
+    bool levelFailed = false;
+
+    for (uint8_t level = firstLevel; level < 4; ++level) {
+      const SweepLevel& step = sweepLevels[level];
+      if (stateMachine.getCurrentState() != step.start) {
+        NODE_LOGE(SWEEP_OUT_OF_SEQUENCE, stateMachine.getCurrentState());
+        return TEST_FAILED;
       }
 
-      _time_capture_ok = false;  // Reset for the next iteration
+      _currentTest = level;
+      uint16_t levelVA = (static_cast<uint32_t>(fullLoadVA) * step.load) / 100;
+      setLoad(levelVA);
+      stateMachine.handleEvent(step.loadEvent);
+
+      // In edge mode the UPS edge itself moves DONE on, straight from the
+      // ISR; flush() lets that land before the state is checked again
+      if (_config.edgeDrivesCapture) {
+        stateMachine.armEdgeEvent(SENSE_UPS_POWER_PIN, EdgeType::RISING_EDGE,
+                                  Event::TIME_CAPTURE_OK);
+      }
+      TestResult result = run(levelVA, testduration);
+      bool edgePosted
+          = _config.edgeDrivesCapture && stateMachine.disarmEdgeEvent();
+      stateMachine.flush();
+      if (result != TEST_SUCESSFUL) {
+        levelFailed = true;
+        break;
+      }
+      _data.switchTest[level].load_percentage = step.load;
+      Checkpoint::saveSwitchResult(level, _data.switchTest[level]);
+      if (!edgePosted) {
+        stateMachine.handleEvent(Event::TIME_CAPTURE_OK);
+      }
     }
 
-    vTaskDelay(pdMS_TO_TICKS(100));  // Delay to avoid busy-waiting
+    if (!levelFailed) {
+      stateMachine.handleEvent(Event::TEST_SUCCESS);
+      break;
+    }
+    if (abortRequested()) {
+      return TEST_FAILED;
+    }
+    // Into CHECK from wherever the level stopped (an edge-driven capture
+    // may already have moved on), then CHECK decides between a retry and
+    // failure
+    if (stateMachine.getCurrentState() != State::SWITCHING_TEST_CHECK) {
+      stateMachine.handleEvent(Event::TEST_FAILED);
+    }
+    stateMachine.handleEvent(Event::TEST_FAILED);
   }
 
-  if (!valid_data) {
-    Serial.println("Test duration elapsed or test failed.");
+  _currentTest = 0;
+  if (stateMachine.getCurrentState() != State::SWITCHING_TEST_OK) {
+    NODE_LOGE(SWEEP_FAILED);
     return TEST_FAILED;
-  } else {
-    Serial.println("Test completed successfully.");
-    return TEST_SUCESSFUL;
   }
+  NODE_LOGI(SWEEP_DONE);
+  return TEST_SUCESSFUL;
 }
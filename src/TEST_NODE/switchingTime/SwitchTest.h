@@ -1,96 +1,121 @@
 #ifndef SWITCH_TEST_H
 #define SWITCH_TEST_H
 
-#include "Testmanager.h"
+#include "EdgeEventQueue.h"
+#include "EdgeTrace.h"
+#include "PhaseTrigger.h"
+#include "SwitchStats.h"
+#include "TestManager.h"
 #include "UPSTest.h"
 #include "UPSTesterSetup.h"
 
 struct SwithTestData {
-
-  struct TestData {
-    uint8_t testNo;
-    unsigned long testTimestamp;
-    unsigned long switchtime;
-    unsigned long starttime;
-    unsigned long endtime;
-    LoadPercentage load_percentage : 7;  // Adjusted to cover all possible
-    bool valid_data : 1;
-  } switchTest[5];
+  using TestData = Node_Core::SwitchResult;
+  TestData switchTest[5];
+  // Distribution of repeated shots, one per switchTest slot
+  SwitchTimeStats switchStats[5];
+  // One entry per phase step of the last runPhaseSweep()
+  static constexpr uint8_t MAX_PHASE_STEPS = 24;
+  struct PhaseResult {
+    uint16_t phase_deg;           // Requested cut phase
+    uint16_t firedPhase_x10;      // Where the cut landed, 0.1 degrees
+    unsigned long switchtime_us;  // Zero when the shot failed
+  } phaseSweep[MAX_PHASE_STEPS];
+  uint8_t phaseSteps;
+  uint8_t worstPhaseStep;
   struct TestSettings {
-    uint8_t pwmchannelNo = 0;
-    uint8_t pwmResolusion_bits = 8;
-    uint16_t pwmduty_set = 0;
-    uint16_t adjust_pwm_25P = 0;
-    uint16_t adjust_pwm_50P = 0;
-    uint16_t adjust_pwm_75P = 0;
-    uint16_t adjust_pwm_100P = 0;
-    uint32_t pwm_frequecy = 3000;
     unsigned long ToleranceSwitchTime_ms = 50;
     unsigned long min_valid_switch_time_ms = 0;
     unsigned long max_valid_switch_time_ms = 10000;
     unsigned long testduration_ms = 10000;
+    unsigned long debounceDelay_us = 100000;
+    bool recordEdgeTrace = false;  // Extract switch time from the raw trace
+    // Trace edges closer than this to the previous one are bounce of the
+    // same transition. Well below the UPS output dropout at the cut, which
+    // must stay a transition of its own.
+    unsigned long traceBounce_us = 250;
+    unsigned long mainsRestoreTimeout_ms = 2000;
+    uint16_t statShots = 1;  // More than one selects runStatistical()
+    bool phaseSync = false;  // Cut at cutPhase_deg when mains is detected
+    bool edgeDrivesCapture = false;  // UPS edge ISR posts TIME_CAPTURE_OK
+    uint16_t cutPhase_deg = 0;
+    uint16_t phaseStep_deg = 15;  // runPhaseSweep() resolution
     uint8_t max_retest = 3;
   } testsettings;
-
-  struct TaskSettings {
-    BaseType_t switchtaskCore = 0;
-    BaseType_t mainsISRtaskCore = ARDUINO_RUNNING_CORE;
-    BaseType_t upsISRtaskCore = ARDUINO_RUNNING_CORE;
-
-    UBaseType_t switchtaskPr = 2;
-    UBaseType_t mainsISRtaskPr = 1;
-    UBaseType_t upsISRtaskPr = 1;
-    uint32_t switchtaskStack = 12000;
-    uint32_t mainsISRtaskStack = 12000;
-    uint32_t upsISRtaskStack = 12000;
-  } tasksettings;
 };
-class SwitchTest {
+// Switch time between the mains-loss and UPS-output edges, in microseconds.
+// Edges out of order (a stale UPS edge) yield zero.
+inline unsigned long switchTimeFromEdges_us(int64_t mainsLoss_us,
+                                            int64_t upsGain_us) {
+  return upsGain_us > mainsLoss_us
+             ? static_cast<unsigned long>(upsGain_us - mainsLoss_us)
+             : 0UL;
+}
+
+class SwitchTest
+    : public UPSTest<SwitchTest, SwithTestData, TestType::SwitchTest> {
 public:
-  static SwitchTest* getInstance();  // Singleton accessor
-  static void deleteInstance();
-  void init();
-  SwithTestData& data();
+  const EdgeTrace& edgeTrace() const;
   TestResult run(uint16_t testVARating = 4000,
                  unsigned long testduration = 10000);
+  TestResult runStatistical(uint16_t testVARating, uint16_t shots,
+                            unsigned long testduration = 10000);
+  TestResult runSweep(StateMachine& stateMachine, uint16_t fullLoadVA,
+                      unsigned long testduration = 10000);
+  // One shot per phaseStep_deg across the mains cycle at one load level
+  TestResult runPhaseSweep(uint16_t testVARating,
+                           unsigned long testduration = 10000);
+  // The next startTest() runs runPhaseSweep() instead of runSweep()
+  void requestPhaseSweep() { _phaseSweepRequested = true; }
+
+  // Settings written over Modbus land in a pending copy that the test task
+  // takes at the start of its next job, so a running sweep never sees them
+  // change
+  void setRecordEdgeTrace(bool enabled);
+  // Shots per runStatistical(); 0 or 1 selects the four-level sweep
+  void setStatShots(uint16_t shots);
+  // Every cut of a normal run lands at phase_deg of the mains cycle
+  void setPhaseSync(bool enabled);
+  void setCutPhase(uint16_t phase_deg);
+  // The UPS edge ISR posts TIME_CAPTURE_OK during runSweep()
+  void setEdgeDrivesCapture(bool enabled);
 
 private:
+  friend class UPSTest<SwitchTest, SwithTestData, TestType::SwitchTest>;
   friend class TestManager;
   SwitchTest();  // Private Constructor
-  ~SwitchTest();
-  static SwitchTest* instance;  // Static pointer to hold the instance
+  ~SwitchTest() = default;
 
-  SwithTestData _data;
   SwithTestData::TestSettings _config;
-  SetupTask _tasksetting;
-  SetupTaskParams _taskparams;
-  bool _initialized = false;
-  bool _testRunning;
-  bool _time_capture_running;
-  bool _time_capture_ok;
-  uint8_t _currentTest;
-  unsigned long _testDuration;
-
-  void setupPins();
-  void configureInterrupts();
-  void createMainTasks();
-  void createISRTasks();
-
-  static void switchTestTask(void* pvParameters);
-  static void onMainsPowerLossTask(void* pvParameters);
-  static void onUPSPowerGainTask(void* pvParameters);
+  SwithTestData::TestSettings _pending;  // Guarded by _settingsLock
+  portMUX_TYPE _settingsLock;
+  int64_t _captureStart_us;
+  int64_t _captureEnd_us;
+  int64_t _lastMainsEdge_us;
+  int64_t _lastUPSEdge_us;
+  uint16_t _cutPhase_deg;
+  volatile bool _phaseSweepRequested;
+  EdgeTrace _trace;
+  // Where the capture of the running shot lands: switchTest[_currentTest],
+  // or _phaseShot during runPhaseSweep() so the sweep results stay intact
+  SwithTestData::TestData* _shot;
+  SwithTestData::TestData _phaseShot;
 
-  void simulatePowerCut();
-  void simulatePowerRestore();
-  void sendEndSignal();
-  void settestDuration(unsigned long duration);
-  void setLoad(uint16_t testVARating);
-  void selectLoadBank(uint16_t bankNumbers);
+  // UPSTest hooks
+  void resetData();
+  void onEdgeEvent(const EdgeEvent& event);
+  static void MainTestTask(void* pvParameters);
 
-  void startTimeCapture();
-  void stopTimeCapture();
+  void applySettings();
+  TestResult runShot(SwithTestData::TestData& shot, uint16_t testVARating,
+                     unsigned long testduration);
+  void cutPower();
+  void restorePower();
+  void startTimeCapture(int64_t edgeTime_us);
+  void stopTimeCapture(int64_t edgeTime_us);
+  void applyTraceAnalysis();
   bool process_time_capture();
-  bool checkTimerange(unsigned long switchtime);
+  bool checkTimerange(unsigned long switchtime_us);
 };
 
 #endif  // SWITCH_TEST_H
@@ -0,0 +1,257 @@
+#include "TransientTest.h"
+#include "AdcStream.h"
+#include "LoadBanks.h"
+#include "LoadTable.h"
+#include "NodeLog.h"
+#include <algorithm>
+#include <math.h>
+
+using namespace Node_Core;
+using NodeTask::IO_SETUP;
+
+namespace {
+
+// AIN2/AIN3 differential from the output sense transformer
+constexpr ADS1115_MUX OUTPUT_CHANNEL = ADS1115_COMP_2_3;
+// +-2.048 V range, 32768 counts per 2048 mV
+constexpr uint32_t COUNTS_PER_V = 16000;
+
+}  // namespace
+
+// Private Constructor
+TransientTest::TransientTest() : _config(), _ring() {}
+
+void TransientTest::resetData() {
+  for (auto& test : _data.transientTest) {
+    test.testNo = 0;
+    test.testTimestamp = 0;
+    test.stepVA = 0;
+    test.baseline_dV = 0;
+    test.minimum_dV = 0;
+    test.dip_x100 = 0;
+    test.overshoot_x100 = 0;
+    test.recovery_us = 0;
+    test.sampleRate_Hz = 0;
+    test.overruns = 0;
+    test.recovered = false;
+    test.valid_data = false;
+  }
+}
+
+// Main TransientTest task, one load step per startTest()
+void TransientTest::MainTestTask(void* pvParameters) {
+  if (instance) {
+    while (true) {
+      ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+      instance->run(instance->_config.stepVA);
+      NODE_LOGD(TASK_STACK_HWM, uxTaskGetStackHighWaterMark(NULL));
+    }
+  }
+  vTaskDelete(NULL);
+}
+
+void TransientTest::loadOff() {
+  writeLoadPwm(0);
+  selectLoadBank(0);
+}
+
+// Streams the output voltage into the ring. Once preTrigger samples are in,
+// the step fires on the next rising zero crossing so every run hits the
+// same phase; the ring keeps turning while it waits. postTrigger samples
+// later the capture stops. The PWM trim is set up front with the banks
+// still open, so the step itself is one masked write inside the read loop
+// and never the soft-start wait of setLoad().
+bool TransientTest::capture(uint16_t stepVA, uint16_t& pre, uint16_t& total,
+                            TransientTestData::TestData& test) {
+  const uint16_t RING = TransientTestData::RING_SAMPLES;
+  const uint16_t preTrigger
+      = _config.preTrigger < RING / 2 ? _config.preTrigger : RING / 2;
+  const uint16_t postTrigger = _config.postTrigger < RING - preTrigger
+                                   ? _config.postTrigger
+                                   : RING - preTrigger;
+  // A flat or missing waveform still fires after a few cycles
+  const uint32_t fireBy = preTrigger + 4UL * 860 / _config.nominalFrequency_Hz;
+
+  uint8_t stepBanks = 0;
+  uint16_t stepDuty = 0;
+  LoadTable::ensure(_cfgHardware);
+  LoadTable::lookup(stepVA, stepBanks, stepDuty);
+  writeLoadPwm(stepDuty);
+
+  AdcStream stream;
+  if (!stream.begin(OUTPUT_CHANNEL, ADS1115_RANGE_2048)) {
+    return false;
+  }
+  uint16_t head = 0;
+  uint32_t written = 0;
+  uint16_t afterStep = 0;
+  bool fired = false;
+  bool ok = true;
+  int16_t previous = 0;
+  int64_t first_us = 0;
+  int64_t last_us = 0;
+  test.overruns = 0;
+
+  while (!fired || afterStep < postTrigger) {
+    int16_t value = 0;
+    uint32_t missed = 0;
+    if (!stream.read(value, last_us, missed)) {
+      ok = false;
+      break;
+    }
+    if (written == 0) {
+      first_us = last_us;
+    } else {
+      test.overruns += missed;
+    }
+    _ring[head] = value;
+    head = (head + 1) % RING;
+    written++;
+
+    if (fired) {
+      afterStep++;
+    } else if (written >= preTrigger
+               && ((previous < 0 && value >= 0) || written >= fireBy)) {
+      LoadBanks::apply(stepBanks);
+      fired = true;
+    }
+    previous = value;
+  }
+  stream.end();
+  if (!ok || written < 2 || last_us <= first_us) {
+    return false;
+  }
+
+  total = written < RING ? written : RING;
+  if (written > RING) {
+    std::rotate(_ring, _ring + head, _ring + RING);
+  }
+  pre = total - postTrigger;
+  test.sampleRate_Hz
+      = static_cast<uint16_t>((written - 1) * 1000000LL / (last_us - first_us));
+  return true;
+}
+
+// One-cycle sliding RMS envelope. The baseline is its mean before the step;
+// dip, overshoot and recovery come from the envelope after it.
+bool TransientTest::analyse(TransientTestData::TestData& test, uint16_t pre,
+                            uint16_t total) {
+  const uint16_t window = (test.sampleRate_Hz + _config.nominalFrequency_Hz / 2)
+                          / _config.nominalFrequency_Hz;
+  if (window < 2 || pre < 2 * window) {
+    return false;
+  }
+
+  int64_t sum = 0;
+  for (uint16_t i = 0; i < pre; ++i) {
+    sum += _ring[i];
+  }
+  const int32_t mean = static_cast<int32_t>(sum / pre);
+  auto squared = [&](uint16_t i) {
+    int32_t value = _ring[i] - mean;
+    return static_cast<int64_t>(value) * value;
+  };
+
+  int64_t windowSq = 0;
+  double baselineSum = 0.0;
+  uint16_t baselineCount = 0;
+  double minimum = 1e30;
+  uint16_t minimumAt = pre;
+  for (uint16_t i = 0; i < total; ++i) {
+    windowSq += squared(i);
+    if (i >= window) {
+      windowSq -= squared(i - window);
+    }
+    if (i + 1 < window) {
+      continue;
+    }
+    double envelope = sqrt(static_cast<double>(windowSq) / window);
+    if (i < pre) {
+      baselineSum += envelope;
+      baselineCount++;
+    } else if (envelope < minimum) {
+      minimum = envelope;
+      minimumAt = i;
+    }
+  }
+  const double baseline = baselineSum / baselineCount;
+  if (baseline <= 0.0) {
+    return false;
+  }
+
+  // Second pass for overshoot after the dip and the last excursion
+  const double band = baseline * _config.recoveryBand_x100 / 10000.0;
+  double maximum = baseline;
+  int32_t lastOutside = -1;
+  windowSq = 0;
+  for (uint16_t i = 0; i < total; ++i) {
+    windowSq += squared(i);
+    if (i >= window) {
+      windowSq -= squared(i - window);
+    }
+    if (i < pre) {
+      continue;
+    }
+    double envelope = sqrt(static_cast<double>(windowSq) / window);
+    if (i > minimumAt && envelope > maximum) {
+      maximum = envelope;
+    }
+    if (fabs(envelope - baseline) > band) {
+      lastOutside = i;
+    }
+  }
+
+  const double dVPerCount
+      = 10.0 * _config.inputDivider_x1000 / 1000.0 / COUNTS_PER_V;
+  test.baseline_dV = static_cast<uint16_t>(baseline * dVPerCount + 0.5);
+  test.minimum_dV = static_cast<uint16_t>(minimum * dVPerCount + 0.5);
+  test.dip_x100 = minimum < baseline ? static_cast<uint16_t>(
+                      (baseline - minimum) / baseline * 10000.0 + 0.5)
+                                     : 0;
+  test.overshoot_x100 = static_cast<uint16_t>(
+      (maximum - baseline) / baseline * 10000.0 + 0.5);
+  test.recovered = lastOutside < total - 1;
+  test.recovery_us
+      = lastOutside < pre
+            ? 0
+            : static_cast<uint32_t>((lastOutside + 1 - pre) * 1000000ULL
+                                    / test.sampleRate_Hz);
+  return true;
+}
+
+TestResult TransientTest::run(uint16_t stepVA) {
+  TransientTestData::TestData& test = _data.transientTest[_currentTest];
+  test.valid_data = false;
+  test.stepVA = stepVA;
+  NODE_LOGI(TRANSIENT_START, stepVA);
+
+  loadOff();
+  EventBits_t bits
+      = xEventGroupWaitBits(_testEvents, ABORT_BIT, pdFALSE, pdFALSE,
+                            pdMS_TO_TICKS(_config.settleTime_ms));
+  if (bits & ABORT_BIT) {
+    NODE_LOGW(TRANSIENT_ABORTED);
+    return TEST_FAILED;
+  }
+
+  uint16_t pre = 0;
+  uint16_t total = 0;
+  bool captured = capture(stepVA, pre, total, test);
+  loadOff();
+  if (!captured) {
+    NODE_LOGE(TRANSIENT_CAPTURE_FAILED);
+    return TEST_FAILED;
+  }
+  if (!analyse(test, pre, total)) {
+    return TEST_FAILED;
+  }
+  test.testNo = _currentTest + 1;
+  test.testTimestamp = static_cast<unsigned long>(IO_SETUP::now_us() / 1000);
+  NODE_LOGI(TRANSIENT_RESULT, test.dip_x100, test.overshoot_x100,
+            test.recovery_us);
+
+  test.valid_data = test.overruns == 0 && test.recovered
+                    && test.recovery_us <= _config.max_valid_recovery_us
+                    && test.dip_x100 <= _config.max_valid_dip_x100;
+  return test.valid_data ? TEST_SUCESSFUL : TEST_FAILED;
+}
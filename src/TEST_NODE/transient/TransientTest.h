@@ -0,0 +1,69 @@
+#ifndef TRANSIENT_TEST_H
+#define TRANSIENT_TEST_H
+#include "Arduino.h"
+#include "HardwareConfig.h"
+#include "TestManager.h"
+#include "UPSTest.h"
+
+struct TransientTestData {
+  static constexpr uint16_t RING_SAMPLES = 1024;
+
+  // Output voltage response to a load step, from a one-cycle RMS envelope
+  struct TestData {
+    uint8_t testNo;
+    unsigned long testTimestamp;
+    uint16_t stepVA;
+    uint16_t baseline_dV;     // Envelope before the step
+    uint16_t minimum_dV;      // Deepest point after the step
+    uint16_t dip_x100;        // Below baseline, 0.01 % units
+    uint16_t overshoot_x100;  // Above baseline after the dip, 0.01 %
+    uint32_t recovery_us;     // Step to the last excursion outside the band
+    uint16_t sampleRate_Hz;
+    uint16_t overruns;
+    bool recovered;  // Back inside the band before the capture ended
+    bool valid_data;
+  } transientTest[5];
+  struct TestSettings {
+    uint16_t stepVA = maxVARating;  // 0 -> 100 %
+    unsigned long settleTime_ms = 3000;  // At no load before arming
+    uint16_t preTrigger = 128;           // Samples kept before the step
+    uint16_t postTrigger = 896;          // About 1 s at 860 SPS
+    uint16_t recoveryBand_x100 = 300;    // +-3 % of baseline
+    uint8_t nominalFrequency_Hz = 50;    // Sets the envelope window
+    uint32_t inputDivider_x1000 = 200000;  // Output volts per ADC volt
+    uint32_t max_valid_recovery_us = 100000;
+    uint16_t max_valid_dip_x100 = 1000;
+  } testsettings;
+};
+
+class TransientTest
+    : public UPSTest<TransientTest, TransientTestData,
+                     TestType::TransientTest> {
+public:
+  TestResult run(uint16_t stepVA);
+
+private:
+  friend class UPSTest<TransientTest, TransientTestData,
+                       TestType::TransientTest>;
+  friend class TestManager;
+  TransientTest();  // Private Constructor
+  ~TransientTest() = default;
+
+  TransientTestData::TestSettings _config;
+  // Circular until the step fires, then filled up to postTrigger and
+  // rotated so the oldest sample comes first
+  int16_t _ring[TransientTestData::RING_SAMPLES];
+
+  // UPSTest hooks
+  void resetData();
+  void onEdgeEvent(const EdgeEvent& event) {}
+  static void MainTestTask(void* pvParameters);
+
+  bool capture(uint16_t stepVA, uint16_t& pre, uint16_t& total,
+               TransientTestData::TestData& test);
+  bool analyse(TransientTestData::TestData& test, uint16_t pre,
+               uint16_t total);
+  void loadOff();
+};
+
+#endif
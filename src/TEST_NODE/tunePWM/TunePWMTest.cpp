@@ -0,0 +1,161 @@
+#include "TunePWMTest.h"
+#include "NodeLog.h"
+#include "PowerMeters.h"
+
+using namespace Node_Core;
+using NodeTask::IO_SETUP;
+
+// Private Constructor
+TunePWMTest::TunePWMTest() : _config() {}
+
+void TunePWMTest::resetData() {
+  for (auto& test : _data.tunePWMTest) {
+    test.testNo = 0;
+    test.testTimestamp = 0;
+    test.points = 0;
+    for (auto& VA : test.fullScaleVA) {
+      VA = 0;
+    }
+    test.maxError_x100 = 0;
+    test.bankSkewMasked_ns = 0;
+    test.bankSkewSequential_ns = 0;
+    test.saved = false;
+    test.valid_data = false;
+  }
+}
+
+// Main TunePWMTest task, one calibration run per startTest()
+void TunePWMTest::MainTestTask(void* pvParameters) {
+  if (instance) {
+    while (true) {
+      ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+      instance->run();
+      NODE_LOGD(TASK_STACK_HWM, uxTaskGetStackHighWaterMark(NULL));
+    }
+  }
+  vTaskDelete(NULL);
+}
+
+void TunePWMTest::loadOff() {
+  writeLoadPwm(0);
+  selectLoadBank(0);
+}
+
+// Waits settleTime_ms after a load change, then averages samplesPerPoint
+// output readings. VA is V * I from the PZEM (0.1 V * 1 mA units).
+bool TunePWMTest::measureVA(uint16_t& VA) {
+  EventBits_t bits
+      = xEventGroupWaitBits(_testEvents, ABORT_BIT, pdFALSE, pdFALSE,
+                            pdMS_TO_TICKS(_config.settleTime_ms));
+  uint32_t sum = 0;
+  uint8_t count = 0;
+  for (uint8_t i = 0; i < _config.samplesPerPoint && !(bits & ABORT_BIT);
+       ++i) {
+    if (i > 0) {
+      bits = xEventGroupWaitBits(_testEvents, ABORT_BIT, pdFALSE, pdFALSE,
+                                 pdMS_TO_TICKS(_config.sampleInterval_ms));
+    }
+    powerMeasure output;
+    if (PowerMeters::readOutput(output)) {
+      sum += static_cast<uint32_t>(
+          static_cast<uint64_t>(output.voltage) * output.current / 10000);
+      count++;
+    }
+  }
+  if ((bits & ABORT_BIT) || count == 0) {
+    return false;
+  }
+  uint32_t average = sum / count;
+  VA = average > UINT16_MAX ? UINT16_MAX : average;
+  return true;
+}
+
+// Requests 25/50/75/100 % of maxVARating through setLoad() and compares the
+// measured VA, which now comes from the table just saved
+bool TunePWMTest::verify(uint16_t& maxError_x100) {
+  maxError_x100 = 0;
+  const LoadPercentage levels[] = {LOAD_25P, LOAD_50P, LOAD_75P, LOAD_100P};
+  for (LoadPercentage level : levels) {
+    uint16_t target = (static_cast<uint32_t>(maxVARating) * level) / 100;
+    setLoad(target);
+    uint16_t VA = 0;
+    if (!measureVA(VA)) {
+      return false;
+    }
+    uint32_t error = VA > target ? VA - target : target - VA;
+    uint32_t error_x100 = error * 10000UL / target;
+    if (error_x100 > maxError_x100) {
+      maxError_x100 = error_x100 > UINT16_MAX ? UINT16_MAX : error_x100;
+    }
+    NODE_LOGI(TUNE_PWM_VERIFY, target, VA);
+  }
+  return true;
+}
+
+// Sweeps the duty over LoadCalTable::POINTS for 1..4 banks, stores the
+// measured VA table in flash and optionally checks it. Rows are forced
+// non-decreasing so lookup() can interpolate without searching backwards.
+TestResult TunePWMTest::run() {
+  TunePWMTestData::TestData& test = _data.tunePWMTest[_currentTest];
+  test.valid_data = false;
+  test.saved = false;
+  test.points = 0;
+  PowerMeters::init();
+  NODE_LOGI(TUNE_PWM_START, LoadCalTable::BANKS, LoadCalTable::POINTS);
+
+  // Load PWM is off, so the relays switch without current
+  loadOff();
+  LoadBanks::Skew skew = LoadBanks::measureSkew();
+  test.bankSkewMasked_ns = skew.masked_ns;
+  test.bankSkewSequential_ns = skew.sequential_ns;
+  NODE_LOGI(BANK_SKEW, skew.masked_ns, skew.sequential_ns);
+
+  LoadCalTable table = {};
+  LoadTable::ensure(_cfgHardware);
+  table.maxDuty = LoadTable::maxDuty();
+  bool measured = true;
+  for (uint8_t bank = 0; bank < LoadCalTable::BANKS && measured; ++bank) {
+    selectLoadBank(bank + 1);
+    uint16_t floorVA = 0;
+    for (uint8_t point = 0; point < LoadCalTable::POINTS; ++point) {
+      uint16_t duty = LoadCalTable::dutyAt(point, table.maxDuty);
+      writeLoadPwm(duty);
+      uint16_t VA = 0;
+      if (!measureVA(VA)) {
+        measured = false;
+        break;
+      }
+      NODE_LOGD(TUNE_PWM_POINT, bank + 1, duty, VA);
+      floorVA = VA > floorVA ? VA : floorVA;
+      table.va[bank][point] = floorVA;
+      test.points++;
+    }
+    test.fullScaleVA[bank] = floorVA;
+  }
+  loadOff();
+
+  if (!measured) {
+    if (abortRequested()) {
+      NODE_LOGW(TUNE_PWM_ABORTED);
+    } else {
+      NODE_LOGE(TUNE_PWM_METER_FAILED);
+    }
+    return TEST_FAILED;
+  }
+  test.saved = LoadCalibration::save(table);
+  if (!test.saved) {
+    NODE_LOGE(TUNE_PWM_SAVE_FAILED);
+    return TEST_FAILED;
+  }
+  test.testNo = _currentTest + 1;
+  test.testTimestamp = static_cast<unsigned long>(IO_SETUP::now_us() / 1000);
+
+  bool verified = true;
+  if (_config.verify) {
+    verified = verify(test.maxError_x100);
+    loadOff();
+  }
+  test.valid_data
+      = verified && test.maxError_x100 <= _config.maxError_x100;
+  return test.valid_data ? TEST_SUCESSFUL : TEST_FAILED;
+}
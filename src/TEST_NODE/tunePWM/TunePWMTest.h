@@ -0,0 +1,55 @@
+#ifndef TUNE_PWM_TEST_H
+#define TUNE_PWM_TEST_H
+#include "Arduino.h"
+#include "HardwareConfig.h"
+#include "LoadCalibration.h"
+#include "TestManager.h"
+#include "UPSTest.h"
+
+struct TunePWMTestData {
+
+  // Result of one calibration run
+  struct TestData {
+    uint8_t testNo;
+    unsigned long testTimestamp;
+    uint16_t points;                             // Duty points measured
+    uint16_t fullScaleVA[LoadCalTable::BANKS];  // At full duty, per banks
+    uint16_t maxError_x100;  // Worst verification error, 0.01 % units
+    uint32_t bankSkewMasked_ns;      // Pin-level spread, masked write
+    uint32_t bankSkewSequential_ns;  // Same with one write per bank
+    bool saved;
+    bool valid_data;
+  } tunePWMTest[5];
+  struct TestSettings {
+    unsigned long settleTime_ms = 2000;  // After each duty or bank change
+    unsigned long sampleInterval_ms = 1000;  // PZEM refreshes about 1 Hz
+    uint8_t samplesPerPoint = 2;
+    uint16_t maxError_x100 = 200;  // +-2 % of the requested VA
+    bool verify = true;            // Re-measure 25..100 % after saving
+  } testsettings;
+};
+
+class TunePWMTest
+    : public UPSTest<TunePWMTest, TunePWMTestData, TestType::TunePWMTest> {
+public:
+  TestResult run();
+
+private:
+  friend class UPSTest<TunePWMTest, TunePWMTestData, TestType::TunePWMTest>;
+  friend class TestManager;
+  TunePWMTest();  // Private Constructor
+  ~TunePWMTest() = default;
+
+  TunePWMTestData::TestSettings _config;
+
+  // UPSTest hooks
+  void resetData();
+  void onEdgeEvent(const EdgeEvent& event) {}
+  static void MainTestTask(void* pvParameters);
+
+  bool measureVA(uint16_t& VA);
+  bool verify(uint16_t& maxError_x100);
+  void loadOff();
+};
+
+#endif
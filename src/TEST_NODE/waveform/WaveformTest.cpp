@@ -0,0 +1,260 @@
+#include "WaveformTest.h"
+#include "AdcStream.h"
+#include "NodeLog.h"
+#include "PowerMeters.h"
+#include <math.h>
+
+using namespace Node_Core;
+using NodeTask::IO_SETUP;
+
+namespace {
+
+// AIN2/AIN3 differential from the output sense transformer
+constexpr ADS1115_MUX WAVEFORM_CHANNEL = ADS1115_COMP_2_3;
+// +-2.048 V range, 32768 counts per 2048 mV
+constexpr uint32_t COUNTS_PER_V = 16000;
+
+// Fixed-point Goertzel, coefficient 2cos(w) in Q14. Returns |X_k|^2 in
+// squared counts; states stay within int32 for 512 full-scale samples.
+int64_t goertzelPower(const int16_t* x, uint16_t n, int32_t coeff_q14) {
+  int32_t s1 = 0;
+  int32_t s2 = 0;
+  for (uint16_t i = 0; i < n; ++i) {
+    int32_t s0 = x[i]
+                 + static_cast<int32_t>(
+                     (static_cast<int64_t>(coeff_q14) * s1) >> 14)
+                 - s2;
+    s2 = s1;
+    s1 = s0;
+  }
+  int64_t cross = (static_cast<int64_t>(coeff_q14) * s1) >> 14;
+  return static_cast<int64_t>(s1) * s1 + static_cast<int64_t>(s2) * s2
+         - cross * s2;
+}
+
+}  // namespace
+
+// Private Constructor
+WaveformTest::WaveformTest() : _config(), _samples() {}
+
+void WaveformTest::resetData() {
+  for (auto& test : _data.waveformTest) {
+    test.testNo = 0;
+    test.testTimestamp = 0;
+    test.rms_dV = 0;
+    test.peak_dV = 0;
+    test.crestFactor_x100 = 0;
+    test.thd_x100 = 0;
+    test.frequency_cHz = 0;
+    test.sampleRate_Hz = 0;
+    test.samples = 0;
+    test.overruns = 0;
+    test.cycles = 0;
+    test.harmonics = 0;
+    test.valid_data = false;
+  }
+  _data.traceLength = 0;
+}
+
+// Main WaveformTest task, one capture per startTest(). Captures run here and
+// hold only the ADC lock, so other tests keep their meters.
+void WaveformTest::MainTestTask(void* pvParameters) {
+  if (instance) {
+    while (true) {
+      ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+      instance->run();
+      NODE_LOGD(TASK_STACK_HWM, uxTaskGetStackHighWaterMark(NULL));
+    }
+  }
+  vTaskDelete(NULL);
+}
+
+// Reads count conversions from the ADC stream. Missed conversions are
+// counted as overruns, since they break the uniform time grid.
+bool WaveformTest::capture(uint16_t count, uint16_t& overruns,
+                           int64_t& elapsed_us) {
+  overruns = 0;
+  elapsed_us = 0;
+  AdcStream stream;
+  if (!stream.begin(WAVEFORM_CHANNEL, ADS1115_RANGE_2048)) {
+    return false;
+  }
+  bool ok = true;
+  int64_t first_us = 0;
+  for (uint16_t n = 0; n < count; ++n) {
+    int64_t now_us = 0;
+    uint32_t missed = 0;
+    if (!stream.read(_samples[n], now_us, missed)) {
+      ok = false;
+      break;
+    }
+    if (n == 0) {
+      first_us = now_us;
+    } else {
+      overruns += missed;
+    }
+    elapsed_us = now_us - first_us;
+  }
+  stream.end();
+  return ok;
+}
+
+// Removes DC, then analyses whole cycles between the first and last rising
+// zero crossing. With an integer number of cycles in the window harmonic h
+// falls exactly on bin h * cycles, so no window function is needed.
+bool WaveformTest::analyse(WaveformTestData::TestData& test) {
+  const uint16_t n = test.samples;
+  int64_t sum = 0;
+  for (uint16_t i = 0; i < n; ++i) {
+    sum += _samples[i];
+  }
+  const int32_t mean = static_cast<int32_t>(sum / n);
+  int32_t peak = 0;
+  for (uint16_t i = 0; i < n; ++i) {
+    int32_t value = _samples[i] - mean;
+    if (value > INT16_MAX) {
+      value = INT16_MAX;
+    } else if (value < -INT16_MAX) {
+      value = -INT16_MAX;
+    }
+    _samples[i] = static_cast<int16_t>(value);
+    int32_t magnitude = value < 0 ? -value : value;
+    if (magnitude > peak) {
+      peak = magnitude;
+    }
+  }
+
+  // Rising crossings, armed only after dropping below -peak/8 so noise
+  // around zero is not counted twice
+  const int32_t hysteresis = peak / 8;
+  bool armed = false;
+  int32_t firstCrossing = -1;
+  int32_t lastCrossing = -1;
+  float firstPosition = 0.0f;
+  float lastPosition = 0.0f;
+  uint16_t cycles = 0;
+  for (uint16_t i = 1; i < n; ++i) {
+    if (_samples[i - 1] < -hysteresis) {
+      armed = true;
+    }
+    if (armed && _samples[i - 1] < 0 && _samples[i] >= 0) {
+      float fraction = static_cast<float>(-_samples[i - 1])
+                       / (_samples[i] - _samples[i - 1]);
+      lastPosition = i - 1 + fraction;
+      lastCrossing = i;
+      if (firstCrossing < 0) {
+        firstCrossing = i;
+        firstPosition = lastPosition;
+      } else {
+        cycles++;
+      }
+      armed = false;
+    }
+  }
+  test.cycles = cycles;
+  if (cycles < _config.minCycles) {
+    return false;
+  }
+
+  const int16_t* segment = _samples + firstCrossing;
+  const uint16_t length = lastCrossing - firstCrossing;
+  int64_t sumSq = 0;
+  int32_t segmentPeak = 0;
+  for (uint16_t i = 0; i < length; ++i) {
+    int32_t value = segment[i];
+    sumSq += value * value;
+    int32_t magnitude = value < 0 ? -value : value;
+    if (magnitude > segmentPeak) {
+      segmentPeak = magnitude;
+    }
+  }
+  const double rms_counts = sqrt(static_cast<double>(sumSq) / length);
+  if (rms_counts <= 0.0) {
+    return false;
+  }
+
+  int64_t fundamental = 0;
+  int64_t harmonics = 0;
+  uint8_t highest = 0;
+  for (uint8_t h = 1; h <= _config.maxHarmonics; ++h) {
+    uint32_t bin = static_cast<uint32_t>(h) * cycles;
+    if (2 * bin >= length) {
+      break;
+    }
+    int32_t coeff_q14 = static_cast<int32_t>(
+        lround(2.0 * cos(2.0 * M_PI * bin / length) * 16384.0));
+    int64_t power = goertzelPower(segment, length, coeff_q14);
+    if (h == 1) {
+      fundamental = power;
+    } else if (power > 0) {  // Rounding can leave empty bins just below 0
+      harmonics += power;
+    }
+    highest = h;
+  }
+  test.harmonics = highest;
+  if (fundamental <= 0) {
+    return false;
+  }
+
+  // counts -> dV through the ADC range and the sense divider
+  const double dVPerCount
+      = 10.0 * _config.inputDivider_x1000 / 1000.0 / COUNTS_PER_V;
+  const double thd = sqrt(static_cast<double>(harmonics) / fundamental);
+  const double period = (lastPosition - firstPosition) / cycles;
+  test.rms_dV = static_cast<uint16_t>(rms_counts * dVPerCount + 0.5);
+  test.peak_dV = static_cast<uint16_t>(segmentPeak * dVPerCount + 0.5);
+  test.crestFactor_x100
+      = static_cast<uint16_t>(segmentPeak / rms_counts * 100.0 + 0.5);
+  test.thd_x100
+      = thd < 6.5535 ? static_cast<uint16_t>(thd * 10000.0 + 0.5) : UINT16_MAX;
+  test.frequency_cHz = static_cast<uint16_t>(
+      period > 0.0 ? test.sampleRate_Hz * 100.0 / period + 0.5 : 0);
+  return true;
+}
+
+void WaveformTest::storeTrace(uint16_t count) {
+  const uint8_t step = _config.traceDecimation;
+  _data.traceLength = 0;
+  if (step == 0) {
+    return;
+  }
+  for (uint16_t i = 0;
+       i < count && _data.traceLength < WaveformTestData::TRACE_LENGTH;
+       i += step) {
+    _data.trace[_data.traceLength++] = _samples[i];
+  }
+}
+
+TestResult WaveformTest::run() {
+  WaveformTestData::TestData& test = _data.waveformTest[_currentTest];
+  test.valid_data = false;
+  const uint16_t count = _config.samples < WaveformTestData::MAX_SAMPLES
+                             ? _config.samples
+                             : WaveformTestData::MAX_SAMPLES;
+  PowerMeters::init();
+
+  int64_t elapsed_us = 0;
+  if (count < 2 || !capture(count, test.overruns, elapsed_us)
+      || elapsed_us <= 0) {
+    NODE_LOGE(WAVEFORM_CAPTURE_FAILED);
+    return TEST_FAILED;
+  }
+  test.samples = count;
+  test.sampleRate_Hz
+      = static_cast<uint16_t>((count - 1) * 1000000LL / elapsed_us);
+
+  bool analysed = analyse(test);
+  storeTrace(count);
+  test.testNo = _currentTest + 1;
+  test.testTimestamp = static_cast<unsigned long>(IO_SETUP::now_us() / 1000);
+  if (!analysed) {
+    NODE_LOGW(WAVEFORM_TOO_FEW_CYCLES, test.cycles, _config.minCycles);
+    return TEST_FAILED;
+  }
+  NODE_LOGI(WAVEFORM_RESULT, test.rms_dV, test.crestFactor_x100,
+            test.thd_x100);
+
+  test.valid_data = test.overruns == 0
+                    && test.thd_x100 <= _config.max_valid_thd_x100;
+  return test.valid_data ? TEST_SUCESSFUL : TEST_FAILED;
+}
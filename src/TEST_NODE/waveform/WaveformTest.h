@@ -0,0 +1,67 @@
+#ifndef WAVEFORM_TEST_H
+#define WAVEFORM_TEST_H
+#include "Arduino.h"
+#include "HardwareConfig.h"
+#include "TestManager.h"
+#include "UPSTest.h"
+
+struct WaveformTestData {
+  static constexpr uint16_t MAX_SAMPLES = 512;
+  static constexpr uint16_t TRACE_LENGTH = 64;
+
+  // Summary of one capture of the UPS output voltage
+  struct TestData {
+    uint8_t testNo;
+    unsigned long testTimestamp;
+    uint16_t rms_dV;
+    uint16_t peak_dV;
+    uint16_t crestFactor_x100;
+    uint16_t thd_x100;       // 0.01 % units
+    uint16_t frequency_cHz;  // 0.01 Hz units
+    uint16_t sampleRate_Hz;  // Measured, the ADS1115 clock is only +-10 %
+    uint16_t samples;
+    uint16_t overruns;  // Conversions the reader missed
+    uint8_t cycles;     // Whole cycles analysed
+    uint8_t harmonics;  // Highest harmonic below Nyquist included in THD
+    bool valid_data;
+  } waveformTest[5];
+  // Decimated, DC removed counts of the last capture
+  int16_t trace[TRACE_LENGTH];
+  uint16_t traceLength;
+  struct TestSettings {
+    uint16_t samples = MAX_SAMPLES;  // About 0.6 s at 860 SPS
+    uint32_t inputDivider_x1000 = 200000;  // Output volts per ADC volt
+    uint8_t traceDecimation = 8;           // 0 disables the trace
+    uint8_t maxHarmonics = 15;
+    uint8_t minCycles = 4;
+    uint16_t max_valid_thd_x100 = 800;
+  } testsettings;
+};
+
+class WaveformTest
+    : public UPSTest<WaveformTest, WaveformTestData, TestType::WaveformTest> {
+public:
+  TestResult run();
+
+private:
+  friend class UPSTest<WaveformTest, WaveformTestData,
+                       TestType::WaveformTest>;
+  friend class TestManager;
+  WaveformTest();  // Private Constructor
+  ~WaveformTest() = default;
+
+  WaveformTestData::TestSettings _config;
+  // Preallocated so a capture never touches the heap
+  int16_t _samples[WaveformTestData::MAX_SAMPLES];
+
+  // UPSTest hooks
+  void resetData();
+  void onEdgeEvent(const EdgeEvent& event) {}
+  static void MainTestTask(void* pvParameters);
+
+  bool capture(uint16_t count, uint16_t& overruns, int64_t& elapsed_us);
+  bool analyse(WaveformTestData::TestData& test);
+  void storeTrace(uint16_t count);
+};
+
+#endif
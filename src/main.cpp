@@ -1,6 +1,16 @@
 #include "Adafruit_MAX31855.h"
+#include "Checkpoint.h"
+#include "backupTime.h"
+#include "EfficiencyTest.h"
+#include "InputVoltageTest.h"
+#include "TransientTest.h"
+#include "TunePWMTest.h"
+#include "WaveformTest.h"
 #include "FS.h"
+#include "HardwareSetup.h"
 #include "ModbusManager.h"
+#include "NodeLog.h"
+#include "StateMachine.h"
 #include "SwitchTest.h"
 #include "TestManager.h"
 #include "UPSTest.h"
@@ -12,57 +22,16 @@
 #include <Wire.h>
 #include <esp32-hal-log.h>
 
-volatile unsigned long lastMainsTriggerTime = 0;
-volatile unsigned long lastUPSTriggerTime = 0;
-volatile bool mains_triggered = false;
-volatile bool ups_triggered = false;
-volatile bool check_ups_shutdown = false;
-const unsigned long debounceDelay = 100;
+// Shared with the test modules, see NodeGlobals.cpp
+extern StateMachine* stateMachine;
 
 TaskHandle_t modbusRTUTaskHandle = NULL;
 
-TaskHandle_t ISR_MAINS_POWER_LOSS = NULL;
-TaskHandle_t ISR_UPS_POWER_GAIN = NULL;
-TaskHandle_t ISR_UPS_POWER_LOSS = NULL;
-
-// Define the SwitchTest instance
-SwitchTest* switchTest = nullptr;
-UPSTesterSetup* TesterSetup = nullptr;
-// Task handles
-
-SemaphoreHandle_t xSemaphore;
-
-Modbus::ResultCode err;
-
-ModbusRTU mb;
+BackupTimeTest* backupTimeTest = nullptr;
+InputVoltageTest* inputVoltageTest = nullptr;
+TunePWMTest* tunePWMTest = nullptr;
 #define ESP_LITTLEFS_TAG = "LFS"
 
-void IRAM_ATTR keyISR1(void* pvParameters) {
-  unsigned long currentTime = millis();
-  if (currentTime - lastMainsTriggerTime > debounceDelay) {
-    if (!mains_triggered) {
-      mains_triggered = true;
-    }
-    lastMainsTriggerTime = currentTime;
-    xTaskResumeFromISR(ISR_MAINS_POWER_LOSS);
-  }
-}
-void IRAM_ATTR keyISR2(void* pvParameters) {
-  unsigned long currentTime = millis();
-  if (currentTime - lastUPSTriggerTime > debounceDelay) {
-    if (!ups_triggered) {
-      ups_triggered = true;
-    }
-    lastUPSTriggerTime = currentTime;
-    if (check_ups_shutdown) {
-      xTaskResumeFromISR(ISR_UPS_POWER_LOSS);
-    } else {
-      xTaskResumeFromISR(ISR_UPS_POWER_GAIN);
-    }
-    // xTaskResumeFromISR(ISR_UPS_POWER_GAIN);
-  }
-}
-
 void modbusRTUTask(void* pvParameters) {
 
   while (true) {
@@ -81,13 +50,65 @@ void setup() {
   // Initialize Serial for debugging
   Serial.begin(115200);
   Serial.print("Serial started........");
+  NodeLog::init();
   TesterSetup = UPSTesterSetup::getInstance();
+  // Before any transition, so a reset mid-sequence resumes where it was
+  bool checkpointed = Checkpoint::restore();
+  stateMachine = new StateMachine();
+  // A table compiled by tools/transition_compiler.py replaces the built-in
+  // sequence without reflashing
+  stateMachine->deserializeTransitions();
+  State resumeState = stateMachine->loadState();
+  if (checkpointed && resumeState != State::DEVICE_SHUTDOWN) {
+    stateMachine->setState(resumeState);
+    NODE_LOGI(CHECKPOINT_RESUMED, resumeState, Checkpoint::sequence());
+  }
+  uint8_t backupTestNo = 0;
+  uint32_t backupElapsed_ms = 0;
+  if (Checkpoint::interruptedBackup(backupTestNo, backupElapsed_ms)) {
+    NODE_LOGW(CHECKPOINT_BACKUP_INTERRUPTED, backupTestNo, backupElapsed_ms);
+    Checkpoint::saveBackupProgress(0, 0, 0);
+  }
+  // Beside the edge consumer, above the test tasks, so a test blocked in
+  // handleEvent() gets its transition back promptly
+  SetupTask taskSetup = TesterSetup ? TesterSetup->taskSetup() : SetupTask();
+  stateMachine->begin(taskSetup.mainTest_taskIdlePriority + 1,
+                      taskSetup.mainTest_taskCore);
+  // Flash writes only, below everything that measures
+  Checkpoint::begin(1, taskSetup.mainTest_taskCore);
   // Get the singleton instance of SwitchTest
   switchTest = SwitchTest::getInstance();
   if (switchTest) {
     switchTest->init();
     Serial.print("Switchtest initialised........");
   }
+  backupTimeTest = BackupTimeTest::getInstance();
+  if (backupTimeTest) {
+    backupTimeTest->init();
+  }
+  // Zero crossings need a few cycles to settle the period before the first
+  // phase-synchronised cut
+  PhaseTrigger::begin();
+  efficiencyTest = EfficiencyTest::getInstance();
+  if (efficiencyTest) {
+    efficiencyTest->init();
+  }
+  inputVoltageTest = InputVoltageTest::getInstance();
+  if (inputVoltageTest) {
+    inputVoltageTest->init();
+  }
+  waveformTest = WaveformTest::getInstance();
+  if (waveformTest) {
+    waveformTest->init();
+  }
+  tunePWMTest = TunePWMTest::getInstance();
+  if (tunePWMTest) {
+    tunePWMTest->init();
+  }
+  transientTest = TransientTest::getInstance();
+  if (transientTest) {
+    transientTest->init();
+  }
   modbusRTU_Init();
   Serial2.begin(9600, SERIAL_8N1);
   mb.begin(&Serial2);
@@ -0,0 +1,148 @@
+#include "StateMachine.h"
+#include "TransitionTable.h"
+#include <LittleFS.h>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <unity.h>
+#include <vector>
+
+using namespace Node_Core;
+
+// Row lookup of StateMachine::dispatch() against the linear scan it
+// replaced, on the built-in table as serializeTransitions() exports it. The
+// scan rows keep the old layout, std::function guard and action per row, so
+// the stride the scan walks is the one the old handleEvent() walked.
+
+namespace {
+
+constexpr const char* BENCH_PATH = "/bench_table.bin";
+constexpr size_t CELLS
+    = StateMachine::STATE_COUNT * StateMachine::EVENT_COUNT;
+constexpr uint8_t NO_ROW = TransitionRecord::NO_ROW;
+constexpr int LOOKUPS = 2000000;
+// Scan to table speed-up the benchmark must show, well under the 35 ns to
+// 2 ns measured on the commit that introduced the table
+constexpr double MIN_SPEEDUP = 4;
+
+struct ScanRow {
+  State current_state;
+  Event event;
+  State next_state;
+  std::function<void()> action;
+  std::function<bool()> guard;
+};
+
+std::vector<ScanRow> scanRows;
+std::vector<uint8_t> image;
+const uint8_t* rowIndex = nullptr;
+
+// First row for (state, event), wildcard rows included, as handleEvent()
+// found it before the table
+uint8_t scanLookup(State state, Event event) {
+  for (size_t row = 0; row < scanRows.size(); ++row) {
+    const ScanRow& transition = scanRows[row];
+    if (transition.event == event
+        && (transition.current_state == state
+            || transition.current_state == StateMachine::ANY_STATE)) {
+      return static_cast<uint8_t>(row);
+    }
+  }
+  return NO_ROW;
+}
+
+// The indexed load in StateMachine::dispatch()
+uint8_t tableLookup(State state, Event event) {
+  return rowIndex[static_cast<size_t>(state) * StateMachine::EVENT_COUNT
+                  + static_cast<size_t>(event)];
+}
+
+bool loadBuiltinTable() {
+  StateMachine sm;
+  if (!sm.serializeTransitions(BENCH_PATH)) {
+    return false;
+  }
+  File file = LittleFS.open(BENCH_PATH, "r");
+  image.resize(file.size());
+  bool ok = file.read(image.data(), image.size()) == image.size();
+  file.close();
+  if (!ok || image.size() < sizeof(TransitionTableHeader)) {
+    return false;
+  }
+  TransitionTableHeader header;
+  memcpy(&header, image.data(), sizeof(header));
+  const TransitionRecord* records = reinterpret_cast<const TransitionRecord*>(
+      image.data() + sizeof(header));
+  for (size_t i = 0; i < header.rowCount; ++i) {
+    const TransitionRecord& record = records[i];
+    scanRows.push_back(
+        {record.state == TransitionRecord::ANY_STATE
+             ? StateMachine::ANY_STATE
+             : static_cast<State>(record.state),
+         static_cast<Event>(record.event), static_cast<State>(record.next),
+         []() {}, []() { return true; }});
+  }
+  rowIndex = reinterpret_cast<const uint8_t*>(records + header.rowCount);
+  return true;
+}
+
+// Wall-clock ns per lookup. The inputs are volatile so every iteration
+// looks up again instead of the loop being folded to one call.
+template <typename Lookup>
+double nsPerLookup(Lookup lookup, State state, Event event) {
+  volatile State stateIn = state;
+  volatile Event eventIn = event;
+  volatile uint8_t sink = 0;
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < LOOKUPS; ++i) {
+    sink = lookup(stateIn, eventIn);
+  }
+  const auto end = std::chrono::steady_clock::now();
+  (void)sink;
+  return std::chrono::duration<double, std::nano>(end - start).count()
+         / LOOKUPS;
+}
+
+}  // namespace
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_builtin_table_exports() {
+  TEST_ASSERT_TRUE(loadBuiltinTable());
+  TEST_ASSERT_TRUE(scanRows.size() > 0);
+}
+
+// Both lookups pick the same first row in every cell, so the timings below
+// compare equal work
+void test_table_matches_scan() {
+  for (size_t cell = 0; cell < CELLS; ++cell) {
+    State state = static_cast<State>(cell / StateMachine::EVENT_COUNT);
+    Event event = static_cast<Event>(cell % StateMachine::EVENT_COUNT);
+    TEST_ASSERT_EQUAL_UINT8(scanLookup(state, event),
+                            tableLookup(state, event));
+  }
+}
+
+// The old worst case: an event FAULT does not handle scans every row
+void test_unhandled_event_in_fault() {
+  TEST_ASSERT_EQUAL_UINT8(NO_ROW,
+                          tableLookup(State::FAULT, Event::TEST_SUCCESS));
+  const double scan_ns
+      = nsPerLookup(scanLookup, State::FAULT, Event::TEST_SUCCESS);
+  const double table_ns
+      = nsPerLookup(tableLookup, State::FAULT, Event::TEST_SUCCESS);
+  printf("unhandled event in FAULT, %zu rows: scan %.1f ns, table %.1f ns\n",
+         scanRows.size(), scan_ns, table_ns);
+  TEST_ASSERT_TRUE(table_ns * MIN_SPEEDUP < scan_ns);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_builtin_table_exports);
+  RUN_TEST(test_table_matches_scan);
+  RUN_TEST(test_unhandled_event_in_fault);
+  return UNITY_END();
+}
@@ -0,0 +1,229 @@
+#include "Checkpoint.h"
+#include "HardwareConfig.h"
+#include "HardwareSetup.h"
+#include "ModbusManager.h"
+#include "NodeLog.h"
+#include "NodeSim.h"
+#include "StateMachine.h"
+#include "SwitchTest.h"
+#include <unity.h>
+
+// The firmware as setup() wires it, minus the tests that need the ADC and
+// PZEM hardware: real tasks, queues and event groups on the NodeSim kernel,
+// driven over the Modbus register map the way the tester drives a node.
+
+extern StateMachine* stateMachine;
+
+namespace {
+
+// Register map offsets, see ModbusManager.cpp
+constexpr uint16_t CMD_START_SWITCH_SWEEP = 1;
+constexpr uint16_t CMD_ABORT_TEST = 2;
+constexpr uint16_t SET_COMMAND = 0;
+constexpr uint16_t SET_RECORD_EDGE_TRACE = 1;
+constexpr uint16_t SET_STAT_SHOTS = 2;
+constexpr uint16_t SET_EDGE_DRIVES_CAPTURE = 5;
+constexpr uint16_t DATA_REGS_PER_TEST = 11;
+constexpr uint16_t STATS_REGS_PER_LEVEL = 15;
+
+constexpr int64_t SWEEP_TIMEOUT_US = 60000000;
+constexpr int64_t POLL_US = 10000;  // Modbus master poll spacing
+
+void command(uint16_t value) {
+  mb.writeHreg(HREG_START_ADDRESS_SETTING + SET_COMMAND, value);
+}
+
+void setting(uint16_t reg, uint16_t value) {
+  mb.writeHreg(HREG_START_ADDRESS_SETTING + reg, value);
+}
+
+uint32_t readPair(uint16_t address) {
+  return (static_cast<uint32_t>(mb.readHreg(address)) << 16)
+         | mb.readHreg(address + 1);
+}
+
+uint32_t switchTime_us(uint8_t level) {
+  return readPair(HREG_START_ADDRESS_DATA + level * DATA_REGS_PER_TEST + 3);
+}
+
+bool switchValid(uint8_t level) {
+  return mb.readHreg(HREG_START_ADDRESS_DATA + level * DATA_REGS_PER_TEST
+                     + 10)
+         != 0;
+}
+
+uint16_t statsCount(uint8_t level) {
+  return mb.readHreg(HREG_START_ADDRESS_STATS + level * STATS_REGS_PER_LEVEL);
+}
+
+// Min and max switch time of the level, see statsRegister()
+uint32_t statsMin_us(uint8_t level) {
+  return readPair(HREG_START_ADDRESS_STATS + level * STATS_REGS_PER_LEVEL + 5);
+}
+
+uint32_t statsMax_us(uint8_t level) {
+  return readPair(HREG_START_ADDRESS_STATS + level * STATS_REGS_PER_LEVEL + 7);
+}
+
+// Polls like the tester until the state machine settles in `state`
+bool waitForState(State state, int64_t timeout_us = SWEEP_TIMEOUT_US) {
+  const int64_t end_us = NodeSim::now_us() + timeout_us;
+  while (stateMachine->getCurrentState() != state) {
+    if (NodeSim::now_us() >= end_us) {
+      return false;
+    }
+    NodeSim::advanceBy(POLL_US);
+  }
+  return true;
+}
+
+bool waitForShots(uint16_t shots, int64_t timeout_us = SWEEP_TIMEOUT_US) {
+  const int64_t end_us = NodeSim::now_us() + timeout_us;
+  while (statsCount(0) < shots) {
+    if (NodeSim::now_us() >= end_us) {
+      return false;
+    }
+    NodeSim::advanceBy(POLL_US);
+  }
+  return true;
+}
+
+void startNode() {
+  NodeSim::reset(NodeSim::UpsModel());
+  NodeLog::init();
+  stateMachine = new StateMachine();
+  SetupTask taskSetup;
+  stateMachine->begin(taskSetup.mainTest_taskIdlePriority + 1,
+                      taskSetup.mainTest_taskCore);
+  Checkpoint::begin(1, taskSetup.mainTest_taskCore);
+  switchTest = SwitchTest::getInstance();
+  switchTest->init();
+  PhaseTrigger::begin();
+  modbusRTU_Init();
+}
+
+// Every test starts from an idle node back in AUTO_MODE with default
+// settings
+void resetNode(const NodeSim::UpsModel& model, uint32_t seed) {
+  command(CMD_ABORT_TEST);
+  NodeSim::advanceBy(POLL_US);
+  NodeSim::reset(model, seed);
+  setting(SET_RECORD_EDGE_TRACE, 0);
+  setting(SET_STAT_SHOTS, 1);
+  setting(SET_EDGE_DRIVES_CAPTURE, 0);
+  Checkpoint::clear();
+  stateMachine->setState(State::AUTO_MODE);
+  // Past the capture debounce window of the previous test's last edge
+  NodeSim::advanceBy(1000000);
+}
+
+}  // namespace
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_sweep_over_modbus() {
+  NodeSim::UpsModel model;
+  model.transfer_us = 3000;
+  resetNode(model, 1);
+
+  command(CMD_START_SWITCH_SWEEP);
+  TEST_ASSERT_TRUE(waitForState(State::SWITCHING_TEST_OK));
+  for (uint8_t level = 0; level < 4; ++level) {
+    TEST_ASSERT_TRUE(switchValid(level));
+    TEST_ASSERT_EQUAL_UINT32(3000, switchTime_us(level));
+  }
+}
+
+void test_edge_driven_sweep() {
+  NodeSim::UpsModel model;
+  model.transfer_us = 5000;
+  model.bounces = 2;
+  resetNode(model, 3);
+
+  setting(SET_EDGE_DRIVES_CAPTURE, 1);
+  command(CMD_START_SWITCH_SWEEP);
+  TEST_ASSERT_TRUE(waitForState(State::SWITCHING_TEST_OK));
+  for (uint8_t level = 0; level < 4; ++level) {
+    TEST_ASSERT_EQUAL_UINT32(5000, switchTime_us(level));
+  }
+}
+
+void test_statistical_shots() {
+  NodeSim::UpsModel model;
+  model.transfer_us = 2000;
+  model.jitter_us = 6000;
+  model.bounces = 3;
+  resetNode(model, 7);
+
+  // Back-to-back shots, each well inside the previous one's debounce window
+  setting(SET_STAT_SHOTS, 50);
+  command(CMD_START_SWITCH_SWEEP);
+  TEST_ASSERT_TRUE(waitForShots(50, 5000000));
+  TEST_ASSERT_TRUE(statsMin_us(0) >= 2000);
+  TEST_ASSERT_TRUE(statsMax_us(0) <= 8000);
+  TEST_ASSERT_TRUE(statsMin_us(0) < statsMax_us(0));
+}
+
+// End-to-end error of the switch time SwitchTest reports against the
+// transfer the model injected: ISR timestamp, edge queue, edge task,
+// onEdgeEvent() and process_time_capture(), with interrupt entry latency and
+// contact bounce on every transfer. The trace variant takes the times from
+// analyzeEdgeTrace() instead of the live capture.
+void runAccuracyShots(bool recordEdgeTrace) {
+  const uint32_t transfers_us[] = {1500, 4000, 9000};
+  for (uint32_t transfer_us : transfers_us) {
+    NodeSim::UpsModel model;
+    model.transfer_us = transfer_us;
+    model.bounces = 3;
+    model.isrLatency_us = 20;
+    resetNode(model, transfer_us);
+
+    setting(SET_RECORD_EDGE_TRACE, recordEdgeTrace);
+    setting(SET_STAT_SHOTS, 100);
+    command(CMD_START_SWITCH_SWEEP);
+    TEST_ASSERT_TRUE(waitForShots(100));
+    TEST_ASSERT_TRUE(statsMin_us(0) > transfer_us - 50);
+    TEST_ASSERT_TRUE(statsMax_us(0) < transfer_us + 50);
+  }
+}
+
+void test_switch_time_error_below_50us() { runAccuracyShots(false); }
+
+void test_trace_switch_time_error_below_50us() { runAccuracyShots(true); }
+
+// A UPS that never comes back holds the test in its capture wait until the
+// abort command releases it; mains is restored on the way out and the task
+// takes the next sweep
+void test_abort_releases_capture() {
+  NodeSim::UpsModel model;
+  model.transfer_us = 60000000;
+  resetNode(model, 1);
+
+  command(CMD_START_SWITCH_SWEEP);
+  TEST_ASSERT_TRUE(waitForState(State::SWITCHING_TEST_25P_DONE, 1000000));
+  TEST_ASSERT_EQUAL_UINT8(0, NodeSim::readPin(SENSE_MAINS_POWER_PIN));
+  command(CMD_ABORT_TEST);
+  NodeSim::advanceBy(100000);
+  TEST_ASSERT_EQUAL_UINT8(0, NodeSim::readPin(UPS_POWER_CUT_PIN));
+  TEST_ASSERT_EQUAL_UINT8(1, NodeSim::readPin(SENSE_MAINS_POWER_PIN));
+
+  model.transfer_us = 4000;
+  resetNode(model, 1);
+  command(CMD_START_SWITCH_SWEEP);
+  TEST_ASSERT_TRUE(waitForState(State::SWITCHING_TEST_OK));
+  TEST_ASSERT_EQUAL_UINT32(4000, switchTime_us(3));
+}
+
+int main() {
+  startNode();
+  UNITY_BEGIN();
+  RUN_TEST(test_sweep_over_modbus);
+  RUN_TEST(test_edge_driven_sweep);
+  RUN_TEST(test_statistical_shots);
+  RUN_TEST(test_switch_time_error_below_50us);
+  RUN_TEST(test_trace_switch_time_error_below_50us);
+  RUN_TEST(test_abort_releases_capture);
+  return UNITY_END();
+}
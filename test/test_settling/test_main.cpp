@@ -0,0 +1,157 @@
+#include "SettlingDetector.h"
+#include "VoltageSource.h"
+#include <unity.h>
+
+// InputVoltageTest::runStep() without the meters: the setpoint goes through
+// the StubVoltageSource, a first-order UPS output model answers in dV, and
+// the detector decides when the step has settled.
+
+namespace {
+
+constexpr double SETTLE_STDDEV_DV = 5;  // InputVoltageTest default
+constexpr int MAX_SAMPLES = 60;
+
+// Output regulated to within a tenth of the input deviation from 230 V,
+// closing half the remaining gap per sample, plus uniform noise
+struct UpsOutput {
+  const VoltageSource& source;
+  int32_t noise_dV;
+  double output_dV = 2300;
+  uint32_t rng = 1;
+
+  UpsOutput(const VoltageSource& source, int32_t noise_dV)
+      : source(source), noise_dV(noise_dV) {}
+
+  double target_dV() const {
+    return 2300 + (source.setpoint() * 10.0 - 2300) / 10;
+  }
+
+  int32_t read() {
+    output_dV += (target_dV() - output_dV) / 2;
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    int32_t noise = noise_dV
+                        ? static_cast<int32_t>(rng % (2 * noise_dV + 1))
+                              - noise_dV
+                        : 0;
+    return static_cast<int32_t>(output_dV + 0.5) + noise;
+  }
+};
+
+// Samples until settled as runStep() does; the sample count, zero when the
+// step never settles, -1 when the source rejects the setpoint
+int runStep(VoltageSource& source, UpsOutput& ups, uint16_t setpoint_volt,
+            SettlingDetector& settling) {
+  if (!source.setVoltage(setpoint_volt)) {
+    return -1;
+  }
+  settling.reset();
+  for (int sample = 1; sample <= MAX_SAMPLES; ++sample) {
+    settling.add(ups.read());
+    if (settling.settled(SETTLE_STDDEV_DV)) {
+      return sample;
+    }
+  }
+  return 0;
+}
+
+}  // namespace
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_stub_source_records_setpoint() {
+  StubVoltageSource source;
+  TEST_ASSERT_TRUE(source.begin());
+  TEST_ASSERT_EQUAL_UINT16(0, source.setpoint());
+  TEST_ASSERT_TRUE(source.setVoltage(184));
+  TEST_ASSERT_EQUAL_UINT16(184, source.setpoint());
+}
+
+// A steady output is settled as soon as the window is full, not before
+void test_steady_output_settles_on_full_window() {
+  StubVoltageSource source;
+  source.setVoltage(230);
+  UpsOutput ups(source, 0);
+  SettlingDetector settling;
+
+  TEST_ASSERT_EQUAL_INT(SettlingDetector::WINDOW,
+                        runStep(source, ups, 230, settling));
+  TEST_ASSERT_TRUE(settling.mean() == 2300);
+  TEST_ASSERT_TRUE(settling.stddev() == 0);
+}
+
+// Steps across the input range: each one waits out the transient, and the
+// settled mean is the regulated output for that input. The window still
+// holds the tail of the approach when the spread drops under the threshold,
+// so the mean may trail the output by up to about one more threshold.
+void test_stepped_input_waits_for_transient() {
+  StubVoltageSource source;
+  source.setVoltage(230);
+  UpsOutput ups(source, 0);
+  SettlingDetector settling;
+
+  const uint16_t steps_volt[] = {160, 200, 240, 280, 230};
+  for (uint16_t setpoint : steps_volt) {
+    int samples = runStep(source, ups, setpoint, settling);
+    TEST_ASSERT_TRUE(samples > SettlingDetector::WINDOW);
+    TEST_ASSERT_FLOAT_WITHIN(2 * SETTLE_STDDEV_DV, ups.target_dV(),
+                             settling.mean());
+  }
+}
+
+// Meter noise inside the threshold still settles, noise well above it never
+// does and the step runs to the dwell limit
+void test_noisy_output() {
+  StubVoltageSource source;
+  source.setVoltage(230);
+  SettlingDetector settling;
+
+  UpsOutput quiet(source, 4);
+  TEST_ASSERT_TRUE(runStep(source, quiet, 230, settling) > 0);
+  TEST_ASSERT_TRUE(settling.stddev() <= SETTLE_STDDEV_DV);
+
+  UpsOutput noisy(source, 40);
+  TEST_ASSERT_EQUAL_INT(0, runStep(source, noisy, 230, settling));
+  TEST_ASSERT_TRUE(settling.stddev() > SETTLE_STDDEV_DV);
+}
+
+// The running sums stay exact over a long run: the variance matches a
+// two-pass computation over the last WINDOW readings
+void test_running_sums_match_window() {
+  StubVoltageSource source;
+  source.setVoltage(276);
+  UpsOutput ups(source, 25);
+  SettlingDetector settling;
+
+  int32_t readings[SettlingDetector::WINDOW] = {};
+  for (int sample = 0; sample < 10000; ++sample) {
+    int32_t value = ups.read();
+    readings[sample % SettlingDetector::WINDOW] = value;
+    settling.add(value);
+  }
+  double mean = 0;
+  for (int32_t value : readings) {
+    mean += value;
+  }
+  mean /= SettlingDetector::WINDOW;
+  double variance = 0;
+  for (int32_t value : readings) {
+    variance += (value - mean) * (value - mean);
+  }
+  variance /= SettlingDetector::WINDOW - 1;
+  TEST_ASSERT_TRUE(fabs(settling.mean() - mean) < 1e-9);
+  TEST_ASSERT_TRUE(fabs(settling.variance() - variance) < 1e-6);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_stub_source_records_setpoint);
+  RUN_TEST(test_steady_output_settles_on_full_window);
+  RUN_TEST(test_stepped_input_waits_for_transient);
+  RUN_TEST(test_noisy_output);
+  RUN_TEST(test_running_sums_match_window);
+  return UNITY_END();
+}
@@ -0,0 +1,117 @@
+#include "EdgeTrace.h"
+#include "HardwareConfig.h"
+#include "HardwareSetup.h"
+#include "NodeSim.h"
+#include "driver/gpio.h"
+#include <unity.h>
+
+using NodeTask::IO_SETUP;
+
+// The firmware's edge queue and pin ISRs, see NodeGlobals.cpp. With no state
+// machine and no edge task they only queue, the test consumes.
+extern EdgeEventQueue edgeEventQueue;
+void keyISR1(void* pvParameters);
+void keyISR2(void* pvParameters);
+
+namespace {
+
+constexpr int64_t DEBOUNCE_US = 1000;
+constexpr int64_t CONSUMER_PERIOD_US = 1000;  // Edge task wake-up spacing
+constexpr int64_t SHOT_WINDOW_US = 20000;
+
+EdgeTrace trace;
+
+// The edge consumer task between two wake-ups
+void runFor(int64_t duration_us) {
+  const int64_t end_us = IO_SETUP::now_us() + duration_us;
+  while (IO_SETUP::now_us() < end_us) {
+    NodeSim::advanceBy(CONSUMER_PERIOD_US);
+    EdgeEvent event;
+    while (edgeEventQueue.pop(event)) {
+      trace.record(event);
+    }
+  }
+}
+
+void startSim(const NodeSim::UpsModel& model, uint32_t seed) {
+  NodeSim::reset(model, seed);
+  // As UPSTest::configureInterrupts() sets them up
+  gpio_set_intr_type((gpio_num_t)SENSE_MAINS_POWER_PIN, GPIO_INTR_ANYEDGE);
+  gpio_set_intr_type((gpio_num_t)SENSE_UPS_POWER_PIN, GPIO_INTR_ANYEDGE);
+  gpio_isr_handler_add((gpio_num_t)SENSE_MAINS_POWER_PIN, keyISR1, NULL);
+  gpio_isr_handler_add((gpio_num_t)SENSE_UPS_POWER_PIN, keyISR2, NULL);
+  // esp_timer is well past zero by the time a test runs, and the trace
+  // analysis treats a zero mains-loss time as no edge
+  NodeSim::advanceTo(1000000);
+}
+
+// One cut and restore as SwitchTest::run() drives it with recordEdgeTrace
+EdgeTraceAnalysis runShot() {
+  trace.arm();
+  IO_SETUP::writePin(UPS_POWER_CUT_PIN, 1);
+  runFor(SHOT_WINDOW_US);
+  trace.disarm();
+  IO_SETUP::writePin(UPS_POWER_CUT_PIN, 0);
+  runFor(SHOT_WINDOW_US);
+  return analyzeEdgeTrace(trace.events, trace.size(), SENSE_MAINS_POWER_PIN,
+                          SENSE_UPS_POWER_PIN, DEBOUNCE_US);
+}
+
+int64_t modelSwitchTime_us() {
+  return NodeSim::lastUpsReturn_us() - NodeSim::lastCut_us();
+}
+
+}  // namespace
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_clean_transfer_is_exact() {
+  NodeSim::UpsModel model;
+  model.transfer_us = 3000;
+  startSim(model, 1);
+
+  EdgeTraceAnalysis result = runShot();
+  TEST_ASSERT_TRUE(result.valid);
+  TEST_ASSERT_EQUAL_UINT32(3000, result.switchtime_us);
+  TEST_ASSERT_EQUAL_UINT16(1, result.mainsEdges);
+  TEST_ASSERT_EQUAL_UINT16(2, result.upsEdges);
+}
+
+void test_bounce_settles_to_first_edge() {
+  NodeSim::UpsModel model;
+  model.transfer_us = 3000;
+  model.bounces = 4;
+  startSim(model, 1);
+
+  EdgeTraceAnalysis result = runShot();
+  TEST_ASSERT_TRUE(result.valid);
+  TEST_ASSERT_FALSE(result.doubleTransfer);
+  TEST_ASSERT_EQUAL_UINT16(2 + 2 * model.bounces, result.upsEdges);
+  TEST_ASSERT_EQUAL_UINT8(2, result.upsTransitions);
+  TEST_ASSERT_EQUAL_UINT32(3000, result.switchtime_us);
+}
+
+void test_thousands_of_shots() {
+  NodeSim::UpsModel model;
+  model.transfer_us = 2000;
+  model.jitter_us = 6000;
+  model.bounces = 2;
+  startSim(model, 7);
+
+  for (int shot = 0; shot < 5000; ++shot) {
+    EdgeTraceAnalysis result = runShot();
+    TEST_ASSERT_TRUE(result.valid);
+    TEST_ASSERT_EQUAL_UINT32(modelSwitchTime_us(), result.switchtime_us);
+  }
+  TEST_ASSERT_EQUAL_UINT32(0, edgeEventQueue.dropped());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_clean_transfer_is_exact);
+  RUN_TEST(test_bounce_settles_to_first_edge);
+  RUN_TEST(test_thousands_of_shots);
+  return UNITY_END();
+}
@@ -0,0 +1,59 @@
+#!/usr/bin/env python3
+"""Convert a BackupTimeTest flash log (/backup.bin pulled from LittleFS) to CSV.
+
+Layout (little-endian, see src/TEST_NODE/backupTime/BackupLog.h):
+header  uint32 magic "BKUP", uint16 version, uint16 blockSize,
+        uint32 sampleInterval_ms, uint32 loadVA
+blocks  uint16 magic 0xB10C, uint16 sequence, uint16 count, uint16 reserved,
+        then samples of uint32 time_ms, uint32 power_dW, uint16 voltage_dV,
+        uint16 battery_mV
+
+Usage: backup_log_decoder.py backup.bin [-o out.csv]
+"""
+import argparse
+import struct
+import sys
+
+HEADER = struct.Struct("<IHHII")
+BLOCK_HEAD = struct.Struct("<HHHH")
+SAMPLE = struct.Struct("<IIHH")
+HEADER_MAGIC = 0x50554B42
+BLOCK_MAGIC = 0xB10C
+
+
+def decode(data, out):
+    magic, version, block_size, interval_ms, load_va = HEADER.unpack_from(data)
+    if magic != HEADER_MAGIC:
+        sys.exit("not a backup log")
+    print(f"# version {version}, interval {interval_ms} ms, load {load_va} VA",
+          file=sys.stderr)
+    out.write("time_s,output_power_w,output_voltage_v,battery_v\n")
+    expected = 0
+    for offset in range(HEADER.size, len(data) - block_size + 1, block_size):
+        bmagic, seq, count, _ = BLOCK_HEAD.unpack_from(data, offset)
+        if bmagic != BLOCK_MAGIC:
+            print(f"# bad block at {offset}, stopping", file=sys.stderr)
+            break
+        if seq != expected:
+            print(f"# sequence gap {expected} -> {seq}", file=sys.stderr)
+        expected = seq + 1
+        for i in range(count):
+            t, power, volts, batt = SAMPLE.unpack_from(
+                data, offset + BLOCK_HEAD.size + i * SAMPLE.size)
+            out.write(f"{t / 1000:.3f},{power / 10:.1f},{volts / 10:.1f},"
+                      f"{batt / 1000:.3f}\n")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("log")
+    parser.add_argument("-o", "--output")
+    args = parser.parse_args()
+    with open(args.log, "rb") as f:
+        data = f.read()
+    out = open(args.output, "w") if args.output else sys.stdout
+    decode(data, out)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,113 @@
+#!/usr/bin/env python3
+"""Decode NodeLog binary records (firmware built with -D NODE_LOG_BINARY).
+
+Each record is framed as 0xA5 0x5A followed by a little-endian LogRecord:
+uint32 timestamp_us, uint16 fmt, uint8 level, uint8 nargs, uint32 args[4].
+
+Usage: log_decoder.py <capture.bin | serial port> [--baud 115200]
+"""
+import argparse
+import os
+import re
+import struct
+import sys
+
+ROOT = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..")
+CORE = os.path.join(ROOT, "src", "TEST_NODE", "Node_Core")
+
+FRAME = b"\xa5\x5a"
+RECORD = struct.Struct("<IHBB4I")
+LEVELS = {1: "E", 2: "W", 3: "I", 4: "D"}
+
+
+def load_formats():
+    with open(os.path.join(CORE, "LogFormats.def")) as f:
+        return re.findall(r'^LOG_FORMAT\(\s*\w+\s*,\s*"(.*)"\s*\)', f.read(),
+                          re.M)
+
+
+def load_enum(name):
+    with open(os.path.join(CORE, "StateDefines.h")) as f:
+        body = re.search(r"enum class %s \{(.*?)\};" % name, f.read(), re.S)
+    names, value = {}, 0
+    for entry in body.group(1).split(","):
+        entry = entry.strip()
+        if not entry:
+            continue
+        if "=" in entry:
+            key, val = (part.strip() for part in entry.split("="))
+            value = int(val)
+        else:
+            key = entry
+        names[value & 0xFFFFFFFF] = key
+        value += 1
+    return names
+
+
+def render(fmt, args, states, events):
+    out, arg = [], iter(args)
+    i = 0
+    while i < len(fmt):
+        if fmt[i] == "%" and i + 1 < len(fmt):
+            spec = fmt[i + 1]
+            value = next(arg, 0)
+            if spec == "u":
+                out.append(str(value))
+            elif spec == "d":
+                out.append(str(value - (1 << 32) if value & 0x80000000 else value))
+            elif spec == "x":
+                out.append("%x" % value)
+            elif spec == "S":
+                out.append(states.get(value, "UNKNOWN_STATE"))
+            elif spec == "E":
+                out.append(events.get(value, "UNKNOWN_EVENT"))
+            else:
+                out.append(spec)
+            i += 2
+        else:
+            out.append(fmt[i])
+            i += 1
+    return "".join(out)
+
+
+def records(stream):
+    buf = b""
+    while True:
+        chunk = stream.read(256)
+        if not chunk:
+            return
+        buf += chunk
+        while True:
+            start = buf.find(FRAME)
+            if start < 0 or len(buf) - start - 2 < RECORD.size:
+                buf = buf[start:] if start >= 0 else buf[-1:]
+                break
+            body = buf[start + 2:start + 2 + RECORD.size]
+            buf = buf[start + 2 + RECORD.size:]
+            yield RECORD.unpack(body)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("source")
+    parser.add_argument("--baud", type=int, default=115200)
+    opts = parser.parse_args()
+
+    formats = load_formats()
+    states, events = load_enum("State"), load_enum("Event")
+
+    if os.path.isfile(opts.source):
+        stream = open(opts.source, "rb")
+    else:
+        import serial  # pyserial, only needed for live capture
+        stream = serial.Serial(opts.source, opts.baud, timeout=1)
+
+    for ts, fmt, level, nargs, *args in records(stream):
+        text = (render(formats[fmt], args[:nargs], states, events)
+                if fmt < len(formats) else "<unknown log format %d>" % fmt)
+        print("[%10u] %s %s" % (ts, LEVELS.get(level, "?"), text))
+        sys.stdout.flush()
+
+
+if __name__ == "__main__":
+    main()
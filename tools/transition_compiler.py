@@ -0,0 +1,181 @@
+#!/usr/bin/env python3
+"""Compile a StateMachine transition table (JSON or CSV) to its binary form.
+
+Rows are current_state, event, next_state, action, guard, named as in
+StateDefines.h and TransitionTable.h; current_state ANY matches every state,
+an empty action or guard is NONE. JSON is {"transitions": [{...}, ...]},
+CSV has those five columns with a header line. The first matching row wins
+and a row whose guard fails falls back to the next row with the same
+current_state and event, as in the built-in table.
+
+Layout (little-endian, see src/TEST_NODE/Node_Core/TransitionTable.h):
+header  uint32 magic "STTB", uint16 version, uint8 stateCount,
+        uint8 eventCount, uint16 rowCount, uint16 reserved, uint32 crc32
+rows    uint8 state, event, next, action, guard
+index   uint8 first row per (state, event), fallback uint8 per row
+
+Usage: transition_compiler.py table.json [-o transitions.bin]
+       transition_compiler.py --decompile transitions.bin [-o table.json]
+"""
+import argparse
+import csv
+import json
+import os
+import re
+import struct
+import sys
+import zlib
+
+ROOT = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..")
+CORE = os.path.join(ROOT, "src", "TEST_NODE", "Node_Core")
+
+HEADER = struct.Struct("<IHBBHHI")
+ROW = struct.Struct("<5B")
+MAGIC = 0x42545453
+VERSION = 1
+ANY_STATE = 0xFF
+NO_ROW = 0xFF
+MAX_ROWS = 96
+FIELDS = ("current_state", "event", "next_state", "action", "guard")
+
+
+def load_enum(header, name):
+    with open(os.path.join(CORE, header)) as f:
+        body = re.search(r"enum class %s\b[^{]*\{(.*?)\};" % name, f.read(),
+                         re.S)
+    names, value = [], 0
+    for entry in body.group(1).split(","):
+        entry = entry.strip()
+        if not entry:
+            continue
+        if "=" in entry:
+            key, val = (part.strip() for part in entry.split("="))
+            value = int(val)
+        else:
+            key = entry
+        if value >= 0 and key != "COUNT":
+            names.append((key, value))
+        value += 1
+    return dict(names)
+
+
+def load_names():
+    return {
+        "state": load_enum("StateDefines.h", "State"),
+        "event": load_enum("StateDefines.h", "Event"),
+        "action": load_enum("TransitionTable.h", "TableAction"),
+        "guard": load_enum("TransitionTable.h", "TableGuard"),
+    }
+
+
+def read_rows(path):
+    if path.endswith(".json"):
+        with open(path) as f:
+            return json.load(f)["transitions"]
+    with open(path, newline="") as f:
+        return [row for row in csv.DictReader(f)
+                if any((value or "").strip() for value in row.values())]
+
+
+def lookup(names, kind, value, line):
+    value = (value or "").strip()
+    if kind in ("action", "guard") and value in ("", "null", "None"):
+        value = "NONE"
+    if kind == "state" and value == "ANY":
+        return ANY_STATE
+    if value not in names[kind]:
+        sys.exit(f"row {line}: unknown {kind} '{value}'")
+    return names[kind][value]
+
+
+def compile_table(rows, names):
+    state_count = max(names["state"].values()) + 1
+    event_count = max(names["event"].values()) + 1
+    if not 0 < len(rows) <= MAX_ROWS:
+        sys.exit(f"{len(rows)} rows, the firmware takes 1..{MAX_ROWS}")
+    records = []
+    for line, row in enumerate(rows, 1):
+        state = lookup(names, "state", row.get("current_state"), line)
+        nxt = lookup(names, "state", row.get("next_state"), line)
+        if nxt == ANY_STATE:
+            sys.exit(f"row {line}: next_state cannot be ANY")
+        records.append((state, lookup(names, "event", row.get("event"), line),
+                        nxt, lookup(names, "action", row.get("action"), line),
+                        lookup(names, "guard", row.get("guard"), line)))
+
+    index = bytearray([NO_ROW]) * (state_count * event_count)
+    for s in range(state_count):
+        for e in range(event_count):
+            for r, (state, event, _, _, _) in enumerate(records):
+                if event == e and state in (s, ANY_STATE):
+                    index[s * event_count + e] = r
+                    break
+    fallback = bytearray([NO_ROW]) * len(records)
+    for r, (state, event, _, _, _) in enumerate(records):
+        for j in range(r + 1, len(records)):
+            if records[j][0] == state and records[j][1] == event:
+                fallback[r] = j
+                break
+
+    body = b"".join(ROW.pack(*record) for record in records)
+    body += bytes(index) + bytes(fallback)
+    return HEADER.pack(MAGIC, VERSION, state_count, event_count, len(records),
+                       0, zlib.crc32(body)) + body
+
+
+def decompile(data, names):
+    magic, version, states, events, count, _, crc = HEADER.unpack_from(data)
+    if magic != MAGIC or version != VERSION:
+        sys.exit("not a version %d transition table" % VERSION)
+    if zlib.crc32(data[HEADER.size:]) != crc:
+        sys.exit("crc mismatch")
+    rev = {kind: {v: k for k, v in table.items()}
+           for kind, table in names.items()}
+    rows = []
+    for r in range(count):
+        state, event, nxt, action, guard = ROW.unpack_from(
+            data, HEADER.size + r * ROW.size)
+        rows.append({
+            "current_state":
+                "ANY" if state == ANY_STATE else rev["state"][state],
+            "event": rev["event"][event],
+            "next_state": rev["state"][nxt],
+            "action": None if action == 0 else rev["action"][action],
+            "guard": None if guard == 0 else rev["guard"][guard],
+        })
+    print(f"# {count} rows, {states} states, {events} events", file=sys.stderr)
+    return rows
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("table")
+    parser.add_argument("-o", "--output")
+    parser.add_argument("--decompile", action="store_true",
+                        help="binary table to JSON (or CSV for a .csv output)")
+    args = parser.parse_args()
+    names = load_names()
+
+    if args.decompile:
+        with open(args.table, "rb") as f:
+            rows = decompile(f.read(), names)
+        out = open(args.output, "w", newline="") if args.output else sys.stdout
+        if args.output and args.output.endswith(".csv"):
+            writer = csv.DictWriter(out, fieldnames=FIELDS)
+            writer.writeheader()
+            writer.writerows({k: v or "" for k, v in row.items()}
+                             for row in rows)
+        else:
+            json.dump({"transitions": rows}, out, indent=2)
+            out.write("\n")
+        return
+
+    image = compile_table(read_rows(args.table), names)
+    output = args.output or os.path.splitext(args.table)[0] + ".bin"
+    with open(output, "wb") as f:
+        f.write(image)
+    print(f"# {output}: {len(image)} bytes", file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()